@@ -0,0 +1,231 @@
+/**
+ * @file hogwild.c
+ * @brief Compare Hogwild with synchronous data-parallel training on MNIST
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dataset.h"
+#include "layers.h"
+#include "losses.h"
+#include "net.h"
+#include "trainer.h"
+#include "util.h"
+
+// Number of pixels of an image
+#define IMAGE_SIZE (28 * 28)
+
+// Number of classes
+#define CLASS_NUM 10
+
+// Number of samples of a micro-batch of each replica
+#define MICRO_BATCH_SIZE 8
+
+// Number of epochs of each mode
+#define EPOCHS 3
+
+// Learning rate of both modes
+#define LEARNING_RATE 0.1f
+
+// Seed of initial parameters
+#define SEED 1
+
+// Get the current time in seconds
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Load images as contiguous vectors in [0,1] and their labels
+static bool load_mnist(
+    const char *labels_file, const char *images_file, float **images, int **labels, int *num
+) {
+    Dataset label_set, image_set;
+    if (dataset_open_idx(&label_set, labels_file) == NULL) {
+        return false;
+    }
+    if (dataset_open_idx(&image_set, images_file) == NULL) {
+        dataset_close(&label_set);
+        return false;
+    }
+
+    // Labels are bytes of class indices, one for each image
+    bool loaded = false;
+    const size_t n = label_set.num_samples;
+    if ((label_set.type == DATASET_TYPE_UINT8) && (label_set.sample_size == 1) &&
+        (image_set.num_samples == n) && (image_set.sample_size == IMAGE_SIZE)) {
+        *images = malloc(sizeof(float) * n * IMAGE_SIZE);
+        *labels = malloc(sizeof(int) * n);
+        loaded = (*images != NULL) && (*labels != NULL) &&
+            dataset_samples_float(&image_set, 0, n, (1.0f / 255), *images);
+    }
+
+    if (loaded) {
+        const uint8_t *raw_labels = label_set.data;
+        for (size_t i = 0; i < n; i++) {
+            (*labels)[i] = raw_labels[i];
+        }
+        *num = (int)n;
+    } else {
+        free(*images);
+        free(*labels);
+        *images = NULL;
+        *labels = NULL;
+    }
+
+    dataset_close(&label_set);
+    dataset_close(&image_set);
+    return loaded;
+}
+
+// Accuracy of a network for a dataset
+static float evaluate(Net *net, const float *images, const int *labels, const int num) {
+    int corrects = 0;
+    for (int i = 0; i < num; i += MICRO_BATCH_SIZE) {
+        const int n = ((num - i) < MICRO_BATCH_SIZE) ? (num - i) : MICRO_BATCH_SIZE;
+        const float *y = net_forward_batch(net, &images[(size_t)i * IMAGE_SIZE], n);
+
+        for (int j = 0; j < n; j++) {
+            if (argmax(&y[j * CLASS_NUM], CLASS_NUM) == labels[i + j]) {
+                corrects++;
+            }
+        }
+    }
+
+    return (float)corrects / num;
+}
+
+// Train a network from the same parameters for epochs, by Hogwild or synchronously
+static void bench(
+    DataParallel *dp, const float *init_params, const bool hogwild,
+    const float *train_images, const int *train_labels, const int num_train,
+    const float *test_images, const int *test_labels, const int num_test
+) {
+    Net *net = dp->net;
+    memcpy(net->params, init_params, (sizeof(float) * net->num_params));
+
+    const SparseLossFunc loss_func = sparse_softmax_ce_loss();
+    const int batch_size = MICRO_BATCH_SIZE * dp->num_replicas;
+
+    for (int epoch = 0; epoch < EPOCHS; epoch++) {
+        const double start = now();
+
+        float loss = 0;
+        if (hogwild) {
+            loss = train_hogwild_sparse(
+                dp, train_images, train_labels, num_train, LEARNING_RATE, loss_func
+            );
+        } else {
+            // A step for each batch of all replicas
+            for (int i = 0; i < num_train; i += batch_size) {
+                const int n = ((num_train - i) < batch_size) ? (num_train - i) : batch_size;
+                loss += n * train_data_parallel_sparse(
+                    dp, &train_images[(size_t)i * IMAGE_SIZE], &train_labels[i], n, loss_func
+                );
+                train_step(net, LEARNING_RATE);
+            }
+            loss /= num_train;
+        }
+
+        const double seconds = now() - start;
+        printf(
+            "%-8s epoch %d: %8.3f s, %9.0f samples/s, train loss %.4f, test accuracy %.4f\n",
+            (hogwild ? "hogwild" : "sync"), (epoch + 1), seconds, (num_train / seconds),
+            loss, evaluate(net, test_images, test_labels, num_test)
+        );
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(
+            stderr,
+            "Usage: %s train-labels train-images test-labels test-images [threads]\n", argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    const int num_threads = (argc > 5) ? atoi(argv[5]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int status = EXIT_FAILURE;
+    float *train_images = NULL, *test_images = NULL;
+    int *train_labels = NULL, *test_labels = NULL;
+    float *init_params = NULL;
+    int num_train, num_test;
+    Net net;
+    DataParallel dp;
+
+    if (!load_mnist(argv[1], argv[2], &train_images, &train_labels, &num_train) ||
+        !load_mnist(argv[3], argv[4], &test_images, &test_labels, &num_test)) {
+        fprintf(stderr, "Error: failed to load MNIST\n");
+        goto FREE_DATASETS;
+    }
+
+    if ((num_threads < 1) || !net_set_num_threads(num_threads) ||
+        (net_alloc_layers(
+            &net,
+            LAYER_PARAMS_LIST(
+                { .type=LAYER_TYPE_FC, .batch_size=MICRO_BATCH_SIZE, .in=IMAGE_SIZE, .out=100 },
+                { .type=LAYER_TYPE_SIGMOID },
+                { .type=LAYER_TYPE_FC, .out=CLASS_NUM }
+            )
+        ) == NULL)) {
+        fprintf(stderr, "Error: failed to allocate a network\n");
+        goto FREE_DATASETS;
+    }
+    if (train_data_parallel_alloc(&dp, &net, num_threads) == NULL) {
+        fprintf(stderr, "Error: failed to allocate replicas\n");
+        goto FREE_NET;
+    }
+
+    // Both modes start from the same parameters
+    net_init_params(&net, SEED);
+    init_params = malloc(sizeof(float) * net.num_params);
+    if (init_params == NULL) {
+        fprintf(stderr, "Error: failed to allocate initial parameters\n");
+        goto FREE_REPLICAS;
+    }
+    memcpy(init_params, net.params, (sizeof(float) * net.num_params));
+
+    printf(
+        "MNIST, %d threads, micro-batch %d per thread, learning rate %.3f\n",
+        num_threads, MICRO_BATCH_SIZE, LEARNING_RATE
+    );
+
+    bench(
+        &dp, init_params, false,
+        train_images, train_labels, num_train, test_images, test_labels, num_test
+    );
+    bench(
+        &dp, init_params, true,
+        train_images, train_labels, num_train, test_images, test_labels, num_test
+    );
+
+    status = EXIT_SUCCESS;
+
+    free(init_params);
+
+FREE_REPLICAS:
+    train_data_parallel_free(&dp);
+
+FREE_NET:
+    net_free_layers(&net);
+
+FREE_DATASETS:
+    net_set_num_threads(1);
+
+    free(train_images);
+    free(train_labels);
+    free(test_images);
+    free(test_labels);
+
+    return status;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file softmax_backward.c
+ * @brief Compare backward of the softmax layer with the Jacobian product
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "layers.h"
+#include "net.h"
+
+// Number of samples of a batch
+#define BATCH_SIZE 8
+
+// Min. time to measure each implementation in seconds
+#define MIN_SECONDS 0.5
+
+// Get the current time in seconds
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Backward by multiplying the Jacobian and the gradient, O(n^2) for each sample
+// A row of the Jacobian is built at a time,
+// the whole one of 32000 classes does not fit in memory (4 GB)
+static void jacobian_backward(
+    float *gx, const float *y, const float *gy, const int batch_size, const int size
+) {
+    float *jacobian_row = malloc(sizeof(float) * size);
+
+    for (int i = 0; i < batch_size; i++) {
+        const float *y_row = &y[i * size];
+        const float *gy_row = &gy[i * size];
+
+        for (int j = 0; j < size; j++) {
+            for (int k = 0; k < size; k++) {
+                jacobian_row[k] = (j == k) ? (y_row[j] * (1 - y_row[j])) : (-y_row[j] * y_row[k]);
+            }
+
+            float acc = 0;
+            for (int k = 0; k < size; k++) {
+                acc += jacobian_row[k] * gy_row[k];
+            }
+            gx[i * size + j] = acc;
+        }
+    }
+
+    free(jacobian_row);
+}
+
+// Measure both implementations for a number of classes
+static void bench(const int num_classes) {
+    Net net;
+    if (net_alloc_layers(
+        &net,
+        LAYER_PARAMS_LIST(
+            { .type=LAYER_TYPE_SOFTMAX, .batch_size=BATCH_SIZE, .in=num_classes }
+        )
+    ) == NULL) {
+        fprintf(stderr, "failed to allocate a network\n");
+        return;
+    }
+
+    const int size = BATCH_SIZE * num_classes;
+    float *x = malloc(sizeof(float) * size);
+    float *gy = malloc(sizeof(float) * size);
+    float *gx = malloc(sizeof(float) * size);
+    for (int i = 0; i < size; i++) {
+        x[i] = sinf((float)i);
+        gy[i] = cosf((float)i);
+    }
+
+    const float *y = net_forward(&net, x);
+
+    int analytic_runs = 0;
+    const double analytic_start = now();
+    double analytic_seconds;
+    do {
+        net_backward(&net, gy);
+        analytic_runs++;
+        analytic_seconds = now() - analytic_start;
+    } while (analytic_seconds < MIN_SECONDS);
+
+    int jacobian_runs = 0;
+    const double jacobian_start = now();
+    double jacobian_seconds;
+    do {
+        jacobian_backward(gx, y, gy, BATCH_SIZE, num_classes);
+        jacobian_runs++;
+        jacobian_seconds = now() - jacobian_start;
+    } while (jacobian_seconds < MIN_SECONDS);
+
+    // Both should agree
+    const float *analytic_gx = net_backward(&net, gy);
+    float max_diff = 0;
+    for (int i = 0; i < size; i++) {
+        max_diff = fmaxf(max_diff, fabsf(analytic_gx[i] - gx[i]));
+    }
+
+    const double analytic_us = analytic_seconds / analytic_runs * 1e6;
+    const double jacobian_us = jacobian_seconds / jacobian_runs * 1e6;
+    printf(
+        "%6d classes: jacobian %12.1f us, analytic %8.1f us, speedup %9.1fx, max diff %.2e\n",
+        num_classes, jacobian_us, analytic_us, (jacobian_us / analytic_us), max_diff
+    );
+
+    free(x);
+    free(gy);
+    free(gx);
+    net_free_layers(&net);
+}
+
+int main(void) {
+    printf("Backward of softmax, batch size %d\n", BATCH_SIZE);
+
+    const int num_classes[] = { 10, 1000, 32000 };
+    for (int i = 0; i < 3; i++) {
+        bench(num_classes[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file cpu.h
+ * @brief CPU feature detection
+ */
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Instruction set extensions available on the running CPU
+ */
+typedef struct CpuFeatures {
+    bool sse2; //!< SSE2
+    bool avx2; //!< AVX2, with OS support of YMM registers
+    bool fma; //!< FMA3
+    bool avx512f; //!< AVX-512F, with OS support of ZMM registers
+} CpuFeatures;
+
+/**
+ * @brief Get features of the running CPU
+ *
+ * @return Pointer to the CPU features
+ * @note Features are detected by cpuid at the first call, which is thread-safe
+ */
+const CpuFeatures *cpu_features(void);
+
+#endif // CPU_H
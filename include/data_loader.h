@@ -0,0 +1,94 @@
+/**
+ * @file data_loader.h
+ * @brief Background loader of batches from datasets
+ */
+#ifndef DATA_LOADER_H
+#define DATA_LOADER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "dataset.h"
+#include "sampler.h"
+
+/**
+ * @brief Number of batch buffers, one is trained while the next is assembled
+ */
+#define DATA_LOADER_NUM_BUFFERS 2
+
+/**
+ * @brief Batch assembled by a loader
+ */
+typedef struct DataLoaderBatch {
+    float *x; //!< Inputs, size * sample_size elements aligned to 64 bytes
+    int *t; //!< Class indices of the samples, NULL without labels
+    int size; //!< Number of samples, less than batch_size at the end of an epoch
+} DataLoaderBatch;
+
+/**
+ * @brief Loader of batches on a background thread
+ *
+ * The loader thread converts the next batch into a free buffer while the caller trains
+ * on the current one. Buffers are handed over by a lock-free single-producer/
+ * single-consumer ring, a thread sleeps only if it has waited for a while.
+ */
+typedef struct DataLoader {
+    const Dataset *inputs; //!< Inputs
+    const Dataset *labels; //!< Class indices, NULL without labels
+    int batch_size; //!< Max. number of samples of a batch
+    float scale; //!< Scale of inputs, e.g. 1/255 to normalize pixels to [0,1]
+    Sampler *sampler; //!< Sampler shuffling each epoch, NULL to load samples in order
+
+    DataLoaderBatch batches[DATA_LOADER_NUM_BUFFERS]; //!< Ring of batch buffers
+    float *buffer; //!< Memory of inputs of all batches
+
+    unsigned int produced; //!< Number of batches published by the loader thread
+    unsigned int consumed; //!< Number of batches released by the caller
+    bool holding; //!< The caller holds a batch
+    bool stop; //!< Stop the loader thread
+    int sleepers; //!< Number of threads sleeping on the condition
+    int spin_count; //!< Number of polls before sleeping, 0 on a single CPU
+
+    pthread_mutex_t mutex; //!< Mutex for the condition
+    pthread_cond_t cond; //!< Condition to wake a sleeping thread
+    pthread_t thread; //!< Loader thread
+} DataLoader;
+
+/**
+ * @brief Allocate batch buffers and start a loader thread
+ *
+ * @param[out] loader Loader
+ * @param[in] inputs Inputs, converted to floats
+ * @param[in] labels Class indices of UINT8 or INT32 with a sample of a scalar,
+ *            NULL without labels
+ * @param[in] batch_size Max. number of samples of a batch
+ * @param[in] scale Scale of inputs, e.g. 1/255 to normalize pixels to [0,1]
+ * @param[in,out] sampler Sampler of the samples shuffled at the start of each epoch,
+ *                NULL to load samples in order
+ * @return Pointer to the loader, NULL if failed
+ * @note Datasets and the sampler must be kept until the loader is freed,
+ *       the sampler is used only by the loader thread. Epochs are loaded one after another
+ */
+DataLoader *data_loader_alloc(
+    DataLoader *loader, const Dataset *inputs, const Dataset *labels,
+    const int batch_size, const float scale, Sampler *sampler
+);
+
+/**
+ * @brief Stop a loader thread and free batch buffers
+ *
+ * @param[in,out] loader Loader
+ */
+void data_loader_free(DataLoader *loader);
+
+/**
+ * @brief Get the next batch, the previous batch is given back to the loader
+ *
+ * @param[in,out] loader Loader
+ * @return Pointer to the batch, NULL at the end of an epoch
+ * @note Wait until the batch is assembled. The batch is valid until the next call,
+ *       the call after NULL starts the next epoch
+ */
+const DataLoaderBatch *data_loader_next(DataLoader *loader);
+
+#endif // DATA_LOADER_H
@@ -0,0 +1,149 @@
+/**
+ * @file dataset.h
+ * @brief Memory-mapped binary dataset
+ */
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Max. number of dimensions of a sample
+ */
+#define DATASET_MAX_DIMS 4
+
+/**
+ * @brief Type of elements of a dataset
+ */
+typedef enum DatasetType {
+    DATASET_TYPE_FLOAT32, //!< 32-bit float, e.g. inputs
+    DATASET_TYPE_UINT8, //!< 8-bit unsigned integer, e.g. raw pixels
+    DATASET_TYPE_INT32 //!< 32-bit signed integer, e.g. class indices
+} DatasetType;
+
+/**
+ * @brief Dataset of samples mapped read-only from a file
+ *
+ * A file is a 64-byte header followed by row-major samples, both in the byte order
+ * of the host. Samples start at a 64-byte boundary of the mapping.
+ * An IDX file is also mapped as it is, without the alignment.
+ */
+typedef struct Dataset {
+    DatasetType type; //!< Type of elements
+    size_t num_samples; //!< Number of samples
+    size_t sample_size; //!< Number of elements of a sample
+    int ndim; //!< Number of dimensions of a sample, 0 for a scalar
+    int shape[DATASET_MAX_DIMS]; //!< Shape of a sample
+    const void *data; //!< Contiguous samples in the mapping
+
+    void *map; //!< Mapping of the whole file
+    size_t map_size; //!< Number of bytes of the mapping
+} Dataset;
+
+/**
+ * @brief Get the number of bytes of an element
+ *
+ * @param[in] type Type of elements
+ * @return Number of bytes, 0 if the type is unknown
+ */
+size_t dataset_type_size(const DatasetType type);
+
+/**
+ * @brief Write samples to a dataset file
+ *
+ * @param[in] filename Path of the file
+ * @param[in] type Type of elements
+ * @param[in] ndim Number of dimensions of a sample, up to DATASET_MAX_DIMS
+ * @param[in] shape Shape of a sample, can be NULL if ndim is 0
+ * @param[in] num_samples Number of samples
+ * @param[in] data Row-major samples
+ * @return true if succeeded, otherwise false
+ */
+bool dataset_write(
+    const char *filename, const DatasetType type, const int ndim, const int *shape,
+    const size_t num_samples, const void *data
+);
+
+/**
+ * @brief Convert an IDX file of unsigned bytes to a dataset file
+ *
+ * @param[in] idx_filename Path of the IDX file, e.g. MNIST
+ * @param[in] filename Path of the dataset file
+ * @param[in] type Type of elements to be written,
+ *            FLOAT32 is normalized to [0,1], UINT8 and INT32 keep values
+ * @return true if succeeded, otherwise false
+ * @note The first dimension of the IDX file is samples.
+ *       The file is converted in chunks, without loading all of it
+ */
+bool dataset_convert_idx(const char *idx_filename, const char *filename, const DatasetType type);
+
+/**
+ * @brief Map a dataset file read-only
+ *
+ * @param[in,out] dataset Dataset
+ * @param[in] filename Path of the file
+ * @return Pointer to the dataset, NULL if failed
+ * @note Nothing is parsed or copied, pages of samples are read when they are touched
+ */
+Dataset *dataset_open(Dataset *dataset, const char *filename);
+
+/**
+ * @brief Map an IDX file of unsigned bytes read-only as a dataset of UINT8
+ *
+ * @param[in,out] dataset Dataset
+ * @param[in] filename Path of the IDX file, e.g. MNIST
+ * @return Pointer to the dataset, NULL if failed
+ * @note The first dimension of the IDX file is samples. Samples are kept as bytes,
+ *       a quarter of the memory of floats, convert them by dataset_samples_float
+ */
+Dataset *dataset_open_idx(Dataset *dataset, const char *filename);
+
+/**
+ * @brief Unmap a dataset
+ *
+ * @param[in,out] dataset Dataset
+ */
+void dataset_close(Dataset *dataset);
+
+/**
+ * @brief Get a view of samples without copying them
+ *
+ * @param[in] dataset Dataset
+ * @param[in] index Index of the first sample
+ * @param[in] n Number of samples of the view
+ * @return Pointer to the contiguous samples, NULL if out of range
+ * @note Valid until the dataset is closed, elements are the type of the dataset
+ */
+const void *dataset_samples(const Dataset *dataset, const size_t index, const size_t n);
+
+/**
+ * @brief Convert samples to floats with a scale, e.g. into an input of a batch
+ *
+ * @param[in] dataset Dataset
+ * @param[in] index Index of the first sample
+ * @param[in] n Number of samples
+ * @param[in] scale Scale of elements, e.g. 1/255 to normalize pixels to [0,1]
+ * @param[out] y Row-major samples, n * sample_size elements
+ * @return true if succeeded, false if out of range
+ */
+bool dataset_samples_float(
+    const Dataset *dataset, const size_t index, const size_t n, const float scale, float *y
+);
+
+/**
+ * @brief Gather samples at indices into contiguous floats with a scale
+ *
+ * @param[in] dataset Dataset
+ * @param[in] indices Indices of samples, e.g. a shuffled part of an epoch
+ * @param[in] n Number of indices
+ * @param[in] scale Scale of elements, e.g. 1/255 to normalize pixels to [0,1]
+ * @param[out] y Row-major samples, n * sample_size elements
+ * @return true if succeeded, false if an index is out of range
+ * @note Rows of the following indices are prefetched while a row is converted
+ */
+bool dataset_gather_float(
+    const Dataset *dataset, const size_t *indices, const size_t n, const float scale, float *y
+);
+
+#endif // DATASET_H
@@ -0,0 +1,131 @@
+/**
+ * @file gemm.h
+ * @brief General matrix multiplication
+ */
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <stddef.h>
+
+#include "vmath.h"
+
+/**
+ * @brief Elementwise operations applied to C after multiplication
+ * @note Applied to each tile of C while it is in cache
+ */
+typedef struct GemmEpilogue {
+    const float *bias; //!< Bias vector added to each row of C, NULL if none
+
+    /**
+     * @brief Elementwise activation in place, NULL if none
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input vector
+     * @param[in] size Number of elements
+     * @param[in] precision Accuracy
+     */
+    void (*activation)(float*, const float*, const int, const MathPrecision);
+
+    MathPrecision precision; //!< Accuracy of the activation
+} GemmEpilogue;
+
+/**
+ * @brief Matrix multiplication C = A * B + beta * C
+ *
+ * @param[in] m Number of rows of A and C
+ * @param[in] n Number of columns of B and C
+ * @param[in] k Number of columns of A and rows of B
+ * @param[in] a Row-major matrix A (m x k)
+ * @param[in] lda Leading dimension of A
+ * @param[in] b Row-major matrix B (k x n)
+ * @param[in] ldb Leading dimension of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Row-major matrix C (m x n)
+ * @param[in] ldc Leading dimension of C
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+void gemm_nn(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+);
+
+/**
+ * @brief Matrix multiplication C = A * B^T + beta * C
+ *
+ * @param[in] m Number of rows of A and C
+ * @param[in] n Number of rows of B and columns of C
+ * @param[in] k Number of columns of A and B
+ * @param[in] a Row-major matrix A (m x k)
+ * @param[in] lda Leading dimension of A
+ * @param[in] b Row-major matrix B (n x k)
+ * @param[in] ldb Leading dimension of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Row-major matrix C (m x n)
+ * @param[in] ldc Leading dimension of C
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+void gemm_nt(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+);
+
+/**
+ * @brief Matrix multiplication C = act(A * B^T + bias) with an epilogue
+ *
+ * @param[in] m Number of rows of A and C
+ * @param[in] n Number of rows of B and columns of C
+ * @param[in] k Number of columns of A and B
+ * @param[in] a Row-major matrix A (m x k)
+ * @param[in] lda Leading dimension of A
+ * @param[in] b Row-major matrix B (n x k)
+ * @param[in] ldb Leading dimension of B
+ * @param[out] c Row-major matrix C (m x n)
+ * @param[in] ldc Leading dimension of C
+ * @param[in] epilogue Bias and activation
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+void gemm_nt_epilogue(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    float *c, const int ldc, const GemmEpilogue *epilogue, float *work
+);
+
+/**
+ * @brief Matrix multiplication C = A^T * B + beta * C
+ *
+ * @param[in] m Number of columns of A and rows of C
+ * @param[in] n Number of columns of B and C
+ * @param[in] k Number of rows of A and B
+ * @param[in] a Row-major matrix A (k x m)
+ * @param[in] lda Leading dimension of A
+ * @param[in] b Row-major matrix B (k x n)
+ * @param[in] ldb Leading dimension of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Row-major matrix C (m x n)
+ * @param[in] ldc Leading dimension of C
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+void gemm_tn(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+);
+
+/**
+ * @brief Get the number of elements of a work memory for matrix multiplication
+ *
+ * @param[in] m Number of rows of C
+ * @param[in] n Number of columns of C
+ * @param[in] k Depth of the multiplication
+ * @return Number of elements of a work memory for any kernels,
+ *         an upper bound for gemm_nt which may not use it
+ */
+size_t gemm_work_size(const int m, const int n, const int k);
+
+#endif // GEMM_H
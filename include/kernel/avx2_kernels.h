@@ -0,0 +1,17 @@
+/**
+ * @file avx2_kernels.h
+ * @brief AVX2 and FMA kernels
+ */
+#ifndef AVX2_KERNELS_H
+#define AVX2_KERNELS_H
+
+#include "kernels.h"
+
+/**
+ * @brief Get a table of AVX2 and FMA kernels
+ *
+ * @return Pointer to the kernel table, NULL if not built for x86
+ */
+const Kernels *avx2_kernels(void);
+
+#endif // AVX2_KERNELS_H
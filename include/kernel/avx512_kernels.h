@@ -0,0 +1,17 @@
+/**
+ * @file avx512_kernels.h
+ * @brief AVX-512 kernels
+ */
+#ifndef AVX512_KERNELS_H
+#define AVX512_KERNELS_H
+
+#include "kernels.h"
+
+/**
+ * @brief Get a table of AVX-512 kernels
+ *
+ * @return Pointer to the kernel table, NULL if not built for x86
+ */
+const Kernels *avx512_kernels(void);
+
+#endif // AVX512_KERNELS_H
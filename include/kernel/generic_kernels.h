@@ -0,0 +1,17 @@
+/**
+ * @file generic_kernels.h
+ * @brief Portable C kernels
+ */
+#ifndef GENERIC_KERNELS_H
+#define GENERIC_KERNELS_H
+
+#include "kernels.h"
+
+/**
+ * @brief Get a table of portable C kernels
+ *
+ * @return Pointer to the kernel table
+ */
+const Kernels *generic_kernels(void);
+
+#endif // GENERIC_KERNELS_H
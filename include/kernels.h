@@ -0,0 +1,206 @@
+/**
+ * @file kernels.h
+ * @brief Compute kernels dispatched by CPU features
+ */
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Max. number of rows of a GEMM register tile of all kernels
+ */
+#define KERNELS_MAX_GEMM_MR 6
+
+/**
+ * @brief Max. number of columns of a GEMM register tile of all kernels
+ */
+#define KERNELS_MAX_GEMM_NR 32
+
+/**
+ * @brief Instruction sets of kernel implementations
+ */
+typedef enum KernelsIsa {
+    KERNELS_ISA_GENERIC, //!< Portable C, SSE2 on x86-64
+    KERNELS_ISA_AVX2, //!< AVX2 and FMA
+    KERNELS_ISA_AVX512 //!< AVX-512F
+} KernelsIsa;
+
+/**
+ * @brief Coefficients of an Adam update of a step
+ */
+typedef struct AdamCoeffs {
+    float learning_rate; //!< Learning rate
+    float beta1; //!< Decay rate of the 1st moment
+    float beta2; //!< Decay rate of the 2nd moment
+    float eps; //!< Term added to the denominator
+    float weight_decay; //!< Decoupled weight decay, 0 for Adam
+    float bias1; //!< 1 / (1 - beta1^t), correction of the 1st moment
+    float bias2; //!< 1 / sqrt(1 - beta2^t), correction of the 2nd moment
+} AdamCoeffs;
+
+/**
+ * @brief Table of compute kernels for an instruction set
+ */
+typedef struct Kernels {
+    KernelsIsa isa; //!< Instruction set
+    int gemm_mr; //!< Number of rows of a GEMM register tile, up to KERNELS_MAX_GEMM_MR
+    int gemm_nr; //!< Number of columns of a GEMM register tile, up to KERNELS_MAX_GEMM_NR
+
+    /**
+     * @brief Multiply packed panels into a register tile, C = A * B + beta * C
+     *
+     * @param[in] kc Depth of the panels
+     * @param[in] ap Panel of A, gemm_mr elements for each depth
+     * @param[in] bp Panel of B, gemm_nr elements for each depth
+     * @param[in] beta Scale of C before accumulation, C is not read if 0
+     * @param[in,out] c Top-left element of the tile
+     * @param[in] ldc Leading dimension of C
+     * @param[in] mr Number of valid rows of the tile
+     * @param[in] nr Number of valid columns of the tile
+     */
+    void (*gemm)(const int, const float*, const float*, const float, float*, const int, const int, const int);
+
+    /**
+     * @brief Dot product of 2 vectors
+     *
+     * @param[in] x Vector
+     * @param[in] y Vector
+     * @param[in] size Number of elements
+     * @return Dot product
+     */
+    float (*dot)(const float*, const float*, const int);
+
+    /**
+     * @brief Add a bias to each row of a matrix
+     *
+     * @param[in,out] y Row-major matrix
+     * @param[in] b Bias vector
+     * @param[in] rows Number of rows
+     * @param[in] cols Number of columns, elements of the bias
+     */
+    void (*add_bias)(float*, const float*, const int, const int);
+
+    /**
+     * @brief Elementwise exp(x) by a polynomial approximation
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input vector
+     * @param[in] size Number of elements
+     * @note Max. error is 2 ULP in [-87, 88], x is clamped into the range by all kernels,
+     *       so results out of it do not depend on the instruction set
+     */
+    void (*exp)(float*, const float*, const int);
+
+    /**
+     * @brief Elementwise natural log(x) by a polynomial approximation
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input vector
+     * @param[in] size Number of elements
+     * @note Max. error is 1 ULP for positive x including denormals
+     */
+    void (*log)(float*, const float*, const int);
+
+    /**
+     * @brief Elementwise sigmoid by the approximate exp(x)
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input vector
+     * @param[in] size Number of elements
+     * @note Max. error is 4 ULP in [-80, 80]
+     */
+    void (*sigmoid)(float*, const float*, const int);
+
+    /**
+     * @brief Softmax of a vector
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input vector
+     * @param[in] size Number of elements
+     */
+    void (*softmax)(float*, const float*, const int);
+
+    /**
+     * @brief Gradient of the input of softmax, gx = y * (gy - dot(gy, y))
+     *
+     * @param[out] gx Gradient of the input vector
+     * @param[in] y Output vector of softmax
+     * @param[in] gy Gradient of the output vector
+     * @param[in] size Number of elements
+     */
+    void (*softmax_grad)(float*, const float*, const float*, const int);
+
+    /**
+     * @brief Update of SGD, w -= lr * g
+     *
+     * @param[in,out] w Parameter vector
+     * @param[in] g Gradient vector
+     * @param[in] size Number of elements
+     * @param[in] learning_rate Learning rate
+     */
+    void (*sgd)(float*, const float*, const int, const float);
+
+    /**
+     * @brief Update of SGD with momentum, v = mu * v + g, w -= lr * v
+     *
+     * @param[in,out] w Parameter vector
+     * @param[in,out] v Velocity vector
+     * @param[in] g Gradient vector
+     * @param[in] size Number of elements
+     * @param[in] learning_rate Learning rate
+     * @param[in] momentum Momentum factor mu
+     * @param[in] nesterov Nesterov momentum, w -= lr * (g + mu * v) instead
+     */
+    void (*momentum)(
+        float*, float*, const float*, const int, const float, const float, const bool
+    );
+
+    /**
+     * @brief Update of Adam, RMSProp without the 1st moment
+     *
+     * @param[in,out] w Parameter vector
+     * @param[in,out] m 1st moment vector, NULL to use the gradient as is
+     * @param[in,out] v 2nd moment vector
+     * @param[in] g Gradient vector
+     * @param[in] size Number of elements
+     * @param[in] coeffs Coefficients of the step
+     */
+    void (*adam)(float*, float*, float*, const float*, const int, const AdamCoeffs*);
+
+    /**
+     * @brief Convert unsigned bytes to floats with a scale, y = x * scale
+     *
+     * @param[out] y Output vector
+     * @param[in] x Input bytes
+     * @param[in] size Number of elements
+     * @param[in] scale Scale, e.g. 1/255 to normalize pixels to [0,1]
+     */
+    void (*u8_to_float)(float*, const uint8_t*, const int, const float);
+} Kernels;
+
+/**
+ * @brief Select the best kernels for the running CPU
+ * @note Called by kernels() if none have been selected yet
+ */
+void kernels_init(void);
+
+/**
+ * @brief Select kernels of a specified instruction set
+ *
+ * @param[in] isa Instruction set
+ * @return true if selected, false if not supported by the CPU or the build
+ * @note Kernels are shared by all networks, select them before running any
+ */
+bool kernels_select(const KernelsIsa isa);
+
+/**
+ * @brief Get the selected kernels
+ *
+ * @return Pointer to the kernel table
+ * @note Select the best kernels if none have been selected yet, safe to call from any thread
+ */
+const Kernels *kernels(void);
+
+#endif // KERNELS_H
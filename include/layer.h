@@ -8,6 +8,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "vmath.h"
+
 /**
  * @brief Type of network layers
  */
@@ -26,15 +28,37 @@ typedef struct LayerParams {
     int batch_size; //!< Number of batches
     int in; //!< Number of input elements
     int out; //!< Number of output elements
+    bool unfused; //!< Keep the next layer separate, otherwise it is fused if possible
 } LayerParams;
 
+/**
+ * @brief Number of elements of layer buffers, 0 if not used
+ */
+typedef struct LayerSizes {
+    size_t y; //!< Output matrix
+    size_t w; //!< Weight matrix
+    size_t b; //!< Bias matrix
+
+    size_t gx; //!< Gradient of input matrix
+    size_t gw; //!< Gradient of weight matrix
+    size_t gb; //!< Gradient of bias matrix
+    size_t gz; //!< Gradient of output matrix before a fused activation
+
+    size_t forward_scratch; //!< Work memory used in forward
+    size_t backward_scratch; //!< Work memory used in backward
+} LayerSizes;
+
 /**
  * @brief Network layer
  */
 typedef struct Layer {
     LayerParams params;  //!< Layer parameters
+    LayerSizes sizes; //!< Sizes of buffers, set by initialization
+    int batch; //!< Number of samples of the current batch, up to the batch size
+    bool accumulate; //!< Add gradients of parameters in backward, otherwise overwrite them
+    MathPrecision precision; //!< Accuracy of math functions, fast by default
 
-    float *x; //!< Input matrix
+    const float *x; //!< Input matrix borrowed in forward, NULL if not used in backward
     float *y; //!< Output matrix
     float *w; //!< Weight matrix
     float *b; //!< Bias matrix
@@ -42,6 +66,8 @@ typedef struct Layer {
     float *gx; //!< Gradient of input matrix
     float *gw; //!< Gradient of weight matrix
     float *gb; //!< Gradient of bias matrix
+    float *gz; //!< Gradient of output matrix before a fused activation
+    float *scratch; //!< Work memory of forward and backward, shared by layers of a network
 
     /**
      * @brief Forward of the layer
@@ -60,22 +86,26 @@ typedef struct Layer {
      * @return Pointer to gradient of the layer input
      */
     float* (*backward)(struct Layer*, const float*);  //!< Backward
+
+    /**
+     * @brief Fuse the next layer into the layer, NULL if nothing can be fused
+     *
+     * @param[in,out] layer Layer
+     * @param[in,out] next Next layer, passes its input through if fused
+     * @return true if fused, otherwise false
+     * @note Called before buffers are allocated, sizes of both layers may change
+     */
+    bool (*fuse)(struct Layer*, struct Layer*); //!< Fusion
 } Layer;
 
 /**
- * @brief Allocate layer parameters
+ * @brief Initialize a layer and set sizes of its buffers
  *
  * @param[in,out] layer Pointer to a layer
  * @return Pointer to the layer, NULL if failed
+ * @note Buffers are not allocated, a network assigns them from its arena
  */
-Layer *layer_alloc_params(Layer *layer);
-
-/**
- * @brief Free layer parameters
- *
- * @param[in,out] layer Pointer to a layer
- */
-void layer_free_params(Layer *layer);
+Layer *layer_init(Layer *layer);
 
 /**
  * @brief Connect 2 layers
@@ -101,16 +131,11 @@ float *layer_forward(Layer *layer, const float *x);
  * @param[in,out] layer Layer
  * @param[in] gy A gradient of the next layer
  * @return Pointer to gradient of the input of the layer
+ * @note Gradients of parameters are overwritten, or added if accumulate is set.
+ *       Gradient of the input is always overwritten
  */
 float *layer_backward(Layer *layer, const float *gy);
 
-/**
- * @brief Clear current gradients of layer
- *
- * @param[in,out] layer Pointer to the layer
- */
-void layer_clear_grad(Layer *layer);
-
 /**
  * @brief Initialization functions for each layer
  */
@@ -8,7 +8,7 @@
 #include "layer.h"
 
 /**
- * @brief Allocate a fully connected layer
+ * @brief Initialize a fully connected layer
  * 
  * @param[in,out] layer Pointer to a layer
  * @return Pointer to the layer, NULL if failed
@@ -8,7 +8,7 @@
 #include "layer.h"
 
 /**
- * @brief Allocate a sigmoid layer
+ * @brief Initialize a sigmoid layer
  * 
  * @param[in,out] layer Pointer to a layer
  * @return Pointer to the layer, NULL if failed
@@ -8,7 +8,7 @@
 #include "layer.h"
 
 /**
- * @brief Allocate a softmax layer
+ * @brief Initialize a softmax layer
  * 
  * @param[in,out] layer Pointer to a layer
  * @return Pointer to the layer, NULL if failed
@@ -7,6 +7,8 @@
 
 #include <stddef.h>
 
+#include "vmath.h"
+
 /**
  * @brief Loss funcion interface
  */
@@ -18,9 +20,10 @@ typedef struct LossFunc {
      * @param[in] t Expected data
      * @param[in] batch_size Batch size of data
      * @param[in] size Size of data
+     * @param[in] precision Accuracy of math functions
      * @return float Loss
      */
-    float (*forward)(const float*, const float*, const size_t, const size_t);
+    float (*forward)(const float*, const float*, const size_t, const size_t, const MathPrecision);
 
     /**
      * @brief Backward of the loss
@@ -30,8 +33,43 @@ typedef struct LossFunc {
      * @param[in] t Expected data
      * @param[in] batch_size Batch size of data
      * @param[in] size Size of data
+     * @param[in] precision Accuracy of math functions, the same as forward
      */
-    void (*backward)(float*, const float*, const float*, const size_t, const size_t);
+    void (*backward)(
+        float*, const float*, const float*, const size_t, const size_t, const MathPrecision
+    );
 } LossFunc;
 
+/**
+ * @brief Loss funcion interface for class indices of expected data
+ */
+typedef struct SparseLossFunc {
+    /**
+     * @brief Loss function
+     *
+     * @param[in] y Predicted data
+     * @param[in] t Expected class indices, one for each batch
+     * @param[in] batch_size Batch size of data
+     * @param[in] size Size of data, the number of classes
+     * @param[in] precision Accuracy of math functions
+     * @return float Loss, NAN if a class index is not in [0, size)
+     */
+    float (*forward)(const float*, const int*, const size_t, const size_t, const MathPrecision);
+
+    /**
+     * @brief Backward of the loss
+     *
+     * @param[out] grad Gradient of loss function by the output
+     * @param[in] y Predicted data
+     * @param[in] t Expected class indices, one for each batch
+     * @param[in] batch_size Batch size of data
+     * @param[in] size Size of data, the number of classes
+     * @param[in] precision Accuracy of math functions, the same as forward
+     * @note A class index not in [0, size) adds no term of the expected class
+     */
+    void (*backward)(
+        float*, const float*, const int*, const size_t, const size_t, const MathPrecision
+    );
+} SparseLossFunc;
+
 #endif // LOSS_H
@@ -0,0 +1,18 @@
+/**
+ * @file softmax_ce_loss.h
+ * @brief Softmax cross entropy loss
+ */
+#ifndef SOFTMAX_CE_LOSS_H
+#define SOFTMAX_CE_LOSS_H
+
+#include "loss.h"
+
+/**
+ * @brief Cross entropy loss of softmax of logits
+ *
+ * @return LossFunc Loss function
+ * @note Predicted data are logits, an output of the network without softmax
+ */
+LossFunc softmax_ce_loss(void);
+
+#endif // SOFTMAX_CE_LOSS_H
@@ -0,0 +1,18 @@
+/**
+ * @file sparse_ce_loss.h
+ * @brief Cross entropy loss for class indices
+ */
+#ifndef SPARSE_CE_LOSS_H
+#define SPARSE_CE_LOSS_H
+
+#include "loss.h"
+
+/**
+ * @brief Cross entropy loss for class indices
+ *
+ * @return SparseLossFunc Loss function
+ * @note Only the probability of the expected class is read for each batch
+ */
+SparseLossFunc sparse_ce_loss(void);
+
+#endif // SPARSE_CE_LOSS_H
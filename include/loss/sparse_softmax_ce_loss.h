@@ -0,0 +1,18 @@
+/**
+ * @file sparse_softmax_ce_loss.h
+ * @brief Softmax cross entropy loss for class indices
+ */
+#ifndef SPARSE_SOFTMAX_CE_LOSS_H
+#define SPARSE_SOFTMAX_CE_LOSS_H
+
+#include "loss.h"
+
+/**
+ * @brief Cross entropy loss of softmax of logits for class indices
+ *
+ * @return SparseLossFunc Loss function
+ * @note Predicted data are logits, an output of the network without softmax
+ */
+SparseLossFunc sparse_softmax_ce_loss(void);
+
+#endif // SPARSE_SOFTMAX_CE_LOSS_H
@@ -11,5 +11,8 @@
 
 #include "loss/bce_loss.h"
 #include "loss/ce_loss.h"
+#include "loss/softmax_ce_loss.h"
+#include "loss/sparse_ce_loss.h"
+#include "loss/sparse_softmax_ce_loss.h"
 
 #endif // LOSSES_H
@@ -5,6 +5,10 @@
 #ifndef NET_H
 #define NET_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "layer.h"
 
 /**
@@ -13,12 +17,34 @@
  */
 #define LAYER_PARAMS_LIST(...) (LayerParams[]){ __VA_ARGS__, (LayerParams){ .type=LAYER_TYPE_NONE } }
 
+/**
+ * @brief Memory usage in bytes
+ */
+typedef struct MemoryStats {
+    size_t params; //!< Parameters
+    size_t grads; //!< Gradients of parameters and inputs
+    size_t activations; //!< Inputs and outputs of layers
+    size_t scratch; //!< Work memory shared by layers in forward and backward
+} MemoryStats;
+
 /**
  * @brief Network structure
  */
 typedef struct Net {
     int size; //!< The number of layers
     Layer *layers; //!< Layers
+    bool inference; //!< Inference only, without gradients and cached inputs
+    bool shared_params; //!< Parameters are borrowed from another network, not in the arena
+
+    float *arena; //!< Single memory block of all layer buffers
+    size_t arena_size; //!< Number of elements of the arena
+
+    float *params; //!< Parameters of all layers, the first region of the arena
+    float *grads; //!< Gradients of parameters in the same layout, followed by input gradients
+    float *output_grad; //!< Gradient of the network output given to backward by a trainer
+    size_t num_params; //!< Number of elements of the parameter region
+    size_t num_grads; //!< Number of elements of the gradient region
+    size_t num_scratch; //!< Number of elements of the work region, the last region of the arena
 } Net;
 
 /**
@@ -52,28 +78,113 @@ Layer *net_input(const Net *net);
  */
 Layer *net_output(const Net *net);
 
+/**
+ * @brief Get all parameters of the network as a flat vector
+ *
+ * @param[in] net Network
+ * @return Pointer to the parameters, padded for alignment between buffers
+ * @note Padding elements are kept 0 and can be updated with the parameters
+ */
+float *net_params(const Net *net);
+
+/**
+ * @brief Get gradients of all parameters as a flat vector
+ *
+ * @param[in] net Network
+ * @return Pointer to the gradients, in the same layout with the parameters
+ */
+float *net_grads(const Net *net);
+
+/**
+ * @brief Get the number of elements of the flat parameters
+ *
+ * @param[in] net Network
+ * @return Number of elements, including padding
+ */
+size_t net_num_params(const Net *net);
+
 /**
  * @brief Allocate network layers on the heap
  *
  * @param[in,out] net Network
  * @param[in] param_list List of layer parameters
  * @return Pointer to the network, NULL if failed
+ * @note Sizes of all buffers are planned first, then they are carved from
+ *       a single 64-byte aligned arena with regions of parameters, gradients
+ *       and activations. A layer may fuse the next one unless unfused is set,
+ *       the fused layer has the same output as the previous one
  */
 Net *net_alloc_layers(Net *net, LayerParams *param_list);
 
 /**
- * @brief Free network layers allocated on the heap
+ * @brief Allocate network layers only for inference on the heap
+ *
+ * @param[in,out] net Network
+ * @param[in] param_list List of layer parameters
+ * @return Pointer to the network, NULL if failed
+ * @note Gradients and inputs cached for backward are not allocated,
+ *       and layers read their inputs directly. Backward of the network fails.
+ *       Outputs of layers share buffers by their lifetimes, so only the output
+ *       of the last layer is valid after forward
+ */
+Net *net_alloc_inference(Net *net, LayerParams *param_list);
+
+/**
+ * @brief Allocate a replica of a network sharing its parameters
+ *
+ * @param[in,out] replica Replica
+ * @param[in] net Network for training, whose layers and parameters are shared
+ * @return Pointer to the replica, NULL if failed
+ * @note The replica has its own gradients and activations, for backward of other
+ *       samples in parallel. Free the replica before the network
+ */
+Net *net_alloc_replica(Net *replica, const Net *net);
+
+/**
+ * @brief Free network layers and the arena allocated on the heap
  *
  * @param[in,out] net Network
  */
 void net_free_layers(Net *net);
 
+/**
+ * @brief Get memory usage of a network
+ *
+ * @param[in] net Network
+ * @param[out] layer_stats Array of usage of each layer, can be NULL
+ * @return Total usage of the network
+ * @note Buffers include padding for alignment. A buffer shared in inference
+ *       is counted for each layer using it but only once in the total.
+ *       Parameters of a replica are not counted, they are of the network.
+ *       Scratch of the total is the work region shared by layers, as they run one by one
+ */
+MemoryStats net_memory_stats(const Net *net, MemoryStats *layer_stats);
+
+/**
+ * @brief Set the number of threads to run layers of all networks
+ *
+ * @param[in] num_threads Number of threads, including the calling thread
+ * @return true if succeeded, otherwise false
+ * @note Threads are kept until the number is set again, set 1 to free them
+ */
+bool net_set_num_threads(const int num_threads);
+
+/**
+ * @brief Set the accuracy of math functions of all layers of a network
+ *
+ * @param[in,out] net Network
+ * @param[in] precision Accuracy, fast approximations after allocation
+ */
+void net_set_precision(Net *net, const MathPrecision precision);
+
 /**
  * @brief Initialize network parameters
  *
  * @param[in,out] net Network
+ * @param[in] seed Seed of random weights, the same seed gives the same parameters
+ * @note Weights are filled in parallel by chunks, each chunk has its own random stream
  */
-void net_init_params(Net *net);
+void net_init_params(Net *net, const uint64_t seed);
 
 /**
  * @brief Forward propagation of network
@@ -81,22 +192,52 @@ void net_init_params(Net *net);
  * @param[in,out] net Network
  * @param[in] x Network input
  * @return Pointer to the network output, NULL if failed
+ * @note The input is borrowed, not copied, keep it unchanged until the following backward
  */
 float *net_forward(Net *net, const float *x);
 
+/**
+ * @brief Forward propagation of network for a smaller batch
+ *
+ * @param[in,out] net Network
+ * @param[in] x Network input of n samples
+ * @param[in] n Number of samples, from 1 to the batch size of the network
+ * @return Pointer to the network output of n samples, NULL if failed
+ * @note Buffers of the network are reused, the following backward is run
+ *       for the same samples. The input is borrowed as net_forward
+ */
+float *net_forward_batch(Net *net, const float *x, const int n);
+
 /**
  * @brief Backward propagation of network
  *
  * @param[in,out] net Network
  * @param[in] dy Gradient of network output
- * @return Pointer to gradient of an input of the network, NULL if failed
+ * @return Pointer to gradient of an input of the network,
+ *         NULL if failed or the network is only for inference
+ * @note Samples are the ones of the last forward.
+ *       Gradients of parameters are overwritten, net_clear_grad is not needed
  */
 float *net_backward(Net *net, const float *dy);
 
+/**
+ * @brief Backward propagation of network adding to the current gradients
+ *
+ * @param[in,out] net Network
+ * @param[in] dy Gradient of network output
+ * @return Pointer to gradient of an input of the network,
+ *         NULL if failed or the network is only for inference
+ * @note Gradients of parameters are summed over calls, e.g. for micro-batches
+ *       after net_backward or net_clear_grad
+ */
+float *net_backward_accumulate(Net *net, const float *dy);
+
 /**
  * @brief Clear current gradients of network
  *
  * @param[in,out] net Network
+ * @note Only needed before net_backward_accumulate without a net_backward.
+ *       Gradients of all layers are a single region of the arena, which is cleared at once
  */
 void net_clear_grad(Net *net);
 
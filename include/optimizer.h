@@ -0,0 +1,87 @@
+/**
+ * @file optimizer.h
+ * @brief Optimizers updating all parameters of a network
+ */
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stddef.h>
+
+#include "net.h"
+
+/**
+ * @brief Type of optimizers
+ */
+typedef enum OptimizerType {
+    OPTIMIZER_TYPE_SGD, //!< Plain SGD
+    OPTIMIZER_TYPE_MOMENTUM, //!< SGD with momentum
+    OPTIMIZER_TYPE_NESTEROV, //!< SGD with Nesterov momentum
+    OPTIMIZER_TYPE_RMSPROP, //!< RMSProp
+    OPTIMIZER_TYPE_ADAM, //!< Adam
+    OPTIMIZER_TYPE_ADAMW //!< Adam with decoupled weight decay
+} OptimizerType;
+
+/**
+ * @brief Parameters of an optimizer
+ * @note Used as given, start from optimizer_params_default() to take defaults
+ */
+typedef struct OptimizerParams {
+    OptimizerType type; //!< Optimizer type
+    float learning_rate; //!< Learning rate
+    float momentum; //!< Momentum factor of momentum and Nesterov, 0.9 by default
+    float beta1; //!< Decay rate of the 1st moment of Adam(W), 0.9 by default
+    float beta2; //!< Decay rate of the 2nd moment, 0.999 for Adam(W), 0.99 for RMSProp
+    float eps; //!< Term added to the denominator of RMSProp and Adam(W), 1e-8 by default
+    float weight_decay; //!< Decoupled weight decay of AdamW, 0.01 by default
+} OptimizerParams;
+
+/**
+ * @brief Optimizer
+ */
+typedef struct Optimizer {
+    OptimizerParams params; //!< Optimizer parameters
+    size_t size; //!< Number of elements of parameters of the network
+    int steps; //!< Number of steps taken, for bias correction
+
+    float *state; //!< Single allocation of state buffers, NULL for plain SGD
+    float *m; //!< Velocity or 1st moment, NULL if not used
+    float *v; //!< 2nd moment, NULL if not used
+} Optimizer;
+
+/**
+ * @brief Default parameters of an optimizer
+ *
+ * @param[in] type Optimizer type
+ * @param[in] learning_rate Learning rate
+ * @return Parameters with default hyperparameters of the type
+ */
+OptimizerParams optimizer_params_default(const OptimizerType type, const float learning_rate);
+
+/**
+ * @brief Allocate an optimizer for a network
+ *
+ * @param[in,out] optimizer Optimizer
+ * @param[in] net Network allocated for training
+ * @param[in] params Optimizer parameters
+ * @return Pointer to the optimizer, NULL if failed
+ * @note State buffers are cleared and aligned to a cache line
+ */
+Optimizer *optimizer_alloc(Optimizer *optimizer, const Net *net, const OptimizerParams params);
+
+/**
+ * @brief Free state buffers of an optimizer
+ *
+ * @param[in,out] optimizer Optimizer
+ */
+void optimizer_free(Optimizer *optimizer);
+
+/**
+ * @brief Update all parameters of a network by their gradients
+ *
+ * @param[in,out] optimizer Optimizer
+ * @param[in,out] net Network, the same one given at allocation
+ * @note Parameters and gradients are seen as flat vectors, updated in parallel
+ */
+void optimizer_step(Optimizer *optimizer, Net *net);
+
+#endif // OPTIMIZER_H
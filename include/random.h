@@ -1,26 +1,86 @@
 /**
  * @file random.h
- * @brief Simple PRNG
+ * @brief Seedable PRNG with explicit states
  */
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief State of a xoshiro256+ generator
+ * @note A state is used by a thread at a time, give each thread its own stream
+ */
+typedef struct RandomState {
+    uint64_t s[4]; //!< State words
+    float spare; //!< Second output of the last Box-Muller transform of rand_norm
+    bool has_spare; //!< The spare output is not returned yet
+} RandomState;
+
+/**
+ * @brief Seed a generator
+ *
+ * @param[out] state State
+ * @param[in] seed Seed
+ * @param[in] stream Index of an independent stream of the seed, e.g. a thread or a chunk
+ * @note The same seed and stream give the same sequence
+ */
+void rand_seed(RandomState *state, const uint64_t seed, const uint64_t stream);
+
+/**
+ * @brief Get the next 64 random bits
+ *
+ * @param[in,out] state State
+ * @return Random bits, the upper bits are the best ones
+ */
+uint64_t rand_next(RandomState *state);
+
 /**
  * @brief Get a random value from a uniform distribution
- * 
- * @return float Random value within [0, 1)
- * @note Need to initialize by srand in stdlib.h beforehand
+ *
+ * @param[in,out] state State
+ * @return Random value within [0, 1)
  */
-float rand_uniform(void);
+float rand_uniform(RandomState *state);
 
 /**
  * @brief Get a random value from a normal distribution
- * 
+ *
+ * @param[in,out] state State
+ * @param[in] mean Mean of the distribution
+ * @param[in] stddev Std. dev. for the distribution
+ * @return Random value
+ * @note Both outputs of a Box-Muller transform are used by 2 calls
+ */
+float rand_norm(RandomState *state, const float mean, const float stddev);
+
+/**
+ * @brief Fill a vector with random values from a uniform distribution
+ *
+ * @param[in,out] state State
+ * @param[out] y Vector
+ * @param[in] size Number of elements
+ * @param[in] low Lower bound, included
+ * @param[in] high Upper bound, excluded
+ */
+void rand_fill_uniform(
+    RandomState *state, float *y, const size_t size, const float low, const float high
+);
+
+/**
+ * @brief Fill a vector with random values from a normal distribution
+ *
+ * @param[in,out] state State
+ * @param[out] y Vector
+ * @param[in] size Number of elements
  * @param[in] mean Mean of the distribution
  * @param[in] stddev Std. dev. for the distribution
- * @return float Random value
- * @note Need to initialize by srand in stdlib.h beforehand
+ * @note Box-Muller transforms are run on blocks, both outputs of each are used
  */
-float rand_norm(const float mean, const float stddev);
+void rand_fill_norm(
+    RandomState *state, float *y, const size_t size, const float mean, const float stddev
+);
 
 #endif // RANDOM_H
@@ -0,0 +1,49 @@
+/**
+ * @file sampler.h
+ * @brief Sampler of shuffled indices of epochs
+ */
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "random.h"
+
+/**
+ * @brief Sampler of a permutation of samples for each epoch
+ */
+typedef struct Sampler {
+    size_t num_samples; //!< Number of samples
+    size_t *indices; //!< Permutation of the current epoch
+    RandomState random; //!< State of the PRNG
+} Sampler;
+
+/**
+ * @brief Allocate a sampler
+ *
+ * @param[out] sampler Sampler
+ * @param[in] num_samples Number of samples
+ * @param[in] seed Seed, the same seed gives the same permutations
+ * @return Pointer to the sampler, NULL if failed
+ * @note Indices are in order until the first shuffle
+ */
+Sampler *sampler_alloc(Sampler *sampler, const size_t num_samples, const uint64_t seed);
+
+/**
+ * @brief Free a sampler
+ *
+ * @param[in,out] sampler Sampler
+ */
+void sampler_free(Sampler *sampler);
+
+/**
+ * @brief Shuffle indices for the next epoch
+ *
+ * @param[in,out] sampler Sampler
+ * @return Pointer to the permutation of all samples
+ * @note The previous permutation is shuffled again by Fisher-Yates in place
+ */
+const size_t *sampler_shuffle(Sampler *sampler);
+
+#endif // SAMPLER_H
@@ -0,0 +1,50 @@
+/**
+ * @file thread_pool.h
+ * @brief Persistent thread pool for parallel loops
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Task of a parallel loop
+ *
+ * @param[in,out] arg Argument of the task
+ * @param[in] begin First index of a range
+ * @param[in] end Index next to the last one of the range
+ */
+typedef void (*ThreadPoolTask)(void*, const int, const int);
+
+/**
+ * @brief Set the number of threads, including the calling thread
+ *
+ * @param[in] num_threads Number of threads, 1 to run loops serially
+ * @return true if succeeded, otherwise false and the pool runs serially
+ * @note Workers are created here and parked between loops,
+ *       set 1 to join all of them before exit
+ */
+bool thread_pool_set_num_threads(const int num_threads);
+
+/**
+ * @brief Get the number of threads, including the calling thread
+ *
+ * @return Number of threads
+ */
+int thread_pool_num_threads(void);
+
+/**
+ * @brief Run a task over [0, size) in parallel
+ *
+ * @param[in] size Number of indices
+ * @param[in] grain Min. number of indices of a range given to a task
+ * @param[in] task Task to be run for each range
+ * @param[in,out] arg Argument of the task
+ * @note Return after all ranges are done.
+ *       A loop is run serially if the pool is busy, e.g. a nested loop
+ */
+void thread_pool_parallel_for(
+    const int size, const int grain, ThreadPoolTask task, void *arg
+);
+
+#endif // THREAD_POOL_H
@@ -5,14 +5,152 @@
 #ifndef TRAINER_H
 #define TRAINER_H
 
+#include "loss.h"
 #include "net.h"
 
+/**
+ * @brief Data-parallel training over replicas of a network
+ */
+typedef struct DataParallel {
+    Net *net; //!< Network trained, whose gradients are reduced from all replicas
+    int num_replicas; //!< Number of replicas, including the network
+    Net *replicas; //!< Replicas other than the network, sharing its parameters
+} DataParallel;
+
 /**
  * @brief Train a network in one step
  *
  * @param[in,out] net Target network
  * @param[in] learning_rate Learning rate
+ * @note Gradients are used as is, the mean over a batch computed by backward
+ *       or train_accumulate
  */
 void train_step(Net *net, const float learning_rate);
 
+/**
+ * @brief Compute gradients of a batch larger than the network by micro-batches
+ *
+ * @param[in,out] net Target network
+ * @param[in] x Inputs of the batch
+ * @param[in] t Expected outputs of the batch
+ * @param[in] batch_size Number of samples of the batch, the effective batch size
+ * @param[in] loss_func Loss function
+ * @return Mean loss of the batch, NAN if failed
+ * @note The batch is split into micro-batches of the network batch size.
+ *       Only activations of a micro-batch are kept, gradients of parameters
+ *       are the mean over the whole batch, ready for one step of an optimizer
+ */
+float train_accumulate(
+    Net *net, const float *x, const float *t, const int batch_size, const LossFunc loss_func
+);
+
+/**
+ * @brief Compute gradients of a batch of class indices by micro-batches
+ *
+ * @param[in,out] net Target network
+ * @param[in] x Inputs of the batch
+ * @param[in] t Expected class indices of the batch
+ * @param[in] batch_size Number of samples of the batch, the effective batch size
+ * @param[in] loss_func Loss function for class indices
+ * @return Mean loss of the batch, NAN if failed
+ * @note The same as train_accumulate
+ */
+float train_accumulate_sparse(
+    Net *net, const float *x, const int *t, const int batch_size, const SparseLossFunc loss_func
+);
+
+/**
+ * @brief Allocate replicas of a network for data-parallel training
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in,out] net Network for training
+ * @param[in] num_replicas Number of replicas including the network, e.g. the number of threads
+ * @return Pointer to the data-parallel training, NULL if failed
+ * @note Each replica has gradients and activations of the network batch size,
+ *       parameters are a single copy in the network
+ */
+DataParallel *train_data_parallel_alloc(DataParallel *dp, Net *net, const int num_replicas);
+
+/**
+ * @brief Free replicas of data-parallel training
+ *
+ * @param[in,out] dp Data-parallel training
+ * @note The network is not freed
+ */
+void train_data_parallel_free(DataParallel *dp);
+
+/**
+ * @brief Compute gradients of a batch split across replicas in parallel
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of the batch
+ * @param[in] t Expected outputs of the batch
+ * @param[in] batch_size Number of samples of the batch
+ * @param[in] loss_func Loss function
+ * @return Mean loss of the batch, NAN if failed
+ * @note Each replica accumulates a shard of the batch by micro-batches on a thread
+ *       of the thread pool, then gradients of parameters are reduced into the network
+ *       by a tree. They are the mean over the batch, ready for train_step.
+ *       Layers of a replica run serially, threads are taken by replicas
+ */
+float train_data_parallel(
+    DataParallel *dp, const float *x, const float *t, const int batch_size,
+    const LossFunc loss_func
+);
+
+/**
+ * @brief Compute gradients of a batch of class indices split across replicas in parallel
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of the batch
+ * @param[in] t Expected class indices of the batch
+ * @param[in] batch_size Number of samples of the batch
+ * @param[in] loss_func Loss function for class indices
+ * @return Mean loss of the batch, NAN if failed
+ * @note The same as train_data_parallel
+ */
+float train_data_parallel_sparse(
+    DataParallel *dp, const float *x, const int *t, const int batch_size,
+    const SparseLossFunc loss_func
+);
+
+/**
+ * @brief Train replicas asynchronously by SGD without locks, Hogwild!
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of samples, e.g. an epoch
+ * @param[in] t Expected outputs of the samples
+ * @param[in] num_samples Number of samples
+ * @param[in] learning_rate Learning rate
+ * @param[in] loss_func Loss function
+ * @return Mean loss of the samples at the time each one is trained, NAN if failed
+ * @note Each replica trains a contiguous shard of samples by micro-batches on a thread,
+ *       and updates the shared parameters by train_step after each micro-batch.
+ *       Updates are plain loads and stores racing with other threads: an update may be
+ *       lost or a replica may read parameters in the middle of another update.
+ *       SGD tolerates them when updates rarely collide, e.g. for sparse gradients.
+ *       Gradients of the network are left of its own last micro-batch
+ */
+float train_hogwild(
+    DataParallel *dp, const float *x, const float *t, const int num_samples,
+    const float learning_rate, const LossFunc loss_func
+);
+
+/**
+ * @brief Train replicas asynchronously by SGD without locks for class indices
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of samples, e.g. an epoch
+ * @param[in] t Expected class indices of the samples
+ * @param[in] num_samples Number of samples
+ * @param[in] learning_rate Learning rate
+ * @param[in] loss_func Loss function for class indices
+ * @return Mean loss of the samples at the time each one is trained, NAN if failed
+ * @note The same as train_hogwild
+ */
+float train_hogwild_sparse(
+    DataParallel *dp, const float *x, const int *t, const int num_samples,
+    const float learning_rate, const SparseLossFunc loss_func
+);
+
 #endif // TRAINER_H
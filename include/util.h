@@ -5,25 +5,6 @@
 #ifndef UTIL_H
 #define UTIL_H
 
-#include <stddef.h>
-
-/**
- * @brief Allocate a 2-D float memory for a dataset
- *
- * @param[in] size Number of samples in a dataset
- * @param[in] elem_size Number of elements in one sample
- * @return Pointer to the allocated memory, NULL if failed
- */
-float **alloc_dataset(const size_t size, const int elem_size);
-
-/**
- * @brief Free a 2-D float memory for a dataset
- *
- * @param[in,out] dataset Pointer to a memory for a dataset
- * @param[in] size Number of samples in a dataset
- */
-void free_dataset(float ***dataset, const size_t size);
-
 /**
  * @brief Get an index of the max. element in a vector
  * 
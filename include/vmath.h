@@ -0,0 +1,71 @@
+/**
+ * @file vmath.h
+ * @brief Vectorized math functions with a selectable accuracy
+ */
+#ifndef VMATH_H
+#define VMATH_H
+
+/**
+ * @brief Accuracy of math functions
+ */
+typedef enum MathPrecision {
+    MATH_PRECISION_FAST, //!< Polynomial approximations of the kernels, a few ULP
+    MATH_PRECISION_ACCURATE //!< libm, correctly rounded in most cases
+} MathPrecision;
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ * @param[in] precision Accuracy
+ * @note Max. error of the fast one is 2 ULP in [-87, 88], x is clamped into the range
+ */
+void vmath_exp(float *y, const float *x, const int size, const MathPrecision precision);
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ * @param[in] precision Accuracy
+ * @note Max. error of the fast one is 1 ULP for positive x
+ */
+void vmath_log(float *y, const float *x, const int size, const MathPrecision precision);
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ * @param[in] precision Accuracy
+ * @note Max. error of the fast one is 4 ULP in [-80, 80]
+ */
+void vmath_sigmoid(float *y, const float *x, const int size, const MathPrecision precision);
+
+/**
+ * @brief Softmax of a vector
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ * @param[in] precision Accuracy
+ * @note exp(x) is calculated once for each element
+ */
+void vmath_softmax(float *y, const float *x, const int size, const MathPrecision precision);
+
+/**
+ * @brief Log of the sum of exp of a vector, log(sum(exp(x)))
+ *
+ * @param[in] x Input vector
+ * @param[in] size Number of elements, at least 1
+ * @param[in] precision Accuracy
+ * @return Log-sum-exp of the vector
+ * @note Shifted by the max. of the input, exp(x) does not overflow
+ */
+float vmath_logsumexp(const float *x, const int size, const MathPrecision precision);
+
+#endif // VMATH_H
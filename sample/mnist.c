@@ -2,12 +2,15 @@
  * @file mnist.c
  * @brief Train and predict MNIST
  */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdint.h>
 
+#include "data_loader.h"
+#include "dataset.h"
 #include "layers.h"
 #include "losses.h"
+#include "sampler.h"
 #include "trainer.h"
 #include "util.h"
 
@@ -21,154 +24,31 @@
 // The number of classes
 #define CLASS_NUM 10
 
-// Load MNIST label data: "***-labels-idx1-ubyte"
-static bool load_mnist_labels(
-    const char *filename, float **labels, const int num
-) {
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        fprintf(stderr, "Error: failed to open file: %s\n", filename);
-        return false;
-    }
+// The number of samples of a minibatch
+#define BATCH_SIZE 64
 
-    size_t n_read;
-    (void)n_read;
+// Learning rate of minibatch SGD
+#define LEARNING_RATE 0.5f
 
-    // Check a magic number
-    int32_t magic_number = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        magic_number = (magic_number << 8) | byte;
-    }
-
-    if (magic_number != 2049) {
-        fprintf(
-            stderr, "Error: magic number %d mismatch to 2049d\n", magic_number
-        );
-        fclose(fp);
-        return false;
-    }
+// Seed of initial parameters and shuffling samples
+#define SEED 1
 
-    // Check the number of data
-    int32_t num_data = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        num_data = (num_data << 8) | byte;
-    }
-
-    if (num_data != num) {
-        fprintf(
-            stderr,
-            "Error: the number of items %d mismatch to %d\n", num_data, num
-        );
-        fclose(fp);
-        return false;
-    }
-
-    // Get labels as one-hot vectors
-    for (int i = 0; i < num_data; i++) {
-        uint8_t label;
-        n_read = fread(&label, sizeof(uint8_t), 1, fp);
-        // Convert to a one-hot vector
-        for (int j = 0; j < CLASS_NUM; j++) {
-            labels[i][j] = (j == label) ? 1.0f : 0.0f;
-        }
-    }
-
-    return true;
-}
-
-// Load MNIST image data: "***-images-idx3-ubyte"
-static bool load_mnist_images(
-    const char *filename, float **images, const int num
-) {
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL) {
+// Map an IDX file, samples are kept as bytes
+static bool open_mnist(Dataset *dataset, const char *filename, const size_t num) {
+    if (dataset_open_idx(dataset, filename) == NULL) {
         fprintf(stderr, "Error: failed to open file: %s\n", filename);
         return false;
     }
 
-    size_t n_read;
-    (void)n_read;
-
-    // Check a magic number
-    int32_t magic_number = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        magic_number = (magic_number << 8) | byte;
-    }
-
-    if (magic_number != 2051) {
-        fprintf(
-            stderr, "Error: magic number %d mismatch to 2051\n", magic_number
-        );
-        fclose(fp);
-        return false;
-    }
-
-    // Check the number of data
-    int32_t num_data = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        num_data = (num_data << 8) | byte;
-    }
-
-    if (num_data != num) {
+    if (dataset->num_samples != num) {
         fprintf(
             stderr,
-            "Error: the number of items %d mismatch to %d\n", num_data, num
+            "Error: the number of items %zu mismatch to %zu\n", dataset->num_samples, num
         );
-        fclose(fp);
+        dataset_close(dataset);
         return false;
     }
 
-    // Get the number of rows/cols
-    int32_t num_rows = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        num_rows = (num_rows << 8) | byte;
-    }
-
-    if (num_rows != IMAGE_SIZE) {
-        fprintf(
-            stderr,
-            "Error: number of rows %d mismatch to %d\n", num_rows, IMAGE_SIZE
-        );
-        fclose(fp);
-        return false;
-    }
-
-    int32_t num_cols = 0;
-    for (int i = 0; i < 4; i++) {
-        uint8_t byte;
-        n_read = fread(&byte, sizeof(uint8_t), 1, fp);
-        num_cols = (num_cols << 8) | byte;
-    }
-
-    if (num_cols != IMAGE_SIZE) {
-        fprintf(
-            stderr,
-            "Error: number of columns %d mismatch to %d\n", num_cols, IMAGE_SIZE
-        );
-        fclose(fp);
-        return false;
-    }
-
-    // Get pixels as vectors
-    for (int i = 0; i < num_data; i++) {
-        for (int j = 0; j < (IMAGE_SIZE * IMAGE_SIZE); j++) {
-            uint8_t pixel;
-            n_read = fread(&pixel, sizeof(uint8_t), 1, fp);
-            // Normalize values to [0,1]
-            images[i][j] = (float)pixel / 255;
-        }
-    }
-
     return true;
 }
 
@@ -181,81 +61,28 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    // Allocate memories for the dataset
-    float **train_labels = NULL;
-    float **train_images = NULL;
-    float **test_labels = NULL;
-    float **test_images = NULL;
-
-    train_labels = alloc_dataset(TRAIN_DATA_NUM, CLASS_NUM);
-    if (train_labels == NULL) {
-        fprintf(
-            stderr, "Error: failed to allocate memory for a training dataset\n"
-        );
-        return EXIT_FAILURE;
-    }
-
-    train_images = alloc_dataset(TRAIN_DATA_NUM, (IMAGE_SIZE * IMAGE_SIZE));
-    if (train_images == NULL) {
-        fprintf(
-            stderr, "Error: failed to allocate memory for a training dataset\n"
-        );
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        return EXIT_FAILURE;
-    }
-
-    test_labels = alloc_dataset(TEST_DATA_NUM, CLASS_NUM);
-    if (test_labels == NULL) {
-        fprintf(
-            stderr, "Error: failed to allocate memory for a test dataset\n"
-        );
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        return EXIT_FAILURE;
-    }
-
-    test_images = alloc_dataset(TEST_DATA_NUM, (IMAGE_SIZE * IMAGE_SIZE));
-    if (test_images == NULL) {
-        fprintf(
-            stderr, "Error: failed to allocate memory for a test dataset\n"
-        );
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        free_dataset(&test_labels, TEST_DATA_NUM);
-        return EXIT_FAILURE;
-    }
-
-    // Load the dataset
-    if (!load_mnist_labels(argv[1], train_labels, TRAIN_DATA_NUM)) {
+    // Map the dataset, pixels are normalized to [0,1] when they are fed
+    Dataset train_labels, train_images, test_labels, test_images;
+    if (!open_mnist(&train_labels, argv[1], TRAIN_DATA_NUM)) {
         fprintf(stderr, "Error: failed to load a training dataset\n");
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        free_dataset(&test_labels, TEST_DATA_NUM);
-        free_dataset(&test_images, TEST_DATA_NUM);
         return EXIT_FAILURE;
     }
-    if (!load_mnist_images(argv[2], train_images, TRAIN_DATA_NUM)) {
+    if (!open_mnist(&train_images, argv[2], TRAIN_DATA_NUM)) {
         fprintf(stderr, "Error: failed to load a training dataset\n");
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        free_dataset(&test_labels, TEST_DATA_NUM);
-        free_dataset(&test_images, TEST_DATA_NUM);
+        dataset_close(&train_labels);
         return EXIT_FAILURE;
     }
-    if (!load_mnist_labels(argv[3], test_labels, TEST_DATA_NUM)) {
+    if (!open_mnist(&test_labels, argv[3], TEST_DATA_NUM)) {
         fprintf(stderr, "Error: failed to load a test dataset\n");
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        free_dataset(&test_labels, TEST_DATA_NUM);
-        free_dataset(&test_images, TEST_DATA_NUM);
+        dataset_close(&train_labels);
+        dataset_close(&train_images);
         return EXIT_FAILURE;
     }
-    if (!load_mnist_images(argv[4], test_images, TEST_DATA_NUM)) {
+    if (!open_mnist(&test_images, argv[4], TEST_DATA_NUM)) {
         fprintf(stderr, "Error: failed to load a test dataset\n");
-        free_dataset(&train_labels, TRAIN_DATA_NUM);
-        free_dataset(&train_images, TRAIN_DATA_NUM);
-        free_dataset(&test_labels, TEST_DATA_NUM);
-        free_dataset(&test_images, TEST_DATA_NUM);
+        dataset_close(&train_labels);
+        dataset_close(&train_images);
+        dataset_close(&test_labels);
         return EXIT_FAILURE;
     }
 
@@ -266,70 +93,102 @@ int main(int argc, char *argv[]) {
         LAYER_PARAMS_LIST(
             {
                 .type=LAYER_TYPE_FC,
-                .batch_size=1, .in=IMAGE_SIZE*IMAGE_SIZE, .out=100
+                .batch_size=BATCH_SIZE, .in=IMAGE_SIZE*IMAGE_SIZE, .out=100
             },
             { .type=LAYER_TYPE_SIGMOID },
-            { .type=LAYER_TYPE_FC, .out=10 },
-            { .type=LAYER_TYPE_SOFTMAX }
+            // Logits, softmax is fused into the loss
+            { .type=LAYER_TYPE_FC, .out=10 }
         )
     );
 
-    net_init_params(&net);
+    net_init_params(&net, SEED);
 
     printf("====================\n");
     printf("Start training\n");
     printf("====================\n");
-    const float lr = 0.01;
+    const float lr = LEARNING_RATE;
     const int epochs = 5;
-    LossFunc loss_func = ce_loss();
+    SparseLossFunc loss_func = sparse_softmax_ce_loss();
+
+    // Training samples are shuffled and gathered on a loader thread while the network trains
+    Sampler sampler;
+    DataLoader loader;
+    if ((sampler_alloc(&sampler, TRAIN_DATA_NUM, SEED) == NULL) ||
+        (data_loader_alloc(
+            &loader, &train_images, &train_labels, BATCH_SIZE, (1.0f / 255), &sampler
+        ) == NULL)) {
+        fprintf(stderr, "Error: failed to start a data loader\n");
+        sampler_free(&sampler);
+        net_free_layers(&net);
+        dataset_close(&train_labels);
+        dataset_close(&train_images);
+        dataset_close(&test_labels);
+        dataset_close(&test_images);
+        return EXIT_FAILURE;
+    }
+
+    // Input of the network converted from bytes
+    float x[BATCH_SIZE * IMAGE_SIZE * IMAGE_SIZE];
+    int t[BATCH_SIZE];
 
-    // Train the network with simple SGD
+    // Train the network with minibatch SGD
     for (int i = 0; i < epochs; i++) {
         float total_loss = 0;
         int corrects = 0;
-        float grad[CLASS_NUM];
+        float grad[BATCH_SIZE * CLASS_NUM];
 
         printf("Epoch %d\n", (i + 1));
-        for (int j = 0; j < TRAIN_DATA_NUM; j++) {
-            net_clear_grad(&net);
-
-            float *y = net_forward(&net, train_images[j]);
-            float loss = loss_func.forward(y, train_labels[j], 1, CLASS_NUM);
+        int data_num = 0;
+        for (const DataLoaderBatch *batch; (batch = data_loader_next(&loader)) != NULL;) {
+            const int n = batch->size;
+            float *y = net_forward_batch(&net, batch->x, n);
+            float loss = loss_func.forward(y, batch->t, n, CLASS_NUM, net_output(&net)->precision);
 
-            loss_func.backward(grad, y, train_labels[j], 1, CLASS_NUM);
+            loss_func.backward(grad, y, batch->t, n, CLASS_NUM, net_output(&net)->precision);
             net_backward(&net, grad);
 
             train_step(&net, lr);
 
-            if (argmax(y, CLASS_NUM) == argmax(train_labels[j], CLASS_NUM)) {
-                corrects++;
+            for (int j = 0; j < n; j++) {
+                if (argmax(&y[j * CLASS_NUM], CLASS_NUM) == batch->t[j]) {
+                    corrects++;
+                }
             }
 
-            total_loss += loss;
+            total_loss += loss * n;
 
-            int data_num = j + 1;
             // Display metrics for the training data
-            if (data_num % 6000 == 0) {
+            if (((data_num + n) / 6000) > (data_num / 6000)) {
                 printf(
                     "(%d/%d) train loss=%f, train accuracy=%f\n",
-                    data_num, TRAIN_DATA_NUM,
-                    (total_loss / data_num), ((float)corrects / data_num)
+                    (data_num + n), TRAIN_DATA_NUM,
+                    (total_loss / (data_num + n)), ((float)corrects / (data_num + n))
                 );
             }
+            data_num += n;
         }
 
         // Display metrics for the test data
         total_loss = 0;
         corrects = 0;
-        for (int j = 0; j < TEST_DATA_NUM; j++) {
-            float *y = net_forward(&net, test_images[j]);
-            float loss = loss_func.forward(y, test_labels[j], 1, CLASS_NUM);
+        for (int j = 0; j < TEST_DATA_NUM; j += BATCH_SIZE) {
+            const int n = ((TEST_DATA_NUM - j) < BATCH_SIZE) ? (TEST_DATA_NUM - j) : BATCH_SIZE;
+            const uint8_t *labels = dataset_samples(&test_labels, j, n);
+            for (int k = 0; k < n; k++) {
+                t[k] = labels[k];
+            }
+            dataset_samples_float(&test_images, j, n, (1.0f / 255), x);
+
+            float *y = net_forward_batch(&net, x, n);
+            float loss = loss_func.forward(y, t, n, CLASS_NUM, net_output(&net)->precision);
 
-            if (argmax(y, CLASS_NUM) == argmax(test_labels[j], CLASS_NUM)) {
-                corrects++;
+            for (int k = 0; k < n; k++) {
+                if (argmax(&y[k * CLASS_NUM], CLASS_NUM) == t[k]) {
+                    corrects++;
+                }
             }
 
-            total_loss += loss;
+            total_loss += loss * n;
         }
 
         printf(
@@ -341,12 +200,14 @@ int main(int argc, char *argv[]) {
 
     printf("Finished\n");
 
+    data_loader_free(&loader);
+    sampler_free(&sampler);
     net_free_layers(&net);
 
-    free_dataset(&train_labels, TRAIN_DATA_NUM);
-    free_dataset(&train_images, TRAIN_DATA_NUM);
-    free_dataset(&test_labels, TEST_DATA_NUM);
-    free_dataset(&test_images, TEST_DATA_NUM);
+    dataset_close(&train_labels);
+    dataset_close(&train_images);
+    dataset_close(&test_labels);
+    dataset_close(&test_images);
 
     return EXIT_SUCCESS;
 }
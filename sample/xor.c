@@ -11,6 +11,9 @@
 // Number of data
 #define DATA_NUM 4
 
+// Seed of initial parameters
+#define SEED 1
+
 // Get a class (0/1) from the logit
 static int get_binary_class(const float value) {
     return (value > 0.5f ? 1 : 0);
@@ -28,7 +31,7 @@ int main(void) {
         )
     );
 
-    net_init_params(&net);
+    net_init_params(&net, SEED);
 
     // XOR inputs
     float x[DATA_NUM][2] = {
@@ -53,12 +56,10 @@ int main(void) {
         float loss;
 
         for (int j = 0; j < DATA_NUM; j++) {
-            net_clear_grad(&net);
-
             float *y = net_forward(&net, x[j]);
 
-            loss = loss_func.forward(y, t[j], 1, 1);
-            loss_func.backward(grad, y, t[j], 1, 1);
+            loss = loss_func.forward(y, t[j], 1, 1, net_output(&net)->precision);
+            loss_func.backward(grad, y, t[j], 1, 1, net_output(&net)->precision);
 
             net_backward(&net, grad);
 
@@ -0,0 +1,83 @@
+/**
+ * @file cpu.c
+ * @brief CPU feature detection
+ */
+#include "cpu.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+/**
+ * @brief Detected features
+ */
+static CpuFeatures features;
+
+/**
+ * @brief Detect the features once, even if the first calls race
+ */
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief Read the extended control register XCR0
+ *
+ * @return Value of XCR0
+ */
+static uint64_t xgetbv(void) {
+    uint32_t eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+/**
+ * @brief Detect features by cpuid
+ *
+ * @param[out] features Detected features
+ */
+static void detect(CpuFeatures *features) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+
+    features->sse2 = (edx & bit_SSE2) != 0;
+
+    // The OS must save YMM/ZMM states by XSAVE on context switch
+    const bool osxsave = (ecx & bit_OSXSAVE) != 0;
+    const uint64_t xcr0 = osxsave ? xgetbv() : 0;
+    const bool os_ymm = (xcr0 & 0x06) == 0x06;
+    const bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+    features->fma = os_ymm && ((ecx & bit_FMA) != 0);
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return;
+    }
+
+    features->avx2 = os_ymm && ((ebx & bit_AVX2) != 0);
+    features->avx512f = os_zmm && ((ebx & bit_AVX512F) != 0);
+}
+#else
+static void detect(CpuFeatures *features) {
+    (void)features;
+}
+#endif
+
+/**
+ * @brief Detect the features of the running CPU
+ */
+static void detect_features(void) {
+    detect(&features);
+}
+
+const CpuFeatures *cpu_features(void) {
+    pthread_once(&detect_once, detect_features);
+
+    return &features;
+}
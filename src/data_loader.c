@@ -0,0 +1,267 @@
+/**
+ * @file data_loader.c
+ * @brief Background loader of batches from datasets
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "data_loader.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @brief Alignment of a batch buffer in bytes
+ */
+#define BUFFER_ALIGNMENT 64
+
+/**
+ * @brief Number of polls of a waiting thread before sleeping on the condition
+ */
+#define SPIN_COUNT 1000
+
+/**
+ * @brief Hint to the CPU in a polling loop
+ */
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * @brief Wait while a counter of the other thread is a value
+ *
+ * @param[in,out] loader Loader
+ * @param[in] counter Counter written by the other thread
+ * @param[in] value Value to be changed
+ * @return true if changed, false if the loader is stopped
+ */
+static bool wait_while(DataLoader *loader, const unsigned int *counter, const unsigned int value) {
+    // Poll for a while, a batch is usually ready or taken soon
+    for (int i = 0; i < loader->spin_count; i++) {
+        if (__atomic_load_n(counter, __ATOMIC_ACQUIRE) != value) {
+            return true;
+        }
+        if (__atomic_load_n(&loader->stop, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        cpu_relax();
+    }
+
+    // Then sleep, the other thread wakes it up if it sees a sleeper after publishing
+    pthread_mutex_lock(&loader->mutex);
+    __atomic_fetch_add(&loader->sleepers, 1, __ATOMIC_SEQ_CST);
+    while ((__atomic_load_n(counter, __ATOMIC_SEQ_CST) == value) &&
+        !__atomic_load_n(&loader->stop, __ATOMIC_SEQ_CST)) {
+        pthread_cond_wait(&loader->cond, &loader->mutex);
+    }
+    __atomic_fetch_sub(&loader->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&loader->mutex);
+
+    return (__atomic_load_n(counter, __ATOMIC_ACQUIRE) != value);
+}
+
+/**
+ * @brief Publish a new value of a counter to the other thread
+ *
+ * @param[in,out] loader Loader
+ * @param[out] counter Counter written by this thread
+ * @param[in] value New value
+ */
+static void publish(DataLoader *loader, unsigned int *counter, const unsigned int value) {
+    __atomic_store_n(counter, value, __ATOMIC_SEQ_CST);
+
+    // The mutex is taken only if the other thread has gone to sleep
+    if (__atomic_load_n(&loader->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&loader->mutex);
+        pthread_cond_broadcast(&loader->cond);
+        pthread_mutex_unlock(&loader->mutex);
+    }
+}
+
+/**
+ * @brief Convert samples into a batch buffer
+ *
+ * @param[in] loader Loader
+ * @param[out] batch Batch
+ * @param[in] index Index of the first sample of an epoch
+ * @param[in] size Number of samples, 0 to mark the end of an epoch
+ */
+static void assemble(
+    const DataLoader *loader, DataLoaderBatch *batch, const size_t index, const int size
+) {
+    batch->size = size;
+    if (size == 0) {
+        return;
+    }
+
+    // Shuffled samples are gathered, others are converted as a contiguous range
+    const size_t *indices = (loader->sampler != NULL) ? &loader->sampler->indices[index] : NULL;
+    if (indices != NULL) {
+        dataset_gather_float(loader->inputs, indices, size, loader->scale, batch->x);
+    } else {
+        dataset_samples_float(loader->inputs, index, size, loader->scale, batch->x);
+    }
+
+    if (loader->labels == NULL) {
+        return;
+    }
+
+    const void *labels = loader->labels->data;
+    for (int i = 0; i < size; i++) {
+        const size_t j = (indices != NULL) ? indices[i] : (index + i);
+        batch->t[i] = (loader->labels->type == DATASET_TYPE_INT32) ?
+            ((const int32_t*)labels)[j] : ((const uint8_t*)labels)[j];
+    }
+}
+
+/**
+ * @brief Main loop of a loader thread
+ *
+ * @param[in,out] arg Loader
+ * @return NULL
+ */
+static void *loader_main(void *arg) {
+    DataLoader *loader = arg;
+    const size_t num_samples = loader->inputs->num_samples;
+
+    unsigned int produced = 0;
+    size_t index = 0;
+    for (;;) {
+        // Wait for a free buffer
+        if (!wait_while(loader, &loader->consumed, (produced - DATA_LOADER_NUM_BUFFERS))) {
+            break;
+        }
+
+        if ((index == 0) && (loader->sampler != NULL)) {
+            sampler_shuffle(loader->sampler);
+        }
+
+        const size_t rest = num_samples - index;
+        const int size = (rest < (size_t)loader->batch_size) ? (int)rest : loader->batch_size;
+        assemble(loader, &loader->batches[produced % DATA_LOADER_NUM_BUFFERS], index, size);
+
+        // An empty batch ends the epoch and the next one starts
+        index = (size == 0) ? 0 : (index + size);
+
+        produced++;
+        publish(loader, &loader->produced, produced);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Check if a dataset is class indices of samples
+ *
+ * @param[in] labels Dataset
+ * @param[in] num_samples Number of samples
+ * @return true if valid, otherwise false
+ */
+static bool is_valid_labels(const Dataset *labels, const size_t num_samples) {
+    return (labels->data != NULL) && (labels->num_samples == num_samples) &&
+        (labels->sample_size == 1) &&
+        ((labels->type == DATASET_TYPE_UINT8) || (labels->type == DATASET_TYPE_INT32));
+}
+
+DataLoader *data_loader_alloc(
+    DataLoader *loader, const Dataset *inputs, const Dataset *labels,
+    const int batch_size, const float scale, Sampler *sampler
+) {
+    if ((loader == NULL) || (inputs == NULL) || (inputs->data == NULL) ||
+        (inputs->num_samples == 0) || (batch_size <= 0) ||
+        ((labels != NULL) && !is_valid_labels(labels, inputs->num_samples)) ||
+        ((sampler != NULL) && (sampler->num_samples != inputs->num_samples))) {
+        return NULL;
+    }
+
+    *loader = (DataLoader){
+        .inputs = inputs,
+        .labels = labels,
+        .batch_size = batch_size,
+        .scale = scale,
+        .sampler = sampler,
+        // Polling only delays the other thread on a single CPU
+        .spin_count = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? SPIN_COUNT : 0
+    };
+
+    // Inputs of each batch start at the alignment
+    const size_t align = BUFFER_ALIGNMENT / sizeof(float);
+    const size_t stride = (((size_t)batch_size * inputs->sample_size) + align - 1) / align * align;
+    void *buffer;
+    if (posix_memalign(
+        &buffer, BUFFER_ALIGNMENT, (sizeof(float) * stride * DATA_LOADER_NUM_BUFFERS)
+    ) != 0) {
+        return NULL;
+    }
+    loader->buffer = buffer;
+
+    for (int i = 0; i < DATA_LOADER_NUM_BUFFERS; i++) {
+        loader->batches[i].x = &loader->buffer[stride * i];
+        if (labels != NULL) {
+            loader->batches[i].t = malloc(sizeof(int) * batch_size);
+            if (loader->batches[i].t == NULL) {
+                for (int j = 0; j < i; j++) {
+                    free(loader->batches[j].t);
+                }
+                free(loader->buffer);
+                return NULL;
+            }
+        }
+    }
+
+    pthread_mutex_init(&loader->mutex, NULL);
+    pthread_cond_init(&loader->cond, NULL);
+    if (pthread_create(&loader->thread, NULL, loader_main, loader) != 0) {
+        pthread_cond_destroy(&loader->cond);
+        pthread_mutex_destroy(&loader->mutex);
+        for (int i = 0; i < DATA_LOADER_NUM_BUFFERS; i++) {
+            free(loader->batches[i].t);
+        }
+        free(loader->buffer);
+        return NULL;
+    }
+
+    return loader;
+}
+
+void data_loader_free(DataLoader *loader) {
+    if ((loader == NULL) || (loader->buffer == NULL)) {
+        return;
+    }
+
+    pthread_mutex_lock(&loader->mutex);
+    __atomic_store_n(&loader->stop, true, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&loader->cond);
+    pthread_mutex_unlock(&loader->mutex);
+    pthread_join(loader->thread, NULL);
+
+    pthread_cond_destroy(&loader->cond);
+    pthread_mutex_destroy(&loader->mutex);
+    for (int i = 0; i < DATA_LOADER_NUM_BUFFERS; i++) {
+        free(loader->batches[i].t);
+        loader->batches[i] = (DataLoaderBatch){ 0 };
+    }
+    free(loader->buffer);
+    loader->buffer = NULL;
+}
+
+const DataLoaderBatch *data_loader_next(DataLoader *loader) {
+    // Give back the previous batch
+    if (loader->holding) {
+        loader->holding = false;
+        publish(loader, &loader->consumed, (loader->consumed + 1));
+    }
+
+    wait_while(loader, &loader->produced, loader->consumed);
+
+    const DataLoaderBatch *batch = &loader->batches[loader->consumed % DATA_LOADER_NUM_BUFFERS];
+    if (batch->size == 0) {
+        publish(loader, &loader->consumed, (loader->consumed + 1));
+        return NULL;
+    }
+
+    loader->holding = true;
+    return batch;
+}
@@ -0,0 +1,515 @@
+/**
+ * @file dataset.c
+ * @brief Memory-mapped binary dataset
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "dataset.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kernels.h"
+
+/**
+ * @brief Magic bytes of a dataset file
+ */
+#define DATASET_MAGIC "NNDATA\0\0"
+
+/**
+ * @brief Version of the file format
+ */
+#define DATASET_VERSION 1
+
+/**
+ * @brief Number of bytes of a header, samples start at this offset
+ */
+#define HEADER_SIZE 64
+
+/**
+ * @brief Type code of unsigned bytes in an IDX file
+ */
+#define IDX_TYPE_UBYTE 0x08
+
+/**
+ * @brief Number of bytes converted at once
+ */
+#define CONVERT_CHUNK_SIZE (1 << 16)
+
+/**
+ * @brief Number of rows prefetched ahead by a gather
+ */
+#define GATHER_PREFETCH_DISTANCE 4
+
+/**
+ * @brief Number of bytes of a cache line
+ */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief Header of a dataset file
+ */
+typedef struct FileHeader {
+    char magic[8]; //!< DATASET_MAGIC
+    uint32_t version; //!< DATASET_VERSION
+    uint32_t type; //!< Type of elements
+    uint64_t num_samples; //!< Number of samples
+    uint32_t ndim; //!< Number of dimensions of a sample
+    uint32_t shape[DATASET_MAX_DIMS]; //!< Shape of a sample
+    uint8_t reserved[HEADER_SIZE - 44]; //!< Zeros up to the samples
+} FileHeader;
+
+size_t dataset_type_size(const DatasetType type) {
+    switch (type) {
+    case DATASET_TYPE_FLOAT32:
+        return sizeof(float);
+    case DATASET_TYPE_UINT8:
+        return sizeof(uint8_t);
+    case DATASET_TYPE_INT32:
+        return sizeof(int32_t);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Multiply the number of elements of a sample by a dimension
+ *
+ * @param[in,out] sample_size Number of elements of a sample
+ * @param[in] dim Dimension, read from an untrusted header
+ * @param[in] elem_size Number of bytes of an element
+ * @return true if the dimension is in [1, INT_MAX] and bytes of a sample fit in size_t,
+ *         otherwise false
+ */
+static bool multiply_dim(size_t *sample_size, const uint64_t dim, const size_t elem_size) {
+    if ((dim == 0) || (dim > INT_MAX) || (*sample_size > (SIZE_MAX / elem_size / dim))) {
+        return false;
+    }
+
+    *sample_size *= (size_t)dim;
+
+    return true;
+}
+
+/**
+ * @brief Fill a header of a dataset file
+ *
+ * @param[out] header Header
+ * @param[in] type Type of elements
+ * @param[in] ndim Number of dimensions of a sample
+ * @param[in] shape Shape of a sample
+ * @param[in] num_samples Number of samples
+ * @return Number of elements of a sample, 0 if the shape is invalid
+ */
+static size_t fill_header(
+    FileHeader *header, const DatasetType type, const int ndim, const int *shape,
+    const size_t num_samples
+) {
+    if ((dataset_type_size(type) == 0) || (ndim < 0) || (ndim > DATASET_MAX_DIMS) ||
+        ((ndim > 0) && (shape == NULL))) {
+        return 0;
+    }
+
+    memset(header, 0, sizeof(FileHeader));
+    memcpy(header->magic, DATASET_MAGIC, sizeof(header->magic));
+    header->version = DATASET_VERSION;
+    header->type = (uint32_t)type;
+    header->num_samples = num_samples;
+    header->ndim = (uint32_t)ndim;
+
+    size_t sample_size = 1;
+    for (int i = 0; i < ndim; i++) {
+        if ((shape[i] <= 0) ||
+            !multiply_dim(&sample_size, (uint64_t)shape[i], dataset_type_size(type))) {
+            return 0;
+        }
+        header->shape[i] = (uint32_t)shape[i];
+    }
+
+    return sample_size;
+}
+
+bool dataset_write(
+    const char *filename, const DatasetType type, const int ndim, const int *shape,
+    const size_t num_samples, const void *data
+) {
+    FileHeader header;
+    const size_t sample_size = fill_header(&header, type, ndim, shape, num_samples);
+    if ((filename == NULL) || (sample_size == 0) || ((data == NULL) && (num_samples > 0))) {
+        return false;
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    const size_t data_size = num_samples * sample_size * dataset_type_size(type);
+    bool written = (fwrite(&header, sizeof(FileHeader), 1, fp) == 1) &&
+        ((data_size == 0) || (fwrite(data, 1, data_size, fp) == data_size));
+
+    if (fclose(fp) != 0) {
+        written = false;
+    }
+
+    return written;
+}
+
+/**
+ * @brief Map a whole file read-only
+ *
+ * @param[in] filename Path of the file
+ * @param[out] size Number of bytes of the mapping
+ * @return Mapping, NULL if failed
+ */
+static void *map_file(const char *filename, size_t *size) {
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        close(fd);
+        return NULL;
+    }
+
+    *size = (size_t)st.st_size;
+    void *map = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping is kept after the descriptor is closed
+    close(fd);
+
+    return (map == MAP_FAILED) ? NULL : map;
+}
+
+/**
+ * @brief Read a big-endian 32-bit integer of an IDX header
+ *
+ * @param[in] bytes Bytes of the integer
+ * @return Value
+ */
+static uint32_t read_idx_value(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+        ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+/**
+ * @brief Parse a header of an IDX file of unsigned bytes
+ *
+ * @param[in] bytes Beginning of the file
+ * @param[in] size Number of bytes of the file
+ * @param[out] num_samples Number of samples, the first dimension
+ * @param[out] ndim Number of dimensions of a sample
+ * @param[out] shape Shape of a sample
+ * @return Number of bytes of the header, 0 if invalid
+ */
+static size_t parse_idx_header(
+    const uint8_t *bytes, const size_t size, size_t *num_samples, int *ndim, int *shape
+) {
+    if (size < 8) {
+        return 0;
+    }
+
+    // 2 zero bytes, a type code and the number of dimensions
+    const uint32_t magic = read_idx_value(bytes);
+    const uint32_t type = (magic >> 8) & 0xFF;
+    const int idx_ndim = (int)(magic & 0xFF);
+    const size_t header_size = sizeof(uint32_t) * (size_t)(idx_ndim + 1);
+    if (((magic >> 16) != 0) || (type != IDX_TYPE_UBYTE) ||
+        (idx_ndim < 1) || ((idx_ndim - 1) > DATASET_MAX_DIMS) || (size < header_size)) {
+        return 0;
+    }
+
+    *num_samples = read_idx_value(&bytes[4]);
+
+    *ndim = idx_ndim - 1;
+    for (int i = 0; i < *ndim; i++) {
+        const uint32_t dim = read_idx_value(&bytes[8 + 4 * i]);
+        if ((dim == 0) || (dim > INT32_MAX)) {
+            return 0;
+        }
+        shape[i] = (int)dim;
+    }
+
+    return header_size;
+}
+
+/**
+ * @brief Convert unsigned bytes to elements of a dataset
+ *
+ * @param[out] y Elements
+ * @param[in] x Bytes
+ * @param[in] size Number of bytes
+ * @param[in] type Type of elements
+ */
+static void convert_bytes(void *y, const uint8_t *x, const size_t size, const DatasetType type) {
+    switch (type) {
+    case DATASET_TYPE_FLOAT32:
+        kernels()->u8_to_float(y, x, (int)size, (1.0f / 255));
+        break;
+    case DATASET_TYPE_UINT8:
+        memcpy(y, x, size);
+        break;
+    case DATASET_TYPE_INT32:
+        for (size_t i = 0; i < size; i++) {
+            ((int32_t*)y)[i] = x[i];
+        }
+        break;
+    }
+}
+
+bool dataset_convert_idx(const char *idx_filename, const char *filename, const DatasetType type) {
+    if ((idx_filename == NULL) || (filename == NULL) || (dataset_type_size(type) == 0)) {
+        return false;
+    }
+
+    Dataset idx;
+    if (dataset_open_idx(&idx, idx_filename) == NULL) {
+        return false;
+    }
+
+    FileHeader header;
+    if (fill_header(&header, type, idx.ndim, idx.shape, idx.num_samples) == 0) {
+        dataset_close(&idx);
+        return false;
+    }
+
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL) {
+        dataset_close(&idx);
+        return false;
+    }
+
+    void *converted = malloc(CONVERT_CHUNK_SIZE * dataset_type_size(type));
+    bool succeeded = (converted != NULL) && (fwrite(&header, sizeof(FileHeader), 1, out) == 1);
+
+    // Samples are converted in chunks, the size of the input is not limited by memory
+    const size_t total = idx.num_samples * idx.sample_size;
+    for (size_t done = 0; succeeded && (done < total);) {
+        const size_t size = ((total - done) < CONVERT_CHUNK_SIZE) ?
+            (total - done) : CONVERT_CHUNK_SIZE;
+
+        convert_bytes(converted, (const uint8_t*)idx.data + done, size, type);
+
+        const size_t bytes = size * dataset_type_size(type);
+        if (fwrite(converted, 1, bytes, out) != bytes) {
+            succeeded = false;
+        }
+        done += size;
+    }
+
+    free(converted);
+    dataset_close(&idx);
+    if (fclose(out) != 0) {
+        succeeded = false;
+    }
+
+    // Do not leave a truncated dataset
+    if (!succeeded) {
+        remove(filename);
+    }
+
+    return succeeded;
+}
+
+Dataset *dataset_open(Dataset *dataset, const char *filename) {
+    if ((dataset == NULL) || (filename == NULL)) {
+        return NULL;
+    }
+
+    size_t map_size;
+    void *map = map_file(filename, &map_size);
+    if ((map == NULL) || (map_size < HEADER_SIZE)) {
+        if (map != NULL) {
+            munmap(map, map_size);
+        }
+        return NULL;
+    }
+
+    FileHeader header;
+    memcpy(&header, map, sizeof(FileHeader));
+
+    size_t sample_size = 1;
+    bool valid = (memcmp(header.magic, DATASET_MAGIC, sizeof(header.magic)) == 0) &&
+        (header.version == DATASET_VERSION) &&
+        (dataset_type_size((DatasetType)header.type) > 0) &&
+        (header.ndim <= DATASET_MAX_DIMS);
+    const size_t elem_size = dataset_type_size((DatasetType)header.type);
+    for (uint32_t i = 0; valid && (i < header.ndim); i++) {
+        valid = multiply_dim(&sample_size, header.shape[i], elem_size);
+    }
+
+    if (!valid ||
+        (header.num_samples > ((map_size - HEADER_SIZE) / elem_size / sample_size))) {
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    *dataset = (Dataset){
+        .type = (DatasetType)header.type,
+        .num_samples = header.num_samples,
+        .sample_size = sample_size,
+        .ndim = (int)header.ndim,
+        .data = (const uint8_t*)map + HEADER_SIZE,
+        .map = map,
+        .map_size = map_size
+    };
+    for (int i = 0; i < dataset->ndim; i++) {
+        dataset->shape[i] = (int)header.shape[i];
+    }
+
+    return dataset;
+}
+
+Dataset *dataset_open_idx(Dataset *dataset, const char *filename) {
+    if ((dataset == NULL) || (filename == NULL)) {
+        return NULL;
+    }
+
+    size_t map_size;
+    void *map = map_file(filename, &map_size);
+    if (map == NULL) {
+        return NULL;
+    }
+
+    size_t num_samples;
+    int ndim;
+    int shape[DATASET_MAX_DIMS];
+    const size_t header_size = parse_idx_header(map, map_size, &num_samples, &ndim, shape);
+
+    bool valid = (header_size > 0);
+    size_t sample_size = 1;
+    for (int i = 0; valid && (i < ndim); i++) {
+        valid = multiply_dim(&sample_size, (uint64_t)shape[i], 1);
+    }
+
+    // Bytes are read as they are, no conversion for the byte order
+    if (!valid || (num_samples > ((map_size - header_size) / sample_size))) {
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    *dataset = (Dataset){
+        .type = DATASET_TYPE_UINT8,
+        .num_samples = num_samples,
+        .sample_size = sample_size,
+        .ndim = ndim,
+        .data = (const uint8_t*)map + header_size,
+        .map = map,
+        .map_size = map_size
+    };
+    for (int i = 0; i < ndim; i++) {
+        dataset->shape[i] = shape[i];
+    }
+
+    return dataset;
+}
+
+void dataset_close(Dataset *dataset) {
+    if ((dataset == NULL) || (dataset->map == NULL)) {
+        return;
+    }
+
+    munmap(dataset->map, dataset->map_size);
+    dataset->map = NULL;
+    dataset->data = NULL;
+}
+
+const void *dataset_samples(const Dataset *dataset, const size_t index, const size_t n) {
+    if ((dataset == NULL) || (dataset->data == NULL) ||
+        (index > dataset->num_samples) || (n > (dataset->num_samples - index))) {
+        return NULL;
+    }
+
+    const size_t sample_bytes = dataset->sample_size * dataset_type_size(dataset->type);
+    return (const uint8_t*)dataset->data + (index * sample_bytes);
+}
+
+/**
+ * @brief Convert elements of a dataset to floats with a scale
+ *
+ * @param[out] y Floats
+ * @param[in] x Elements
+ * @param[in] size Number of elements
+ * @param[in] type Type of elements
+ * @param[in] scale Scale
+ */
+static void convert_float(
+    float *y, const void *x, const size_t size, const DatasetType type, const float scale
+) {
+    switch (type) {
+    case DATASET_TYPE_FLOAT32:
+        for (size_t i = 0; i < size; i++) {
+            y[i] = ((const float*)x)[i] * scale;
+        }
+        break;
+    case DATASET_TYPE_UINT8:
+        // In chunks, the kernel takes an int size
+        for (size_t i = 0; i < size; i += CONVERT_CHUNK_SIZE) {
+            const size_t chunk = ((size - i) < CONVERT_CHUNK_SIZE) ?
+                (size - i) : CONVERT_CHUNK_SIZE;
+            kernels()->u8_to_float(&y[i], (const uint8_t*)x + i, (int)chunk, scale);
+        }
+        break;
+    case DATASET_TYPE_INT32:
+        for (size_t i = 0; i < size; i++) {
+            y[i] = (float)((const int32_t*)x)[i] * scale;
+        }
+        break;
+    }
+}
+
+bool dataset_samples_float(
+    const Dataset *dataset, const size_t index, const size_t n, const float scale, float *y
+) {
+    const void *x = dataset_samples(dataset, index, n);
+    if ((x == NULL) || (y == NULL)) {
+        return false;
+    }
+
+    convert_float(y, x, (n * dataset->sample_size), dataset->type, scale);
+
+    return true;
+}
+
+bool dataset_gather_float(
+    const Dataset *dataset, const size_t *indices, const size_t n, const float scale, float *y
+) {
+    if ((dataset == NULL) || (dataset->data == NULL) || (indices == NULL) || (y == NULL)) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (indices[i] >= dataset->num_samples) {
+            return false;
+        }
+    }
+
+    const size_t sample_size = dataset->sample_size;
+    const size_t sample_bytes = sample_size * dataset_type_size(dataset->type);
+    const uint8_t *data = dataset->data;
+
+    for (size_t i = 0; i < n; i++) {
+        // Random rows defeat the hardware prefetcher, fetch rows ahead of the conversion
+        if ((i + GATHER_PREFETCH_DISTANCE) < n) {
+            const uint8_t *ahead = &data[indices[i + GATHER_PREFETCH_DISTANCE] * sample_bytes];
+            for (size_t offset = 0; offset < sample_bytes; offset += CACHE_LINE_SIZE) {
+                __builtin_prefetch(&ahead[offset]);
+            }
+        }
+
+        convert_float(
+            &y[i * sample_size], &data[indices[i] * sample_bytes], sample_size,
+            dataset->type, scale
+        );
+    }
+
+    return true;
+}
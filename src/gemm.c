@@ -0,0 +1,428 @@
+/**
+ * @file gemm.c
+ * @brief General matrix multiplication
+ */
+#include "gemm.h"
+
+#include <stddef.h>
+
+#include "kernels.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Number of rows of a packed block of A, fits in L2 cache
+ */
+#define GEMM_MC 72
+
+/**
+ * @brief Depth of packed blocks of A and B, a panel of B fits in L1 cache
+ */
+#define GEMM_KC 256
+
+/**
+ * @brief Number of columns of a packed block of B, fits in L3 cache
+ */
+#define GEMM_NC 4096
+
+/**
+ * @brief Min. number of multiply-accumulates given to a thread
+ */
+#define PARALLEL_MIN_MACS 32768
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+#define ROUND_UP(a, b) ((((a) + (b) - 1) / (b)) * (b))
+
+/**
+ * @brief Pack a block of op(A) into panels of tile rows
+ *
+ * @param[in] mc Number of rows of the block
+ * @param[in] kc Number of columns of the block
+ * @param[in] a Top-left element of the block
+ * @param[in] rs Row stride of op(A)
+ * @param[in] cs Column stride of op(A)
+ * @param[in] tile_mr Number of rows of a register tile
+ * @param[out] ap Packed block, padded by 0 to a multiple of tile rows
+ */
+static void pack_a(
+    const int mc, const int kc,
+    const float *a, const int rs, const int cs, const int tile_mr, float *ap
+) {
+    for (int i = 0; i < mc; i += tile_mr) {
+        const int mr = MIN(tile_mr, mc - i);
+
+        for (int p = 0; p < kc; p++) {
+            int ii = 0;
+            for (; ii < mr; ii++) {
+                ap[ii] = a[(i + ii) * rs + p * cs];
+            }
+            for (; ii < tile_mr; ii++) {
+                ap[ii] = 0;
+            }
+            ap += tile_mr;
+        }
+    }
+}
+
+/**
+ * @brief Pack a block of op(B) into panels of tile columns
+ *
+ * @param[in] kc Number of rows of the block
+ * @param[in] nc Number of columns of the block
+ * @param[in] b Top-left element of the block
+ * @param[in] rs Row stride of op(B)
+ * @param[in] cs Column stride of op(B)
+ * @param[in] tile_nr Number of columns of a register tile
+ * @param[out] bp Packed block, padded by 0 to a multiple of tile columns
+ */
+static void pack_b(
+    const int kc, const int nc,
+    const float *b, const int rs, const int cs, const int tile_nr, float *bp
+) {
+    for (int j = 0; j < nc; j += tile_nr) {
+        const int nr = MIN(tile_nr, nc - j);
+
+        for (int p = 0; p < kc; p++) {
+            int jj = 0;
+            for (; jj < nr; jj++) {
+                bp[jj] = b[p * rs + (j + jj) * cs];
+            }
+            for (; jj < tile_nr; jj++) {
+                bp[jj] = 0;
+            }
+            bp += tile_nr;
+        }
+    }
+}
+
+/**
+ * @brief Apply an epilogue to a tile of C
+ *
+ * @param[in] epilogue Epilogue
+ * @param[in] ks Kernels
+ * @param[in,out] c Top-left element of the tile
+ * @param[in] ldc Leading dimension of C
+ * @param[in] rows Number of rows of the tile
+ * @param[in] col Column of C of the first column of the tile
+ * @param[in] cols Number of columns of the tile
+ */
+static void apply_epilogue(
+    const GemmEpilogue *epilogue, const Kernels *ks,
+    float *c, const int ldc, const int rows, const int col, const int cols
+) {
+    for (int i = 0; i < rows; i++) {
+        float *c_row = &c[i * ldc];
+        if (epilogue->bias != NULL) {
+            ks->add_bias(c_row, &epilogue->bias[col], 1, cols);
+        }
+        if (epilogue->activation != NULL) {
+            epilogue->activation(c_row, c_row, cols, epilogue->precision);
+        }
+    }
+}
+
+/**
+ * @brief Block of op(B) packed by panels in parallel
+ */
+typedef struct PackBlock {
+    int kc; //!< Number of rows of the block
+    int nc; //!< Number of columns of the block
+    const float *b; //!< Top-left element of the block
+    int rs; //!< Row stride of op(B)
+    int cs; //!< Column stride of op(B)
+    int tile_nr; //!< Number of columns of a register tile
+    float *bp; //!< Packed block
+} PackBlock;
+
+/**
+ * @brief Pack panels of a block of op(B)
+ *
+ * @param[in,out] arg Block
+ * @param[in] begin First panel
+ * @param[in] end Panel next to the last one
+ */
+static void pack_b_panels(void *arg, const int begin, const int end) {
+    const PackBlock *block = arg;
+
+    for (int panel = begin; panel < end; panel++) {
+        const int j = panel * block->tile_nr;
+        pack_b(
+            block->kc, MIN(block->tile_nr, block->nc - j),
+            &block->b[j * block->cs], block->rs, block->cs,
+            block->tile_nr, &block->bp[j * block->kc]
+        );
+    }
+}
+
+/**
+ * @brief Block of C multiplied by panels of B in parallel
+ */
+typedef struct MultiplyBlock {
+    const Kernels *ks; //!< Kernels
+    int kc; //!< Depth of packed blocks
+    int mc; //!< Number of rows of the block
+    int nc; //!< Number of columns of the block
+    const float *ap; //!< Packed block of A
+    const float *bp; //!< Packed block of B
+    float beta; //!< Scale of C before accumulation
+    float *c; //!< Top-left element of the block
+    int ldc; //!< Leading dimension of C
+    int col; //!< Column of C of the first column of the block
+    const GemmEpilogue *epilogue; //!< Epilogue after the last block of depth, NULL if none
+} MultiplyBlock;
+
+/**
+ * @brief Multiply panels of B by all panels of A
+ *
+ * @param[in,out] arg Block
+ * @param[in] begin First panel of B
+ * @param[in] end Panel next to the last one
+ */
+static void multiply_panels(void *arg, const int begin, const int end) {
+    const MultiplyBlock *block = arg;
+    const Kernels *ks = block->ks;
+    const int kc = block->kc;
+
+    for (int panel = begin; panel < end; panel++) {
+        const int jr = panel * ks->gemm_nr;
+        for (int ir = 0; ir < block->mc; ir += ks->gemm_mr) {
+            float *c = &block->c[ir * block->ldc + jr];
+            const int mr = MIN(ks->gemm_mr, block->mc - ir);
+            const int nr = MIN(ks->gemm_nr, block->nc - jr);
+
+            ks->gemm(
+                kc, &block->ap[ir * kc], &block->bp[jr * kc],
+                block->beta, c, block->ldc, mr, nr
+            );
+
+            // The tile is still in cache
+            if (block->epilogue != NULL) {
+                apply_epilogue(block->epilogue, ks, c, block->ldc, mr, (block->col + jr), nr);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Packed and blocked matrix multiplication C = op(A) * op(B) + beta * C
+ *
+ * @param[in] m Number of rows of op(A) and C
+ * @param[in] n Number of columns of op(B) and C
+ * @param[in] k Number of columns of op(A) and rows of op(B)
+ * @param[in] a Matrix A
+ * @param[in] rsa Row stride of op(A)
+ * @param[in] csa Column stride of op(A)
+ * @param[in] b Matrix B
+ * @param[in] rsb Row stride of op(B)
+ * @param[in] csb Column stride of op(B)
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Row-major matrix C
+ * @param[in] ldc Leading dimension of C
+ * @param[in] epilogue Epilogue applied to C at last, NULL if none
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+static void gemm(
+    const int m, const int n, const int k,
+    const float *a, const int rsa, const int csa,
+    const float *b, const int rsb, const int csb,
+    const float beta, float *c, const int ldc, const GemmEpilogue *epilogue, float *work
+) {
+    if ((m <= 0) || (n <= 0)) {
+        return;
+    }
+
+    const Kernels *ks = kernels();
+
+    if (k <= 0) {
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                c[i * ldc + j] = (beta == 0) ? 0 : beta * c[i * ldc + j];
+            }
+        }
+        if (epilogue != NULL) {
+            apply_epilogue(epilogue, ks, c, ldc, m, 0, n);
+        }
+        return;
+    }
+    const int tile_mr = ks->gemm_mr;
+    const int tile_nr = ks->gemm_nr;
+
+    // Packed blocks of A and B
+    float *ap = work;
+    float *bp = &work[ROUND_UP(MIN(m, GEMM_MC), tile_mr) * MIN(k, GEMM_KC)];
+
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        const int nc = MIN(GEMM_NC, n - jc);
+
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            const int kc = MIN(GEMM_KC, k - pc);
+            // Scale C only once, accumulate the rest of blocks
+            const float beta_pc = (pc == 0) ? beta : 1.0f;
+
+            const int num_panels = (nc + tile_nr - 1) / tile_nr;
+
+            PackBlock pack_block = {
+                .kc = kc, .nc = nc,
+                .b = &b[pc * rsb + jc * csb], .rs = rsb, .cs = csb,
+                .tile_nr = tile_nr, .bp = bp
+            };
+            // Packing is about m times cheaper than multiplication
+            thread_pool_parallel_for(
+                num_panels, (PARALLEL_MIN_MACS / (kc * tile_nr) + 1),
+                pack_b_panels, &pack_block
+            );
+
+            for (int ic = 0; ic < m; ic += GEMM_MC) {
+                const int mc = MIN(GEMM_MC, m - ic);
+
+                pack_a(mc, kc, &a[ic * rsa + pc * csa], rsa, csa, tile_mr, ap);
+
+                // Split output tiles by panels of B
+                MultiplyBlock multiply_block = {
+                    .ks = ks, .kc = kc, .mc = mc, .nc = nc,
+                    .ap = ap, .bp = bp,
+                    .beta = beta_pc, .c = &c[ic * ldc + jc], .ldc = ldc,
+                    .col = jc, .epilogue = ((pc + kc) < k) ? NULL : epilogue
+                };
+                thread_pool_parallel_for(
+                    num_panels, (PARALLEL_MIN_MACS / (mc * kc * tile_nr) + 1),
+                    multiply_panels, &multiply_block
+                );
+            }
+        }
+    }
+}
+
+void gemm_nn(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+) {
+    gemm(m, n, k, a, lda, 1, b, ldb, 1, beta, c, ldc, NULL, work);
+}
+
+/**
+ * @brief Rows multiplied by dot products in parallel
+ */
+typedef struct DotRows {
+    const Kernels *ks; //!< Kernels
+    int m; //!< Number of rows of A and C
+    int k; //!< Number of columns of A and B
+    const float *a; //!< Row-major matrix A
+    int lda; //!< Leading dimension of A
+    const float *b; //!< Row-major matrix B
+    int ldb; //!< Leading dimension of B
+    float beta; //!< Scale of C before accumulation
+    float *c; //!< Row-major matrix C
+    int ldc; //!< Leading dimension of C
+    const GemmEpilogue *epilogue; //!< Epilogue, NULL if none
+} DotRows;
+
+/**
+ * @brief Multiply rows of B by all rows of A
+ *
+ * @param[in,out] arg Rows
+ * @param[in] begin First row of B
+ * @param[in] end Row next to the last one
+ */
+static void multiply_dot_rows(void *arg, const int begin, const int end) {
+    const DotRows *rows = arg;
+
+    for (int j = begin; j < end; j++) {
+        for (int i = 0; i < rows->m; i++) {
+            const float mac = rows->ks->dot(
+                &rows->a[i * rows->lda], &rows->b[j * rows->ldb], rows->k
+            );
+            float *c_ij = &rows->c[i * rows->ldc + j];
+            *c_ij = (rows->beta == 0) ? mac : (mac + rows->beta * *c_ij);
+        }
+    }
+
+    if (rows->epilogue != NULL) {
+        apply_epilogue(
+            rows->epilogue, rows->ks, &rows->c[begin], rows->ldc, rows->m, begin, (end - begin)
+        );
+    }
+}
+
+/**
+ * @brief Matrix multiplication C = A * B^T + beta * C followed by an epilogue
+ *
+ * @param[in] m Number of rows of A and C
+ * @param[in] n Number of rows of B and columns of C
+ * @param[in] k Number of columns of A and B
+ * @param[in] a Row-major matrix A (m x k)
+ * @param[in] lda Leading dimension of A
+ * @param[in] b Row-major matrix B (n x k)
+ * @param[in] ldb Leading dimension of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Row-major matrix C (m x n)
+ * @param[in] ldc Leading dimension of C
+ * @param[in] epilogue Epilogue applied to C at last, NULL if none
+ * @param[out] work Work memory of gemm_work_size(m, n, k) elements
+ */
+static void gemm_nt_with(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, const GemmEpilogue *epilogue, float *work
+) {
+    const Kernels *ks = kernels();
+
+    if ((m < ks->gemm_mr) && (k > 0)) {
+        // Too few rows to fill a register tile, e.g. a single sample,
+        // multiply contiguous rows of A and B by dot products instead
+        DotRows rows = {
+            .ks = ks, .m = m, .k = k,
+            .a = a, .lda = lda, .b = b, .ldb = ldb,
+            .beta = beta, .c = c, .ldc = ldc, .epilogue = epilogue
+        };
+        thread_pool_parallel_for(
+            n, (PARALLEL_MIN_MACS / (m * k) + 1), multiply_dot_rows, &rows
+        );
+        return;
+    }
+
+    gemm(m, n, k, a, lda, 1, b, 1, ldb, beta, c, ldc, epilogue, work);
+}
+
+void gemm_nt(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+) {
+    gemm_nt_with(m, n, k, a, lda, b, ldb, beta, c, ldc, NULL, work);
+}
+
+void gemm_nt_epilogue(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    float *c, const int ldc, const GemmEpilogue *epilogue, float *work
+) {
+    gemm_nt_with(m, n, k, a, lda, b, ldb, 0.0f, c, ldc, epilogue, work);
+}
+
+void gemm_tn(
+    const int m, const int n, const int k,
+    const float *a, const int lda,
+    const float *b, const int ldb,
+    const float beta, float *c, const int ldc, float *work
+) {
+    gemm(m, n, k, a, 1, lda, b, ldb, 1, beta, c, ldc, NULL, work);
+}
+
+size_t gemm_work_size(const int m, const int n, const int k) {
+    if ((m <= 0) || (n <= 0) || (k <= 0)) {
+        return 0;
+    }
+
+    // Blocks are padded to tiles of any kernels, which may be selected after planning
+    const size_t mc_max = MIN(m, GEMM_MC) + KERNELS_MAX_GEMM_MR - 1;
+    const size_t kc_max = MIN(k, GEMM_KC);
+    const size_t nc_max = MIN(n, GEMM_NC) + KERNELS_MAX_GEMM_NR - 1;
+
+    return (mc_max + nc_max) * kc_max;
+}
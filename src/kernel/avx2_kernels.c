@@ -0,0 +1,600 @@
+/**
+ * @file avx2_kernels.c
+ * @brief AVX2 and FMA kernels
+ */
+#include "kernel/avx2_kernels.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <float.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Compile a function for AVX2 and FMA regardless of build flags
+ */
+#define TARGET __attribute__((target("avx2,fma")))
+
+/**
+ * @brief Number of rows of a register tile
+ */
+#define GEMM_MR 6
+
+/**
+ * @brief Number of columns of a register tile, 2 YMM registers for a row
+ */
+#define GEMM_NR 16
+
+/**
+ * @brief Get a mask of the first elements of a vector
+ *
+ * @param[in] size Number of elements to be enabled, less than 8
+ * @return Mask for maskload/maskstore
+ */
+TARGET static inline __m256i tail_mask(const int size) {
+    return _mm256_cmpgt_epi32(
+        _mm256_set1_epi32(size), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)
+    );
+}
+
+/**
+ * @brief Horizontal sum of a vector
+ *
+ * @param[in] v Vector
+ * @return Sum of all elements
+ */
+TARGET static inline float hsum(const __m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+/**
+ * @brief Horizontal max. of a vector
+ *
+ * @param[in] v Vector
+ * @return Max. of all elements
+ */
+TARGET static inline float hmax(const __m256 v) {
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[in] x Vector
+ * @return exp(x), x is clamped into [-87, 88]
+ * @note Cephes polynomial, max. error is 2 ULP in [-87, 88]
+ */
+TARGET static inline __m256 exp_ps(__m256 x) {
+    x = _mm256_min_ps(x, _mm256_set1_ps(88.0f));
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+
+    // x = n * ln(2) + r, |r| <= ln(2) / 2
+    const __m256 n = _mm256_round_ps(
+        _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+        (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+    );
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+
+    // exp(r)
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    // 2^n by the exponent bits
+    const __m256i e = _mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23
+    );
+
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[in] x Vector
+ * @return log(x), NaN if x < 0, -inf if x = 0
+ * @note Cephes polynomial, max. error is 1 ULP for positive x
+ */
+TARGET static inline __m256 log_ps(const __m256 x) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    // Scale denormals up into normals
+    const __m256 denormal = _mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ);
+    const __m256 xs = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(8388608.0f)), denormal);
+
+    // x = m * 2^e, 0.5 <= m < 1 by the exponent bits
+    const __m256i bits = _mm256_castps_si256(xs);
+    __m256 e = _mm256_cvtepi32_ps(
+        _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126))
+    );
+    e = _mm256_sub_ps(e, _mm256_and_ps(denormal, _mm256_set1_ps(23.0f)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)
+    ));
+
+    // Into sqrt(0.5) <= m < sqrt(2)
+    const __m256 small = _mm256_cmp_ps(
+        m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ
+    );
+    e = _mm256_sub_ps(e, _mm256_and_ps(small, one));
+    m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(small, m));
+
+    // log(1 + m)
+    const __m256 z = _mm256_mul_ps(m, m);
+    __m256 p = _mm256_set1_ps(7.0376836292e-2f);
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.1514610310e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.1676998740e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.2420140846e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.4249322787e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.6668057665e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(2.0000714765e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-2.4999993993e-1f));
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(3.3333331174e-1f));
+
+    __m256 y = _mm256_mul_ps(_mm256_mul_ps(p, m), z);
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+    y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+
+    // Special cases
+    const __m256 zero = _mm256_setzero_ps();
+    y = _mm256_blendv_ps(
+        y, x, _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ)
+    );
+    y = _mm256_blendv_ps(
+        y, _mm256_set1_ps(-INFINITY), _mm256_cmp_ps(x, zero, _CMP_EQ_OQ)
+    );
+    return _mm256_blendv_ps(
+        y, _mm256_set1_ps(NAN), _mm256_cmp_ps(x, zero, _CMP_NGE_UQ)
+    );
+}
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[in] x Vector
+ * @return 1 / (1 + exp(-x))
+ */
+TARGET static inline __m256 sigmoid_ps(const __m256 x) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 e = exp_ps(_mm256_sub_ps(_mm256_setzero_ps(), x));
+    return _mm256_div_ps(one, _mm256_add_ps(one, e));
+}
+
+/**
+ * @brief Multiply packed panels into a register tile
+ *
+ * @param[in] kc Depth of the panels
+ * @param[in] ap Packed panel of A
+ * @param[in] bp Packed panel of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Top-left element of the tile
+ * @param[in] ldc Leading dimension of C
+ * @param[in] mr Number of valid rows of the tile
+ * @param[in] nr Number of valid columns of the tile
+ */
+TARGET static void gemm(
+    const int kc, const float *ap, const float *bp,
+    const float beta, float *c, const int ldc, const int mr, const int nr
+) {
+    __m256 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; i++) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+
+    for (int p = 0; p < kc; p++) {
+        const __m256 b0 = _mm256_loadu_ps(&bp[0]);
+        const __m256 b1 = _mm256_loadu_ps(&bp[8]);
+        for (int i = 0; i < GEMM_MR; i++) {
+            const __m256 a = _mm256_broadcast_ss(&ap[i]);
+            acc[i][0] = _mm256_fmadd_ps(a, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(a, b1, acc[i][1]);
+        }
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+
+    if ((mr == GEMM_MR) && (nr == GEMM_NR)) {
+        const __m256 vbeta = _mm256_set1_ps(beta);
+        for (int i = 0; i < GEMM_MR; i++) {
+            float *c_row = &c[i * ldc];
+            if (beta != 0) {
+                acc[i][0] = _mm256_fmadd_ps(vbeta, _mm256_loadu_ps(&c_row[0]), acc[i][0]);
+                acc[i][1] = _mm256_fmadd_ps(vbeta, _mm256_loadu_ps(&c_row[8]), acc[i][1]);
+            }
+            _mm256_storeu_ps(&c_row[0], acc[i][0]);
+            _mm256_storeu_ps(&c_row[8], acc[i][1]);
+        }
+        return;
+    }
+
+    // Write back valid elements of an edge tile
+    float tile[GEMM_MR][GEMM_NR];
+    for (int i = 0; i < GEMM_MR; i++) {
+        _mm256_storeu_ps(&tile[i][0], acc[i][0]);
+        _mm256_storeu_ps(&tile[i][8], acc[i][1]);
+    }
+
+    for (int i = 0; i < mr; i++) {
+        float *c_row = &c[i * ldc];
+        for (int j = 0; j < nr; j++) {
+            c_row[j] = (beta == 0) ? tile[i][j] : (tile[i][j] + beta * c_row[j]);
+        }
+    }
+}
+
+/**
+ * @brief Dot product of 2 vectors
+ *
+ * @param[in] x Vector
+ * @param[in] y Vector
+ * @param[in] size Number of elements
+ * @return Dot product
+ */
+TARGET static float dot(const float *x, const float *y, const int size) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i <= (size - 16); i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[i]), _mm256_loadu_ps(&y[i]), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(&x[i + 8]), _mm256_loadu_ps(&y[i + 8]), acc1);
+    }
+    for (; i < size; i += 8) {
+        const __m256i mask = tail_mask(size - i);
+        acc0 = _mm256_fmadd_ps(
+            _mm256_maskload_ps(&x[i], mask), _mm256_maskload_ps(&y[i], mask), acc0
+        );
+    }
+
+    return hsum(_mm256_add_ps(acc0, acc1));
+}
+
+/**
+ * @brief Add a bias to each row of a matrix
+ *
+ * @param[in,out] y Row-major matrix
+ * @param[in] b Bias vector
+ * @param[in] rows Number of rows
+ * @param[in] cols Number of columns, elements of the bias
+ */
+TARGET static void add_bias(float *y, const float *b, const int rows, const int cols) {
+    for (int i = 0; i < rows; i++) {
+        float *y_row = &y[i * cols];
+
+        int j = 0;
+        for (; j <= (cols - 8); j += 8) {
+            _mm256_storeu_ps(
+                &y_row[j], _mm256_add_ps(_mm256_loadu_ps(&y_row[j]), _mm256_loadu_ps(&b[j]))
+            );
+        }
+        if (j < cols) {
+            const __m256i mask = tail_mask(cols - j);
+            _mm256_maskstore_ps(
+                &y_row[j], mask,
+                _mm256_add_ps(_mm256_maskload_ps(&y_row[j], mask), _mm256_maskload_ps(&b[j], mask))
+            );
+        }
+    }
+}
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void exp_vector(float *y, const float *x, const int size) {
+    int i = 0;
+    for (; i <= (size - 8); i += 8) {
+        _mm256_storeu_ps(&y[i], exp_ps(_mm256_loadu_ps(&x[i])));
+    }
+    if (i < size) {
+        const __m256i mask = tail_mask(size - i);
+        _mm256_maskstore_ps(&y[i], mask, exp_ps(_mm256_maskload_ps(&x[i], mask)));
+    }
+}
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void log_vector(float *y, const float *x, const int size) {
+    int i = 0;
+    for (; i <= (size - 8); i += 8) {
+        _mm256_storeu_ps(&y[i], log_ps(_mm256_loadu_ps(&x[i])));
+    }
+    if (i < size) {
+        const __m256i mask = tail_mask(size - i);
+        _mm256_maskstore_ps(&y[i], mask, log_ps(_mm256_maskload_ps(&x[i], mask)));
+    }
+}
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void sigmoid(float *y, const float *x, const int size) {
+    int i = 0;
+    for (; i <= (size - 8); i += 8) {
+        _mm256_storeu_ps(&y[i], sigmoid_ps(_mm256_loadu_ps(&x[i])));
+    }
+    if (i < size) {
+        const __m256i mask = tail_mask(size - i);
+        _mm256_maskstore_ps(&y[i], mask, sigmoid_ps(_mm256_maskload_ps(&x[i], mask)));
+    }
+}
+
+/**
+ * @brief Softmax of a vector
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void softmax(float *y, const float *x, const int size) {
+    const int tail = size % 8;
+    const int body = size - tail;
+    const __m256i mask = tail_mask(tail);
+
+    // Get a max. of the input to avoid overflow of exp(x)
+    __m256 vmax = _mm256_set1_ps(-FLT_MAX);
+    for (int i = 0; i < body; i += 8) {
+        vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(&x[i]));
+    }
+    if (tail > 0) {
+        vmax = _mm256_max_ps(
+            vmax,
+            _mm256_blendv_ps(
+                _mm256_set1_ps(-FLT_MAX),
+                _mm256_maskload_ps(&x[body], mask),
+                _mm256_castsi256_ps(mask)
+            )
+        );
+    }
+    const __m256 c = _mm256_set1_ps(hmax(vmax));
+
+    // Keep exp(x - c) in the output not to calculate it twice
+    __m256 vsum = _mm256_setzero_ps();
+    for (int i = 0; i < body; i += 8) {
+        const __m256 e = exp_ps(_mm256_sub_ps(_mm256_loadu_ps(&x[i]), c));
+        _mm256_storeu_ps(&y[i], e);
+        vsum = _mm256_add_ps(vsum, e);
+    }
+    if (tail > 0) {
+        const __m256 e = _mm256_and_ps(
+            exp_ps(_mm256_sub_ps(_mm256_maskload_ps(&x[body], mask), c)),
+            _mm256_castsi256_ps(mask)
+        );
+        _mm256_maskstore_ps(&y[body], mask, e);
+        vsum = _mm256_add_ps(vsum, e);
+    }
+
+    const __m256 scale = _mm256_set1_ps(1.0f / hsum(vsum));
+    for (int i = 0; i < body; i += 8) {
+        _mm256_storeu_ps(&y[i], _mm256_mul_ps(_mm256_loadu_ps(&y[i]), scale));
+    }
+    if (tail > 0) {
+        _mm256_maskstore_ps(
+            &y[body], mask, _mm256_mul_ps(_mm256_maskload_ps(&y[body], mask), scale)
+        );
+    }
+}
+
+/**
+ * @brief Gradient of the input of softmax
+ *
+ * @param[out] gx Gradient of the input vector
+ * @param[in] y Output vector of softmax
+ * @param[in] gy Gradient of the output vector
+ * @param[in] size Number of elements
+ */
+TARGET static void softmax_grad(float *gx, const float *y, const float *gy, const int size) {
+    // Product of the Jacobian diag(y) - y * y^T and gy
+    const __m256 gy_y = _mm256_set1_ps(dot(gy, y, size));
+
+    int i = 0;
+    for (; i <= (size - 8); i += 8) {
+        _mm256_storeu_ps(
+            &gx[i],
+            _mm256_mul_ps(
+                _mm256_loadu_ps(&y[i]), _mm256_sub_ps(_mm256_loadu_ps(&gy[i]), gy_y)
+            )
+        );
+    }
+    if (i < size) {
+        const __m256i mask = tail_mask(size - i);
+        _mm256_maskstore_ps(
+            &gx[i], mask,
+            _mm256_mul_ps(
+                _mm256_maskload_ps(&y[i], mask),
+                _mm256_sub_ps(_mm256_maskload_ps(&gy[i], mask), gy_y)
+            )
+        );
+    }
+}
+
+/**
+ * @brief Update of SGD
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ */
+TARGET static void sgd(float *w, const float *g, const int size, const float learning_rate) {
+    const __m256 lr = _mm256_set1_ps(learning_rate);
+
+    for (int i = 0; i < size; i += 8) {
+        // Memory bound, masked loads also for the body
+        const __m256i mask = ((size - i) >= 8) ? _mm256_set1_epi32(-1) : tail_mask(size - i);
+        _mm256_maskstore_ps(
+            &w[i], mask,
+            _mm256_fnmadd_ps(lr, _mm256_maskload_ps(&g[i], mask), _mm256_maskload_ps(&w[i], mask))
+        );
+    }
+}
+
+/**
+ * @brief Update of SGD with momentum
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] v Velocity vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ * @param[in] momentum Momentum factor
+ * @param[in] nesterov Nesterov momentum
+ */
+TARGET static void momentum(
+    float *w, float *v, const float *g, const int size,
+    const float learning_rate, const float momentum, const bool nesterov
+) {
+    const __m256 lr = _mm256_set1_ps(learning_rate);
+    const __m256 mu = _mm256_set1_ps(momentum);
+
+    for (int i = 0; i < size; i += 8) {
+        const __m256i mask = ((size - i) >= 8) ? _mm256_set1_epi32(-1) : tail_mask(size - i);
+        const __m256 g_i = _mm256_maskload_ps(&g[i], mask);
+        const __m256 v_i = _mm256_fmadd_ps(mu, _mm256_maskload_ps(&v[i], mask), g_i);
+        const __m256 d = nesterov ? _mm256_fmadd_ps(mu, v_i, g_i) : v_i;
+
+        _mm256_maskstore_ps(&v[i], mask, v_i);
+        _mm256_maskstore_ps(
+            &w[i], mask, _mm256_fnmadd_ps(lr, d, _mm256_maskload_ps(&w[i], mask))
+        );
+    }
+}
+
+/**
+ * @brief Update of Adam
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] m 1st moment vector, NULL to use the gradient as is
+ * @param[in,out] v 2nd moment vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] coeffs Coefficients of the step
+ */
+TARGET static void adam(
+    float *w, float *m, float *v, const float *g, const int size, const AdamCoeffs *coeffs
+) {
+    const __m256 beta1 = _mm256_set1_ps(coeffs->beta1);
+    const __m256 beta1_c = _mm256_set1_ps(1 - coeffs->beta1);
+    const __m256 beta2 = _mm256_set1_ps(coeffs->beta2);
+    const __m256 beta2_c = _mm256_set1_ps(1 - coeffs->beta2);
+    const __m256 eps = _mm256_set1_ps(coeffs->eps);
+    const __m256 bias2 = _mm256_set1_ps(coeffs->bias2);
+    const __m256 step_size = _mm256_set1_ps(coeffs->learning_rate * coeffs->bias1);
+    const __m256 decay = _mm256_set1_ps(1 - coeffs->learning_rate * coeffs->weight_decay);
+
+    for (int i = 0; i < size; i += 8) {
+        const __m256i mask = ((size - i) >= 8) ? _mm256_set1_epi32(-1) : tail_mask(size - i);
+        const __m256 g_i = _mm256_maskload_ps(&g[i], mask);
+
+        __m256 m_i = g_i;
+        if (m != NULL) {
+            m_i = _mm256_fmadd_ps(
+                beta1, _mm256_maskload_ps(&m[i], mask), _mm256_mul_ps(beta1_c, g_i)
+            );
+            _mm256_maskstore_ps(&m[i], mask, m_i);
+        }
+
+        const __m256 v_i = _mm256_fmadd_ps(
+            beta2, _mm256_maskload_ps(&v[i], mask),
+            _mm256_mul_ps(beta2_c, _mm256_mul_ps(g_i, g_i))
+        );
+        _mm256_maskstore_ps(&v[i], mask, v_i);
+
+        const __m256 denom = _mm256_fmadd_ps(_mm256_sqrt_ps(v_i), bias2, eps);
+        _mm256_maskstore_ps(
+            &w[i], mask,
+            _mm256_fnmadd_ps(
+                step_size, _mm256_div_ps(m_i, denom),
+                _mm256_mul_ps(decay, _mm256_maskload_ps(&w[i], mask))
+            )
+        );
+    }
+}
+
+/**
+ * @brief Convert unsigned bytes to floats with a scale
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input bytes
+ * @param[in] size Number of elements
+ * @param[in] scale Scale
+ */
+TARGET static void u8_to_float(float *y, const uint8_t *x, const int size, const float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+
+    int i = 0;
+    for (; i <= (size - 8); i += 8) {
+        const __m256i x32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&x[i]));
+        _mm256_storeu_ps(&y[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x32), s));
+    }
+
+    if (i < size) {
+        // No masked loads of bytes, the tail is copied to a padded buffer
+        uint8_t tail[8] = { 0 };
+        memcpy(tail, &x[i], (size_t)(size - i));
+        const __m256i x32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)tail));
+        _mm256_maskstore_ps(&y[i], tail_mask(size - i), _mm256_mul_ps(_mm256_cvtepi32_ps(x32), s));
+    }
+}
+
+/**
+ * @brief Kernel table
+ */
+static const Kernels table = {
+    .isa = KERNELS_ISA_AVX2,
+    .gemm_mr = GEMM_MR,
+    .gemm_nr = GEMM_NR,
+    .gemm = gemm,
+    .dot = dot,
+    .add_bias = add_bias,
+    .exp = exp_vector,
+    .log = log_vector,
+    .sigmoid = sigmoid,
+    .softmax = softmax,
+    .softmax_grad = softmax_grad,
+    .sgd = sgd,
+    .momentum = momentum,
+    .adam = adam,
+    .u8_to_float = u8_to_float
+};
+
+const Kernels *avx2_kernels(void) {
+    return &table;
+}
+
+#else
+
+const Kernels *avx2_kernels(void) {
+    return NULL;
+}
+
+#endif
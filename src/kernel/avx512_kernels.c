@@ -0,0 +1,506 @@
+/**
+ * @file avx512_kernels.c
+ * @brief AVX-512 kernels
+ */
+#include "kernel/avx512_kernels.h"
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <float.h>
+#include <immintrin.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Compile a function for AVX-512F regardless of build flags
+ */
+#define TARGET __attribute__((target("avx512f")))
+
+/**
+ * @brief Number of rows of a register tile
+ */
+#define GEMM_MR 6
+
+/**
+ * @brief Number of columns of a register tile, 2 ZMM registers for a row
+ */
+#define GEMM_NR 32
+
+/**
+ * @brief Get a mask of the first elements of a vector
+ *
+ * @param[in] size Number of elements to be enabled, less than 16
+ * @return Mask
+ */
+static inline __mmask16 tail_mask(const int size) {
+    return (__mmask16)((1u << size) - 1);
+}
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[in] x Vector
+ * @return exp(x), x is clamped into [-87, 88]
+ * @note Cephes polynomial, max. error is 2 ULP in [-87, 88]
+ */
+TARGET static inline __m512 exp_ps(__m512 x) {
+    x = _mm512_min_ps(x, _mm512_set1_ps(88.0f));
+    x = _mm512_max_ps(x, _mm512_set1_ps(-87.0f));
+
+    // x = n * ln(2) + r, |r| <= ln(2) / 2
+    const __m512 n = _mm512_roundscale_ps(
+        _mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+        (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+    );
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+
+    // exp(r)
+    __m512 p = _mm512_set1_ps(1.9875691500e-4f);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894e-2f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459e-1f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201e-1f));
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+
+    // p * 2^n
+    return _mm512_scalef_ps(p, n);
+}
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[in] x Vector
+ * @return log(x), NaN if x < 0, -inf if x = 0
+ * @note Cephes polynomial, max. error is 1 ULP for positive x
+ */
+TARGET static inline __m512 log_ps(const __m512 x) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    // x = m * 2^e, sqrt(0.5) <= m < sqrt(2), handles denormals
+    __m512 m = _mm512_getmant_ps(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+    __m512 e = _mm512_getexp_ps(x);
+    const __mmask16 large = _mm512_cmp_ps_mask(
+        m, _mm512_set1_ps(1.41421356237309505f), _CMP_GT_OQ
+    );
+    m = _mm512_mask_mul_ps(m, large, m, _mm512_set1_ps(0.5f));
+    e = _mm512_mask_add_ps(e, large, e, one);
+    m = _mm512_sub_ps(m, one);
+
+    // log(1 + m)
+    const __m512 z = _mm512_mul_ps(m, m);
+    __m512 p = _mm512_set1_ps(7.0376836292e-2f);
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.1514610310e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(1.1676998740e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.2420140846e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(1.4249322787e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.6668057665e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(2.0000714765e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-2.4999993993e-1f));
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(3.3333331174e-1f));
+
+    __m512 y = _mm512_mul_ps(_mm512_mul_ps(p, m), z);
+    y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), y);
+    y = _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, y);
+    y = _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), _mm512_add_ps(m, y));
+
+    // Special cases
+    const __m512 zero = _mm512_setzero_ps();
+    y = _mm512_mask_mov_ps(
+        y, _mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ), x
+    );
+    y = _mm512_mask_mov_ps(
+        y, _mm512_cmp_ps_mask(x, zero, _CMP_EQ_OQ), _mm512_set1_ps(-INFINITY)
+    );
+    return _mm512_mask_mov_ps(
+        y, _mm512_cmp_ps_mask(x, zero, _CMP_NGE_UQ), _mm512_set1_ps(NAN)
+    );
+}
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[in] x Vector
+ * @return 1 / (1 + exp(-x))
+ */
+TARGET static inline __m512 sigmoid_ps(const __m512 x) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 e = exp_ps(_mm512_sub_ps(_mm512_setzero_ps(), x));
+    return _mm512_div_ps(one, _mm512_add_ps(one, e));
+}
+
+/**
+ * @brief Multiply packed panels into a register tile
+ *
+ * @param[in] kc Depth of the panels
+ * @param[in] ap Packed panel of A
+ * @param[in] bp Packed panel of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Top-left element of the tile
+ * @param[in] ldc Leading dimension of C
+ * @param[in] mr Number of valid rows of the tile
+ * @param[in] nr Number of valid columns of the tile
+ */
+TARGET static void gemm(
+    const int kc, const float *ap, const float *bp,
+    const float beta, float *c, const int ldc, const int mr, const int nr
+) {
+    __m512 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; i++) {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+
+    for (int p = 0; p < kc; p++) {
+        const __m512 b0 = _mm512_loadu_ps(&bp[0]);
+        const __m512 b1 = _mm512_loadu_ps(&bp[16]);
+        for (int i = 0; i < GEMM_MR; i++) {
+            const __m512 a = _mm512_set1_ps(ap[i]);
+            acc[i][0] = _mm512_fmadd_ps(a, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(a, b1, acc[i][1]);
+        }
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+
+    // Columns of an edge tile are masked, rows are skipped
+    const __mmask16 mask0 = (nr >= 16) ? 0xffff : tail_mask(nr);
+    const __mmask16 mask1 = (nr >= 32) ? 0xffff : ((nr > 16) ? tail_mask(nr - 16) : 0);
+    const __m512 vbeta = _mm512_set1_ps(beta);
+
+    for (int i = 0; i < mr; i++) {
+        float *c_row = &c[i * ldc];
+        if (beta != 0) {
+            acc[i][0] = _mm512_fmadd_ps(
+                vbeta, _mm512_maskz_loadu_ps(mask0, &c_row[0]), acc[i][0]
+            );
+            acc[i][1] = _mm512_fmadd_ps(
+                vbeta, _mm512_maskz_loadu_ps(mask1, &c_row[16]), acc[i][1]
+            );
+        }
+        _mm512_mask_storeu_ps(&c_row[0], mask0, acc[i][0]);
+        _mm512_mask_storeu_ps(&c_row[16], mask1, acc[i][1]);
+    }
+}
+
+/**
+ * @brief Dot product of 2 vectors
+ *
+ * @param[in] x Vector
+ * @param[in] y Vector
+ * @param[in] size Number of elements
+ * @return Dot product
+ */
+TARGET static float dot(const float *x, const float *y, const int size) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+
+    int i = 0;
+    for (; i <= (size - 32); i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(&x[i]), _mm512_loadu_ps(&y[i]), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(&x[i + 16]), _mm512_loadu_ps(&y[i + 16]), acc1);
+    }
+    for (; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        acc0 = _mm512_fmadd_ps(
+            _mm512_maskz_loadu_ps(mask, &x[i]), _mm512_maskz_loadu_ps(mask, &y[i]), acc0
+        );
+    }
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+/**
+ * @brief Add a bias to each row of a matrix
+ *
+ * @param[in,out] y Row-major matrix
+ * @param[in] b Bias vector
+ * @param[in] rows Number of rows
+ * @param[in] cols Number of columns, elements of the bias
+ */
+TARGET static void add_bias(float *y, const float *b, const int rows, const int cols) {
+    for (int i = 0; i < rows; i++) {
+        float *y_row = &y[i * cols];
+
+        for (int j = 0; j < cols; j += 16) {
+            const __mmask16 mask = ((cols - j) >= 16) ? 0xffff : tail_mask(cols - j);
+            _mm512_mask_storeu_ps(
+                &y_row[j], mask,
+                _mm512_add_ps(
+                    _mm512_maskz_loadu_ps(mask, &y_row[j]), _mm512_maskz_loadu_ps(mask, &b[j])
+                )
+            );
+        }
+    }
+}
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void exp_vector(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(&y[i], mask, exp_ps(_mm512_maskz_loadu_ps(mask, &x[i])));
+    }
+}
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void log_vector(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(&y[i], mask, log_ps(_mm512_maskz_loadu_ps(mask, &x[i])));
+    }
+}
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void sigmoid(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(&y[i], mask, sigmoid_ps(_mm512_maskz_loadu_ps(mask, &x[i])));
+    }
+}
+
+/**
+ * @brief Softmax of a vector
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+TARGET static void softmax(float *y, const float *x, const int size) {
+    // Get a max. of the input to avoid overflow of exp(x)
+    __m512 vmax = _mm512_set1_ps(-FLT_MAX);
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        vmax = _mm512_mask_max_ps(vmax, mask, vmax, _mm512_maskz_loadu_ps(mask, &x[i]));
+    }
+    const __m512 c = _mm512_set1_ps(_mm512_reduce_max_ps(vmax));
+
+    // Keep exp(x - c) in the output not to calculate it twice
+    __m512 vsum = _mm512_setzero_ps();
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        const __m512 e = _mm512_maskz_mov_ps(
+            mask, exp_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, &x[i]), c))
+        );
+        _mm512_mask_storeu_ps(&y[i], mask, e);
+        vsum = _mm512_add_ps(vsum, e);
+    }
+
+    const __m512 scale = _mm512_set1_ps(1.0f / _mm512_reduce_add_ps(vsum));
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(
+            &y[i], mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, &y[i]), scale)
+        );
+    }
+}
+
+/**
+ * @brief Gradient of the input of softmax
+ *
+ * @param[out] gx Gradient of the input vector
+ * @param[in] y Output vector of softmax
+ * @param[in] gy Gradient of the output vector
+ * @param[in] size Number of elements
+ */
+TARGET static void softmax_grad(float *gx, const float *y, const float *gy, const int size) {
+    // Product of the Jacobian diag(y) - y * y^T and gy
+    const __m512 gy_y = _mm512_set1_ps(dot(gy, y, size));
+
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(
+            &gx[i], mask,
+            _mm512_mul_ps(
+                _mm512_maskz_loadu_ps(mask, &y[i]),
+                _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, &gy[i]), gy_y)
+            )
+        );
+    }
+}
+
+/**
+ * @brief Update of SGD
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ */
+TARGET static void sgd(float *w, const float *g, const int size, const float learning_rate) {
+    const __m512 lr = _mm512_set1_ps(learning_rate);
+
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        _mm512_mask_storeu_ps(
+            &w[i], mask,
+            _mm512_fnmadd_ps(
+                lr, _mm512_maskz_loadu_ps(mask, &g[i]), _mm512_maskz_loadu_ps(mask, &w[i])
+            )
+        );
+    }
+}
+
+/**
+ * @brief Update of SGD with momentum
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] v Velocity vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ * @param[in] momentum Momentum factor
+ * @param[in] nesterov Nesterov momentum
+ */
+TARGET static void momentum(
+    float *w, float *v, const float *g, const int size,
+    const float learning_rate, const float momentum, const bool nesterov
+) {
+    const __m512 lr = _mm512_set1_ps(learning_rate);
+    const __m512 mu = _mm512_set1_ps(momentum);
+
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        const __m512 g_i = _mm512_maskz_loadu_ps(mask, &g[i]);
+        const __m512 v_i = _mm512_fmadd_ps(mu, _mm512_maskz_loadu_ps(mask, &v[i]), g_i);
+        const __m512 d = nesterov ? _mm512_fmadd_ps(mu, v_i, g_i) : v_i;
+
+        _mm512_mask_storeu_ps(&v[i], mask, v_i);
+        _mm512_mask_storeu_ps(
+            &w[i], mask, _mm512_fnmadd_ps(lr, d, _mm512_maskz_loadu_ps(mask, &w[i]))
+        );
+    }
+}
+
+/**
+ * @brief Update of Adam
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] m 1st moment vector, NULL to use the gradient as is
+ * @param[in,out] v 2nd moment vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] coeffs Coefficients of the step
+ */
+TARGET static void adam(
+    float *w, float *m, float *v, const float *g, const int size, const AdamCoeffs *coeffs
+) {
+    const __m512 beta1 = _mm512_set1_ps(coeffs->beta1);
+    const __m512 beta1_c = _mm512_set1_ps(1 - coeffs->beta1);
+    const __m512 beta2 = _mm512_set1_ps(coeffs->beta2);
+    const __m512 beta2_c = _mm512_set1_ps(1 - coeffs->beta2);
+    const __m512 eps = _mm512_set1_ps(coeffs->eps);
+    const __m512 bias2 = _mm512_set1_ps(coeffs->bias2);
+    const __m512 step_size = _mm512_set1_ps(coeffs->learning_rate * coeffs->bias1);
+    const __m512 decay = _mm512_set1_ps(1 - coeffs->learning_rate * coeffs->weight_decay);
+
+    for (int i = 0; i < size; i += 16) {
+        const __mmask16 mask = ((size - i) >= 16) ? 0xffff : tail_mask(size - i);
+        const __m512 g_i = _mm512_maskz_loadu_ps(mask, &g[i]);
+
+        __m512 m_i = g_i;
+        if (m != NULL) {
+            m_i = _mm512_fmadd_ps(
+                beta1, _mm512_maskz_loadu_ps(mask, &m[i]), _mm512_mul_ps(beta1_c, g_i)
+            );
+            _mm512_mask_storeu_ps(&m[i], mask, m_i);
+        }
+
+        const __m512 v_i = _mm512_fmadd_ps(
+            beta2, _mm512_maskz_loadu_ps(mask, &v[i]),
+            _mm512_mul_ps(beta2_c, _mm512_mul_ps(g_i, g_i))
+        );
+        _mm512_mask_storeu_ps(&v[i], mask, v_i);
+
+        const __m512 denom = _mm512_fmadd_ps(_mm512_sqrt_ps(v_i), bias2, eps);
+        _mm512_mask_storeu_ps(
+            &w[i], mask,
+            _mm512_fnmadd_ps(
+                step_size, _mm512_div_ps(m_i, denom),
+                _mm512_mul_ps(decay, _mm512_maskz_loadu_ps(mask, &w[i]))
+            )
+        );
+    }
+}
+
+/**
+ * @brief Convert unsigned bytes to floats with a scale
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input bytes
+ * @param[in] size Number of elements
+ * @param[in] scale Scale
+ */
+TARGET static void u8_to_float(float *y, const uint8_t *x, const int size, const float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+
+    int i = 0;
+    for (; i <= (size - 16); i += 16) {
+        const __m512i x32 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&x[i]));
+        _mm512_storeu_ps(&y[i], _mm512_mul_ps(_mm512_cvtepi32_ps(x32), s));
+    }
+
+    if (i < size) {
+        // Masked loads of bytes need AVX-512BW, the tail is copied to a padded buffer
+        uint8_t tail[16] = { 0 };
+        memcpy(tail, &x[i], (size_t)(size - i));
+        const __m512i x32 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)tail));
+        _mm512_mask_storeu_ps(
+            &y[i], tail_mask(size - i), _mm512_mul_ps(_mm512_cvtepi32_ps(x32), s)
+        );
+    }
+}
+
+/**
+ * @brief Kernel table
+ */
+static const Kernels table = {
+    .isa = KERNELS_ISA_AVX512,
+    .gemm_mr = GEMM_MR,
+    .gemm_nr = GEMM_NR,
+    .gemm = gemm,
+    .dot = dot,
+    .add_bias = add_bias,
+    .exp = exp_vector,
+    .log = log_vector,
+    .sigmoid = sigmoid,
+    .softmax = softmax,
+    .softmax_grad = softmax_grad,
+    .sgd = sgd,
+    .momentum = momentum,
+    .adam = adam,
+    .u8_to_float = u8_to_float
+};
+
+const Kernels *avx512_kernels(void) {
+    return &table;
+}
+
+#else
+
+const Kernels *avx512_kernels(void) {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * @file generic_kernels.c
+ * @brief Portable C kernels
+ */
+#include "kernel/generic_kernels.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Number of rows of a register tile
+ */
+#define GEMM_MR 4
+
+/**
+ * @brief Number of columns of a register tile, 2 SSE registers for a row
+ */
+#define GEMM_NR 8
+
+/**
+ * @brief exp(x) by a polynomial approximation
+ *
+ * @param[in] x Input
+ * @return exp(x), x is clamped into [-87, 88]
+ * @note Cephes polynomial, same as SIMD kernels
+ */
+static inline float exp_approx(float x) {
+    x = (x < 88.0f) ? x : 88.0f;
+    x = (x > -87.0f) ? x : -87.0f;
+
+    // x = n * ln(2) + r, |r| <= ln(2) / 2
+    const float n = floorf(x * 1.44269504088896341f + 0.5f);
+    float r = x - n * 0.693359375f;
+    r = r - n * -2.12194440e-4f;
+
+    // exp(r)
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * (r * r) + (r + 1.0f);
+
+    // 2^n by the exponent bits
+    const uint32_t bits = (uint32_t)((int32_t)n + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(float));
+
+    return p * scale;
+}
+
+/**
+ * @brief Natural log(x) by a polynomial approximation
+ *
+ * @param[in] x Input
+ * @return log(x), NaN if x < 0, -inf if x = 0
+ * @note Cephes polynomial, same as SIMD kernels
+ */
+static inline float log_approx(const float x) {
+    if (!(x > 0)) {
+        return (x == 0) ? -INFINITY : NAN;
+    }
+    if (isinf(x)) {
+        return x;
+    }
+
+    // x = m * 2^e, sqrt(0.5) <= m < sqrt(2)
+    int e;
+    float m = frexpf(x, &e);
+    if (m < 0.707106781186547524f) {
+        e--;
+        m = m + m - 1.0f;
+    } else {
+        m = m - 1.0f;
+    }
+
+    // log(1 + m)
+    const float z = m * m;
+    float p = 7.0376836292e-2f;
+    p = p * m - 1.1514610310e-1f;
+    p = p * m + 1.1676998740e-1f;
+    p = p * m - 1.2420140846e-1f;
+    p = p * m + 1.4249322787e-1f;
+    p = p * m - 1.6668057665e-1f;
+    p = p * m + 2.0000714765e-1f;
+    p = p * m - 2.4999993993e-1f;
+    p = p * m + 3.3333331174e-1f;
+
+    float y = p * m * z;
+    y += (float)e * -2.12194440e-4f;
+    y -= 0.5f * z;
+
+    return (m + y) + (float)e * 0.693359375f;
+}
+
+/**
+ * @brief Multiply packed panels into a register tile
+ *
+ * @param[in] kc Depth of the panels
+ * @param[in] ap Packed panel of A
+ * @param[in] bp Packed panel of B
+ * @param[in] beta Scale of C before accumulation, C is not read if 0
+ * @param[in,out] c Top-left element of the tile
+ * @param[in] ldc Leading dimension of C
+ * @param[in] mr Number of valid rows of the tile
+ * @param[in] nr Number of valid columns of the tile
+ */
+static void gemm(
+    const int kc, const float *ap, const float *bp,
+    const float beta, float *c, const int ldc, const int mr, const int nr
+) {
+    float acc[GEMM_MR][GEMM_NR] = { { 0 } };
+
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            const float a = ap[i];
+            for (int j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += a * bp[j];
+            }
+        }
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+
+    for (int i = 0; i < mr; i++) {
+        float *c_row = &c[i * ldc];
+        if (beta == 0) {
+            for (int j = 0; j < nr; j++) {
+                c_row[j] = acc[i][j];
+            }
+        } else {
+            for (int j = 0; j < nr; j++) {
+                c_row[j] = acc[i][j] + beta * c_row[j];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Dot product of 2 vectors
+ *
+ * @param[in] x Vector
+ * @param[in] y Vector
+ * @param[in] size Number of elements
+ * @return Dot product
+ */
+static float dot(const float *x, const float *y, const int size) {
+    float mac = 0;
+
+    for (int i = 0; i < size; i++) {
+        mac += x[i] * y[i];
+    }
+
+    return mac;
+}
+
+/**
+ * @brief Add a bias to each row of a matrix
+ *
+ * @param[in,out] y Row-major matrix
+ * @param[in] b Bias vector
+ * @param[in] rows Number of rows
+ * @param[in] cols Number of columns, elements of the bias
+ */
+static void add_bias(float *y, const float *b, const int rows, const int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            y[i * cols + j] += b[j];
+        }
+    }
+}
+
+/**
+ * @brief Elementwise exp(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+static void exp_vector(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i++) {
+        y[i] = exp_approx(x[i]);
+    }
+}
+
+/**
+ * @brief Elementwise natural log(x)
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+static void log_vector(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i++) {
+        y[i] = log_approx(x[i]);
+    }
+}
+
+/**
+ * @brief Elementwise sigmoid
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+static void sigmoid(float *y, const float *x, const int size) {
+    for (int i = 0; i < size; i++) {
+        y[i] = 1 / (1 + exp_approx(-x[i]));
+    }
+}
+
+/**
+ * @brief Softmax of a vector
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input vector
+ * @param[in] size Number of elements
+ */
+static void softmax(float *y, const float *x, const int size) {
+    // Get a max. of the input to avoid overflow of exp(x)
+    float c = -FLT_MAX;
+    for (int i = 0; i < size; i++) {
+        c = (x[i] > c) ? x[i] : c;
+    }
+
+    // Keep exp(x - c) in the output not to calculate it twice
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        y[i] = exp_approx(x[i] - c);
+        sum += y[i];
+    }
+
+    const float scale = 1.0f / sum;
+    for (int i = 0; i < size; i++) {
+        y[i] *= scale;
+    }
+}
+
+/**
+ * @brief Gradient of the input of softmax
+ *
+ * @param[out] gx Gradient of the input vector
+ * @param[in] y Output vector of softmax
+ * @param[in] gy Gradient of the output vector
+ * @param[in] size Number of elements
+ */
+static void softmax_grad(float *gx, const float *y, const float *gy, const int size) {
+    // Product of the Jacobian diag(y) - y * y^T and gy
+    const float gy_y = dot(gy, y, size);
+
+    for (int i = 0; i < size; i++) {
+        gx[i] = y[i] * (gy[i] - gy_y);
+    }
+}
+
+/**
+ * @brief Update of SGD
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ */
+static void sgd(float *w, const float *g, const int size, const float learning_rate) {
+    for (int i = 0; i < size; i++) {
+        w[i] -= learning_rate * g[i];
+    }
+}
+
+/**
+ * @brief Update of SGD with momentum
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] v Velocity vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] learning_rate Learning rate
+ * @param[in] momentum Momentum factor
+ * @param[in] nesterov Nesterov momentum
+ */
+static void momentum(
+    float *w, float *v, const float *g, const int size,
+    const float learning_rate, const float momentum, const bool nesterov
+) {
+    for (int i = 0; i < size; i++) {
+        v[i] = momentum * v[i] + g[i];
+        w[i] -= learning_rate * (nesterov ? (g[i] + momentum * v[i]) : v[i]);
+    }
+}
+
+/**
+ * @brief Update of Adam
+ *
+ * @param[in,out] w Parameter vector
+ * @param[in,out] m 1st moment vector, NULL to use the gradient as is
+ * @param[in,out] v 2nd moment vector
+ * @param[in] g Gradient vector
+ * @param[in] size Number of elements
+ * @param[in] coeffs Coefficients of the step
+ */
+static void adam(
+    float *w, float *m, float *v, const float *g, const int size, const AdamCoeffs *coeffs
+) {
+    const float step_size = coeffs->learning_rate * coeffs->bias1;
+    const float decay = 1 - coeffs->learning_rate * coeffs->weight_decay;
+
+    for (int i = 0; i < size; i++) {
+        float m_i = g[i];
+        if (m != NULL) {
+            m_i = coeffs->beta1 * m[i] + (1 - coeffs->beta1) * g[i];
+            m[i] = m_i;
+        }
+        v[i] = coeffs->beta2 * v[i] + (1 - coeffs->beta2) * g[i] * g[i];
+
+        w[i] = decay * w[i] - step_size * m_i / (sqrtf(v[i]) * coeffs->bias2 + coeffs->eps);
+    }
+}
+
+/**
+ * @brief Convert unsigned bytes to floats with a scale
+ *
+ * @param[out] y Output vector
+ * @param[in] x Input bytes
+ * @param[in] size Number of elements
+ * @param[in] scale Scale
+ */
+static void u8_to_float(float *y, const uint8_t *x, const int size, const float scale) {
+    for (int i = 0; i < size; i++) {
+        y[i] = (float)x[i] * scale;
+    }
+}
+
+/**
+ * @brief Kernel table
+ */
+static const Kernels table = {
+    .isa = KERNELS_ISA_GENERIC,
+    .gemm_mr = GEMM_MR,
+    .gemm_nr = GEMM_NR,
+    .gemm = gemm,
+    .dot = dot,
+    .add_bias = add_bias,
+    .exp = exp_vector,
+    .log = log_vector,
+    .sigmoid = sigmoid,
+    .softmax = softmax,
+    .softmax_grad = softmax_grad,
+    .sgd = sgd,
+    .momentum = momentum,
+    .adam = adam,
+    .u8_to_float = u8_to_float
+};
+
+const Kernels *generic_kernels(void) {
+    return &table;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file kernels.c
+ * @brief Compute kernels dispatched by CPU features
+ */
+#include "kernels.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu.h"
+#include "kernel/avx2_kernels.h"
+#include "kernel/avx512_kernels.h"
+#include "kernel/generic_kernels.h"
+
+/**
+ * @brief Selected kernels, published with release and read with acquire ordering
+ */
+static const Kernels *selected = NULL;
+
+/**
+ * @brief Get kernels of an instruction set
+ *
+ * @param[in] isa Instruction set
+ * @return Pointer to the kernel table, NULL if not supported
+ */
+static const Kernels *find_kernels(const KernelsIsa isa) {
+    const CpuFeatures *features = cpu_features();
+
+    switch (isa) {
+    case KERNELS_ISA_GENERIC:
+        return generic_kernels();
+    case KERNELS_ISA_AVX2:
+        return (features->avx2 && features->fma) ? avx2_kernels() : NULL;
+    case KERNELS_ISA_AVX512:
+        return features->avx512f ? avx512_kernels() : NULL;
+    default:
+        return NULL;
+    }
+}
+
+void kernels_init(void) {
+    const KernelsIsa preferred[] = {
+        KERNELS_ISA_AVX512,
+        KERNELS_ISA_AVX2,
+        KERNELS_ISA_GENERIC
+    };
+
+    for (size_t i = 0; i < (sizeof(preferred) / sizeof(preferred[0])); i++) {
+        if (kernels_select(preferred[i])) {
+            return;
+        }
+    }
+}
+
+bool kernels_select(const KernelsIsa isa) {
+    const Kernels *found = find_kernels(isa);
+    if (found == NULL) {
+        return false;
+    }
+
+    __atomic_store_n(&selected, found, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+const Kernels *kernels(void) {
+    // Threads racing on the first call select the same kernels
+    if (__atomic_load_n(&selected, __ATOMIC_ACQUIRE) == NULL) {
+        kernels_init();
+    }
+
+    return __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+}
@@ -5,14 +5,9 @@
 #include "layer.h"
 
 #include <stdbool.h>
-#include <stdlib.h>
+#include <stddef.h>
 
-#define FREE_AND_NULL(ptr) { \
-    free((ptr)); \
-    (ptr) = NULL; \
-}
-
-Layer *layer_alloc_params(Layer *layer) {
+Layer *layer_init(Layer *layer) {
     if ((layer == NULL) ||
         // Layer type is NONE or not specified
         (layer->params.type == LAYER_TYPE_NONE)) {
@@ -22,23 +17,6 @@ Layer *layer_alloc_params(Layer *layer) {
     return layer_init_funcs[layer->params.type](layer);
 }
 
-void layer_free_params(Layer *layer) {
-    if (layer == NULL) {
-        return;
-    }
-
-    FREE_AND_NULL(layer->x);
-    FREE_AND_NULL(layer->y);
-    FREE_AND_NULL(layer->w);
-    FREE_AND_NULL(layer->b);
-    FREE_AND_NULL(layer->gx);
-    FREE_AND_NULL(layer->gw);
-    FREE_AND_NULL(layer->gb);
-
-    layer->forward = NULL;
-    layer->backward = NULL;
-}
-
 bool layer_connect(Layer *prev, Layer *next) {
     LayerParams *n_params = &next->params;
     if ((n_params->batch_size != 0) ||
@@ -67,25 +45,3 @@ float *layer_backward(Layer *layer, const float *dy) {
 
     return layer->backward(layer, dy);
 }
-
-void layer_clear_grad(Layer *layer) {
-    if (layer->gx != NULL) {
-        const int x_size = layer->params.batch_size * layer->params.in;
-        for (int i = 0; i < x_size; i++) {
-            layer->gx[i] = 0;
-        }
-    }
-
-    if (layer->gw != NULL) {
-        const int w_size = layer->params.in * layer->params.out;
-        for (int i = 0; i < w_size; i++) {
-            layer->gw[i] = 0;
-        }
-    }
-
-    if (layer->gb != NULL) {
-        for (int i = 0; i < layer->params.out; i++) {
-            layer->gb[i] = 0;
-        }
-    }
-}
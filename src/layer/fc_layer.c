@@ -4,36 +4,90 @@
  */
 #include "layer/fc_layer.h"
 
-#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gemm.h"
+#include "vmath.h"
 
 /**
- * @brief Forward of the FC layer
+ * @brief Forward of the FC layer with an epilogue
  *
  * @param[in,out] layer Layer
  * @param[in] x An input of the layer
+ * @param[in] epilogue Bias and activation applied to the output
  * @return Pointer to the layer output
  */
-static float *fc_forward(Layer *layer, const float *x) {
+static float *fc_forward_with(Layer *layer, const float *x, const GemmEpilogue *epilogue) {
     LayerParams *params = &layer->params;
 
-    for (int i = 0; i < (params->batch_size * params->in); i++) {
-        layer->x[i] = x[i];
-    }
+    // Borrow the input for backward, which is not copied
+    layer->x = x;
 
-    for (int i = 0; i < params->batch_size; i++) {
-        for (int j = 0; j < params->out; j++) {
-            float mac = 0;
+    // y = act(x * W^T + b)
+    gemm_nt_epilogue(
+        layer->batch, params->out, params->in,
+        x, params->in,
+        layer->w, params->in,
+        layer->y, params->out, epilogue, layer->scratch
+    );
 
-            for (int k = 0; k < params->in; k++) {
-                mac += layer->w[j * params->in + k] * layer->x[i * params->in + k];
-            }
-            mac += layer->b[j];
+    return layer->y;
+}
 
-            layer->y[i * params->out + j] = mac;
-        }
-    }
+/**
+ * @brief Forward of the FC layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] x An input of the layer
+ * @return Pointer to the layer output
+ */
+static float *fc_forward(Layer *layer, const float *x) {
+    const GemmEpilogue epilogue = { .bias = layer->b };
+    return fc_forward_with(layer, x, &epilogue);
+}
 
-    return layer->y;
+/**
+ * @brief Forward of the FC layer fused with the next sigmoid layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] x An input of the layer
+ * @return Pointer to the output of the sigmoid
+ */
+static float *fc_sigmoid_forward(Layer *layer, const float *x) {
+    const GemmEpilogue epilogue = {
+        .bias = layer->b, .activation = vmath_sigmoid, .precision = layer->precision
+    };
+    return fc_forward_with(layer, x, &epilogue);
+}
+
+/**
+ * @brief Multiply gradients of the input and the weight of the FC layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] gy Gradient of the layer output before activation
+ * @return Pointer to gradient of the layer input
+ */
+static float *fc_multiply_grads(Layer *layer, const float *gy) {
+    LayerParams *params = &layer->params;
+
+    // gx = gy * W
+    gemm_nn(
+        layer->batch, params->in, params->out,
+        gy, params->out,
+        layer->w, params->in,
+        0.0f, layer->gx, params->in, layer->scratch
+    );
+
+    // gw = gy^T * x, or gw += gy^T * x, without clearing gw beforehand
+    gemm_tn(
+        params->out, params->in, layer->batch,
+        gy, params->out,
+        layer->x, params->in,
+        (layer->accumulate ? 1.0f : 0.0f), layer->gw, params->in, layer->scratch
+    );
+
+    return layer->gx;
 }
 
 /**
@@ -46,37 +100,95 @@ static float *fc_forward(Layer *layer, const float *x) {
 static float *fc_backward(Layer *layer, const float *gy) {
     LayerParams *params = &layer->params;
 
-    for (int i = 0; i < params->batch_size; i++) {
-        for (int j = 0; j < params->in; j++) {
-            float mac = 0;
-
-            for (int k = 0; k < params->out; k++) {
-                mac += gy[i * params->out + k] * layer->w[k * params->in + j];
-            }
-
-            layer->gx[i * params->in + j] += mac;
+    // The first sample overwrites the bias gradient unless accumulating
+    for (int i = 0; i < layer->batch; i++) {
+        const bool overwrite = !layer->accumulate && (i == 0);
+        for (int j = 0; j < params->out; j++) {
+            const float gb = gy[i * params->out + j];
+            layer->gb[j] = overwrite ? gb : (layer->gb[j] + gb);
         }
     }
 
-    for (int i = 0; i < params->in; i++) {
-        for (int j = 0; j < params->out; j++) {
-            float mac = 0;
+    return fc_multiply_grads(layer, gy);
+}
 
-            for (int k = 0; k < params->batch_size; k++) {
-                mac += layer->x[k * params->in + i] * gy[k * params->out + j];
-            }
+/**
+ * @brief Backward of the FC layer fused with the next sigmoid layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] gy Gradient of the layer next to the sigmoid
+ * @return Pointer to gradient of the layer input
+ */
+static float *fc_sigmoid_backward(Layer *layer, const float *gy) {
+    LayerParams *params = &layer->params;
 
-            layer->gw[j * params->in + i] += mac;
+    // Gradient through the sigmoid, summed into the bias in the same pass
+    for (int i = 0; i < layer->batch; i++) {
+        const bool overwrite = !layer->accumulate && (i == 0);
+        for (int j = 0; j < params->out; j++) {
+            const int idx = i * params->out + j;
+            const float gz = gy[idx] * layer->y[idx] * (1 - layer->y[idx]);
+            layer->gz[idx] = gz;
+            layer->gb[j] = overwrite ? gz : (layer->gb[j] + gz);
         }
     }
 
-    for (int i = 0; i < params->out; i++) {
-        for (int j = 0; j < params->batch_size; j++) {
-            layer->gb[i] += gy[j * params->out + i];
-        }
+    return fc_multiply_grads(layer, layer->gz);
+}
+
+/**
+ * @brief Forward of a layer fused into the previous FC layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] x Output of the FC layer, already activated
+ * @return The input as is, which is also the output of the layer
+ */
+static float *fused_forward(Layer *layer, const float *x) {
+    layer->x = x;
+    layer->y = (float*)x;
+    return layer->y;
+}
+
+/**
+ * @brief Backward of a layer fused into the previous FC layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in] gy Gradient of the next layer
+ * @return The gradient as is, the FC layer goes through the activation
+ */
+static float *fused_backward(Layer *layer, const float *gy) {
+    (void)layer;
+    return (float*)gy;
+}
+
+/**
+ * @brief Fuse the next activation layer into the FC layer
+ *
+ * @param[in,out] layer Layer
+ * @param[in,out] next Next layer
+ * @return true if fused, false if the next layer is not sigmoid
+ */
+static bool fc_fuse(Layer *layer, Layer *next) {
+    // Only an elementwise activation is applied to each tile of the output
+    if (next->params.type != LAYER_TYPE_SIGMOID) {
+        return false;
     }
 
-    return layer->gx;
+    LayerParams *params = &layer->params;
+
+    // Output of the FC layer is activated, the sigmoid layer has no buffers
+    // and its output is the one of the FC layer
+    layer->sizes.gz = (size_t)params->batch_size * params->out;
+    layer->forward = fc_sigmoid_forward;
+    layer->backward = fc_sigmoid_backward;
+    layer->fuse = NULL;
+
+    next->sizes = (LayerSizes){ 0 };
+    next->forward = fused_forward;
+    next->backward = fused_backward;
+    next->fuse = NULL;
+
+    return true;
 }
 
 Layer *fc_layer_init(Layer *layer) {
@@ -88,53 +200,28 @@ Layer *fc_layer_init(Layer *layer) {
         return NULL;
     }
 
-    size_t x_byte_size = sizeof(float) * params->in;
-    layer->x = malloc(params->batch_size * x_byte_size);
-    if (layer->x == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    size_t y_byte_size = sizeof(float) * params->out;
-    layer->y = malloc(params->batch_size * y_byte_size);
-    if (layer->y == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    size_t w_byte_size = sizeof(float) * params->in * params->out;
-    layer->w = malloc(params->batch_size * w_byte_size);
-    if (layer->w == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    const size_t w_size = (size_t)params->in * params->out;
 
-    layer->b = malloc(params->batch_size * y_byte_size);
-    if (layer->b == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    // Multiplications in backward run one by one
+    const size_t gx_scratch = gemm_work_size(params->batch_size, params->in, params->out);
+    const size_t gw_scratch = gemm_work_size(params->out, params->in, params->batch_size);
 
-    layer->gx = malloc(params->batch_size * x_byte_size);
-    if (layer->gx == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    layer->sizes = (LayerSizes){
+        .y = (size_t)params->batch_size * params->out,
+        .w = w_size,
+        .b = params->out,
+        .gx = (size_t)params->batch_size * params->in,
+        .gw = w_size,
+        .gb = params->out,
+        .forward_scratch = gemm_work_size(params->batch_size, params->out, params->in),
+        .backward_scratch = (gx_scratch > gw_scratch) ? gx_scratch : gw_scratch
+    };
 
-    layer->gw = malloc(params->batch_size * w_byte_size);
-    if (layer->gw == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    layer->gb = malloc(params->batch_size * y_byte_size);
-    if (layer->gb == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    layer->batch = params->batch_size;
 
     layer->forward = fc_forward;
     layer->backward = fc_backward;
+    layer->fuse = fc_fuse;
 
     return layer;
 }
@@ -4,9 +4,59 @@
  */
 #include "layer/sigmoid_layer.h"
 
-#include <float.h>
-#include <math.h>
-#include <stdlib.h>
+#include <stddef.h>
+
+#include "thread_pool.h"
+#include "vmath.h"
+
+/**
+ * @brief Min. number of elements given to a thread
+ */
+#define PARALLEL_GRAIN 4096
+
+/**
+ * @brief Elements activated in parallel
+ */
+typedef struct SigmoidRange {
+    float *y; //!< Output
+    const float *x; //!< Input
+    MathPrecision precision; //!< Accuracy
+} SigmoidRange;
+
+/**
+ * @brief Gradients of elements computed in parallel
+ */
+typedef struct SigmoidGradRange {
+    float *gx; //!< Gradient of the input
+    const float *gy; //!< Gradient of the output
+    const float *y; //!< Output
+} SigmoidGradRange;
+
+/**
+ * @brief Activate a range of elements
+ *
+ * @param[in,out] arg Elements
+ * @param[in] begin First element
+ * @param[in] end Element next to the last one
+ */
+static void sigmoid_range(void *arg, const int begin, const int end) {
+    SigmoidRange *range = arg;
+    vmath_sigmoid(&range->y[begin], &range->x[begin], (end - begin), range->precision);
+}
+
+/**
+ * @brief Compute gradients of a range of elements
+ *
+ * @param[in,out] arg Elements
+ * @param[in] begin First element
+ * @param[in] end Element next to the last one
+ */
+static void sigmoid_grad_range(void *arg, const int begin, const int end) {
+    SigmoidGradRange *range = arg;
+    for (int i = begin; i < end; i++) {
+        range->gx[i] = range->gy[i] * range->y[i] * (1 - range->y[i]);
+    }
+}
 
 /**
  * @brief Forward of the sigmoid layer
@@ -18,13 +68,11 @@
 static float *sigmoid_forward(Layer *layer, const float *x) {
     LayerParams *params = &layer->params;
 
-    for (int i = 0; i < (params->batch_size * params->in); i++) {
-        layer->x[i] = x[i];
-    }
-
-    for (int i = 0; i < (params->batch_size * params->in); i++) {
-        layer->y[i] = 1 / (1 + expf(-layer->x[i]));
-    }
+    // Backward uses only the output, the input is not kept
+    SigmoidRange range = { .y = layer->y, .x = x, .precision = layer->precision };
+    thread_pool_parallel_for(
+        (layer->batch * params->in), PARALLEL_GRAIN, sigmoid_range, &range
+    );
 
     return layer->y;
 }
@@ -39,9 +87,10 @@ static float *sigmoid_forward(Layer *layer, const float *x) {
 static float *sigmoid_backward(Layer *layer, const float *gy) {
     LayerParams *params = &layer->params;
 
-    for (int i = 0; i < (params->batch_size * params->in); i++) {
-        layer->gx[i] = gy[i] * layer->y[i] * (1 - layer->y[i]);
-    }
+    SigmoidGradRange range = { .gx = layer->gx, .gy = gy, .y = layer->y };
+    thread_pool_parallel_for(
+        (layer->batch * params->in), PARALLEL_GRAIN, sigmoid_grad_range, &range
+    );
 
     return layer->gx;
 }
@@ -54,33 +103,13 @@ Layer *sigmoid_layer_init(Layer *layer) {
         return NULL;
     }
 
-    size_t x_byte_size = sizeof(float) * params->in;
-    layer->x = malloc(params->batch_size * x_byte_size);
-    if (layer->x == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    layer->y = malloc(params->batch_size * x_byte_size);
-    if (layer->y == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    layer->w = NULL;
-    layer->b = NULL;
+    params->out = params->in;
 
-    layer->gx = malloc(params->batch_size * x_byte_size);
-    if (layer->gx == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    const size_t x_size = (size_t)params->batch_size * params->in;
 
-    // Set in = out if the allocation succeeded
-    params->out = params->in;
+    layer->sizes = (LayerSizes){ .y = x_size, .gx = x_size };
 
-    layer->gw = NULL;
-    layer->gb = NULL;
+    layer->batch = params->batch_size;
 
     layer->forward = sigmoid_forward;
     layer->backward = sigmoid_backward;
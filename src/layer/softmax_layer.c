@@ -4,9 +4,69 @@
  */
 #include "layer/softmax_layer.h"
 
-#include <float.h>
-#include <math.h>
-#include <stdlib.h>
+#include <stddef.h>
+
+#include "kernels.h"
+#include "thread_pool.h"
+#include "vmath.h"
+
+/**
+ * @brief Min. number of elements given to a thread
+ */
+#define PARALLEL_GRAIN 4096
+
+/**
+ * @brief Rows activated in parallel
+ */
+typedef struct SoftmaxRows {
+    float *y; //!< Output
+    const float *x; //!< Input
+    int size; //!< Number of elements of a row
+    MathPrecision precision; //!< Accuracy
+} SoftmaxRows;
+
+/**
+ * @brief Activate a range of rows
+ *
+ * @param[in,out] arg Rows
+ * @param[in] begin First row
+ * @param[in] end Row next to the last one
+ */
+static void softmax_rows(void *arg, const int begin, const int end) {
+    SoftmaxRows *rows = arg;
+
+    for (int i = begin; i < end; i++) {
+        int batch_idx = rows->size * i;
+        vmath_softmax(&rows->y[batch_idx], &rows->x[batch_idx], rows->size, rows->precision);
+    }
+}
+
+/**
+ * @brief Rows of gradients calculated in parallel
+ */
+typedef struct SoftmaxGradRows {
+    float *gx; //!< Gradient of the input
+    const float *y; //!< Output
+    const float *gy; //!< Gradient of the output
+    int size; //!< Number of elements of a row
+} SoftmaxGradRows;
+
+/**
+ * @brief Calculate gradients of a range of rows
+ *
+ * @param[in,out] arg Rows
+ * @param[in] begin First row
+ * @param[in] end Row next to the last one
+ */
+static void softmax_grad_rows(void *arg, const int begin, const int end) {
+    SoftmaxGradRows *rows = arg;
+    const Kernels *ks = kernels();
+
+    for (int i = begin; i < end; i++) {
+        int batch_idx = rows->size * i;
+        ks->softmax_grad(&rows->gx[batch_idx], &rows->y[batch_idx], &rows->gy[batch_idx], rows->size);
+    }
+}
 
 /**
  * @brief Forward of the softmax layer
@@ -18,29 +78,13 @@
 static float *softmax_forward(Layer *layer, const float *x) {
     LayerParams *params = &layer->params;
 
-    for (int i = 0; i < (params->batch_size * params->in); i++) {
-        layer->x[i] = x[i];
-    }
-
-    for (int i = 0; i < params->batch_size; i++) {
-        int batch_idx = params->in * i;
-
-        // Get a max. of the input to avoid overflow of exp(x)
-        float c = -FLT_MAX;
-        for (int j = 0; j < params->in; j++) {
-            float a = layer->x[batch_idx + j];
-            c = (a > c) ? a : c;
-        }
-
-        float sum = 0.0f;
-        for (int j = 0; j < params->in; j++) {
-            sum += expf(layer->x[batch_idx + j] - c);
-        }
-
-        for (int j = 0; j < params->in; j++) {
-            layer->y[batch_idx + j] = expf(layer->x[batch_idx + j] - c) / sum;
-        }
-    }
+    // Backward uses only the output, the input is not kept
+    SoftmaxRows rows = {
+        .y = layer->y, .x = x, .size = params->in, .precision = layer->precision
+    };
+    thread_pool_parallel_for(
+        layer->batch, (PARALLEL_GRAIN / params->in + 1), softmax_rows, &rows
+    );
 
     return layer->y;
 }
@@ -55,35 +99,10 @@ static float *softmax_forward(Layer *layer, const float *x) {
 static float *softmax_backward(Layer *layer, const float *gy) {
     LayerParams *params = &layer->params;
 
-    // Jacobian
-    float *jacobian = malloc(params->in * params->out * sizeof(float));
-
-    for (int i = 0; i < params->batch_size; i++) {
-        int batch_idx = params->in * i;
-
-        // Calculate a Jacobian
-        for (int j = 0; j < params->out; j++) {
-            for (int k = 0; k < params->in; k++) {
-                if (j == k) {
-                    jacobian[j * params->in + k] = layer->y[batch_idx + j] * (1 - layer->y[batch_idx + j]);
-                } else {
-                    jacobian[j * params->in + k] = -layer->y[batch_idx + j] * layer->y[batch_idx + k];
-                }
-            }
-        }
-
-        // Grad is calculated as a matrix multiplication of
-        // the Jacobian and gradient of the next layer
-        for (int j = 0; j < params->out; j++) {
-            float acc = 0;
-            for (int k = 0; k < params->in; k++) {
-                acc += jacobian[j * params->in + k] * gy[batch_idx + k];
-            }
-            layer->gx[batch_idx + j] = acc;
-        }
-    }
-
-    free(jacobian);
+    SoftmaxGradRows rows = { .gx = layer->gx, .y = layer->y, .gy = gy, .size = params->in };
+    thread_pool_parallel_for(
+        layer->batch, (PARALLEL_GRAIN / params->in + 1), softmax_grad_rows, &rows
+    );
 
     return layer->gx;
 }
@@ -96,33 +115,16 @@ Layer *softmax_layer_init(Layer *layer) {
         return NULL;
     }
 
-    size_t x_byte_size = sizeof(float) * params->in;
-    layer->x = malloc(params->batch_size * x_byte_size);
-    if (layer->x == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    layer->y = malloc(params->batch_size * x_byte_size);
-    if (layer->y == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
+    params->out = params->in;
 
-    layer->w = NULL;
-    layer->b = NULL;
+    const size_t x_size = (size_t)params->batch_size * params->in;
 
-    layer->gx = malloc(params->batch_size * x_byte_size);
-    if (layer->gx == NULL) {
-        layer_free_params(layer);
-        return NULL;
-    }
-
-    // Set in = out if the allocation succeeded
-    params->out = params->in;
+    layer->sizes = (LayerSizes){
+        .y = x_size,
+        .gx = x_size
+    };
 
-    layer->gw = NULL;
-    layer->gb = NULL;
+    layer->batch = params->batch_size;
 
     layer->forward = softmax_forward;
     layer->backward = softmax_backward;
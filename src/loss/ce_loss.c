@@ -13,9 +13,16 @@
  * @param[in] t Expected data
  * @param[in] batch_size Batch size of data
  * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
  * @return float Loss
  */
-static float forward(const float *y, const float *t, const size_t batch_size, const size_t size) {
+static float forward(
+    const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    // Logs of single elements by libm, the gradient has no math functions to match
+    (void)precision;
+
     float loss = 0.0f;
 
     for (size_t i = 0; i < batch_size; i++) {
@@ -37,8 +44,14 @@ static float forward(const float *y, const float *t, const size_t batch_size, co
  * @param[in] t Expected data
  * @param[in] batch_size Batch size of data
  * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
  */
-static void backward(float *grad, const float *y, const float *t, const size_t batch_size, const size_t size) {
+static void backward(
+    float *grad, const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    (void)precision;
+
     for (size_t i = 0; i < batch_size; i++) {
         const float *b_y = &y[i * size];
         const float *b_t = &t[i * size];
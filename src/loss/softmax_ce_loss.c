@@ -0,0 +1,76 @@
+/**
+ * @file softmax_ce_loss.c
+ * @brief Softmax cross entropy loss
+ */
+#include "loss/softmax_ce_loss.h"
+
+#include "vmath.h"
+
+/**
+ * @brief Softmax cross entropy loss
+ *
+ * @param[in] y Predicted logits
+ * @param[in] t Expected data
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ * @return float Loss
+ */
+static float forward(
+    const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    float loss = 0.0f;
+
+    for (size_t i = 0; i < batch_size; i++) {
+        const float *b_y = &y[i * size];
+        const float *b_t = &t[i * size];
+
+        // -sum(t * log_softmax(y)) = sum(t) * logsumexp(y) - sum(t * y)
+        float sum_t = 0.0f;
+        float sum_ty = 0.0f;
+        for (size_t j = 0; j < size; j++) {
+            sum_t += b_t[j];
+            sum_ty += b_t[j] * b_y[j];
+        }
+
+        loss += sum_t * vmath_logsumexp(b_y, (int)size, precision) - sum_ty;
+    }
+
+    return loss / (float)batch_size;
+}
+
+/**
+ * @brief Backward of the softmax cross entropy loss
+ *
+ * @param[out] grad Gradient of loss function by the logits
+ * @param[in] y Predicted logits
+ * @param[in] t Expected data
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ */
+static void backward(
+    float *grad, const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    for (size_t i = 0; i < batch_size; i++) {
+        const float *b_t = &t[i * size];
+        float *b_grad = &grad[i * size];
+
+        // (softmax(y) - t) / batch_size, without division by probabilities,
+        // exp of the same precision as forward
+        vmath_softmax(b_grad, &y[i * size], (int)size, precision);
+        for (size_t j = 0; j < size; j++) {
+            b_grad[j] = (b_grad[j] - b_t[j]) / batch_size;
+        }
+    }
+}
+
+LossFunc softmax_ce_loss(void) {
+    LossFunc loss_func = {
+        .forward = forward,
+        .backward = backward
+    };
+    return loss_func;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file sparse_ce_loss.c
+ * @brief Cross entropy loss for class indices
+ */
+#include "loss/sparse_ce_loss.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * @brief Check if a class index is in range
+ *
+ * @param[in] t Class index
+ * @param[in] size Number of classes
+ * @return true if valid, otherwise false
+ */
+static bool is_valid_class(const int t, const size_t size) {
+    return (t >= 0) && ((size_t)t < size);
+}
+
+/**
+ * @brief Cross entropy loss for class indices
+ *
+ * @param[in] y Predicted data
+ * @param[in] t Expected class indices
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ * @return float Loss, NAN if a class index is out of range
+ */
+static float forward(
+    const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    // Logs of single elements by libm, the gradient has no math functions to match
+    (void)precision;
+
+    float loss = 0.0f;
+
+    // Only the expected class has a non-zero term
+    for (size_t i = 0; i < batch_size; i++) {
+        if (!is_valid_class(t[i], size)) {
+            return NAN;
+        }
+        loss += logf(y[i * size + t[i]]);
+    }
+
+    return -loss / (float)batch_size;
+}
+
+/**
+ * @brief Backward of the cross entropy loss for class indices
+ *
+ * @param[out] grad Gradient of loss function by the output, 0 except for expected classes
+ * @param[in] y Predicted data
+ * @param[in] t Expected class indices
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ */
+static void backward(
+    float *grad, const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    (void)precision;
+
+    memset(grad, 0, (sizeof(float) * batch_size * size));
+
+    for (size_t i = 0; i < batch_size; i++) {
+        // A wrong label keeps the gradient of the sample 0, not written out of the row
+        if (!is_valid_class(t[i], size)) {
+            continue;
+        }
+        const size_t idx = i * size + t[i];
+        grad[idx] = -1.0f / y[idx] / batch_size;
+    }
+}
+
+SparseLossFunc sparse_ce_loss(void) {
+    SparseLossFunc loss_func = {
+        .forward = forward,
+        .backward = backward
+    };
+    return loss_func;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file sparse_softmax_ce_loss.c
+ * @brief Softmax cross entropy loss for class indices
+ */
+#include "loss/sparse_softmax_ce_loss.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "vmath.h"
+
+/**
+ * @brief Check if a class index is in range
+ *
+ * @param[in] t Class index
+ * @param[in] size Number of classes
+ * @return true if valid, otherwise false
+ */
+static bool is_valid_class(const int t, const size_t size) {
+    return (t >= 0) && ((size_t)t < size);
+}
+
+/**
+ * @brief Softmax cross entropy loss for class indices
+ *
+ * @param[in] y Predicted logits
+ * @param[in] t Expected class indices
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ * @return float Loss, NAN if a class index is out of range
+ */
+static float forward(
+    const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    float loss = 0.0f;
+
+    for (size_t i = 0; i < batch_size; i++) {
+        const float *b_y = &y[i * size];
+
+        // A wrong label, e.g. from another dataset, is not read out of the logits
+        if (!is_valid_class(t[i], size)) {
+            return NAN;
+        }
+
+        // -log_softmax(y)[t] = logsumexp(y) - y[t]
+        loss += vmath_logsumexp(b_y, (int)size, precision) - b_y[t[i]];
+    }
+
+    return loss / (float)batch_size;
+}
+
+/**
+ * @brief Backward of the softmax cross entropy loss for class indices
+ *
+ * @param[out] grad Gradient of loss function by the logits
+ * @param[in] y Predicted logits
+ * @param[in] t Expected class indices
+ * @param[in] batch_size Batch size of data
+ * @param[in] size Size of data
+ * @param[in] precision Accuracy of math functions
+ */
+static void backward(
+    float *grad, const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    for (size_t i = 0; i < batch_size; i++) {
+        float *b_grad = &grad[i * size];
+
+        // (softmax(y) - onehot(t)) / batch_size, exp of the same precision as forward
+        vmath_softmax(b_grad, &y[i * size], (int)size, precision);
+        if (is_valid_class(t[i], size)) {
+            b_grad[t[i]] -= 1.0f;
+        }
+        for (size_t j = 0; j < size; j++) {
+            b_grad[j] /= batch_size;
+        }
+    }
+}
+
+SparseLossFunc sparse_softmax_ce_loss(void) {
+    SparseLossFunc loss_func = {
+        .forward = forward,
+        .backward = backward
+    };
+    return loss_func;
+}
@@ -2,14 +2,280 @@
  * @file net.c
  * @brief Network structure
  */
+#define _POSIX_C_SOURCE 200112L
+
 #include "net.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <time.h>
+#include <string.h>
 
 #include "random.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Alignment of the arena and each buffer in bytes, a cache line
+ */
+#define ARENA_ALIGNMENT 64
+
+/**
+ * @brief Number of elements of the alignment
+ */
+#define ARENA_ALIGNMENT_SIZE (ARENA_ALIGNMENT / sizeof(float))
+
+/**
+ * @brief Number of weights initialized by a stream of random values
+ */
+#define INIT_CHUNK_SIZE 65536
+
+/**
+ * @brief Round up a buffer size to the alignment
+ *
+ * @param[in] size Number of elements
+ * @return Aligned number of elements
+ */
+static size_t align_size(const size_t size) {
+    return (size + ARENA_ALIGNMENT_SIZE - 1) / ARENA_ALIGNMENT_SIZE * ARENA_ALIGNMENT_SIZE;
+}
+
+/**
+ * @brief Take a buffer from a region of the arena
+ *
+ * @param[in,out] cursor Next free element of the region, advanced by the buffer
+ * @param[in] size Number of elements of the buffer
+ * @return Pointer to the buffer, NULL if the size is 0
+ */
+static float *take_buffer(float **cursor, const size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    float *buffer = *cursor;
+    *cursor += align_size(size);
+
+    return buffer;
+}
+
+/**
+ * @brief Get sizes of buffers of a layer to be allocated
+ *
+ * @param[in] net Network
+ * @param[in] layer Layer of the network
+ * @return Sizes of buffers, ones for backward are 0 in inference
+ */
+static LayerSizes planned_sizes(const Net *net, const Layer *layer) {
+    LayerSizes sizes = layer->sizes;
+
+    if (net->inference) {
+        sizes.gx = 0;
+        sizes.gw = 0;
+        sizes.gb = 0;
+        sizes.gz = 0;
+        sizes.backward_scratch = 0;
+    }
+
+    return sizes;
+}
+
+/**
+ * @brief Get the size of the work memory of a layer
+ *
+ * @param[in] sizes Sizes of buffers of the layer
+ * @return Number of elements used in forward or backward
+ */
+static size_t max_scratch(const LayerSizes *sizes) {
+    return (sizes->forward_scratch > sizes->backward_scratch) ?
+        sizes->forward_scratch : sizes->backward_scratch;
+}
+
+/**
+ * @brief Get the size of the gradient of the network output
+ *
+ * @param[in] net Network, whose layers are initialized
+ * @return Number of elements of the full batch, 0 for inference
+ */
+static size_t output_grad_size(const Net *net) {
+    const LayerParams *params = &net->layers[net->size - 1].params;
+    return net->inference ? 0 : ((size_t)params->batch_size * params->out);
+}
+
+/**
+ * @brief Buffer shared by outputs of layers whose lifetimes do not overlap
+ */
+typedef struct SharedBuffer {
+    size_t size; //!< Number of elements, aligned
+    size_t offset; //!< Offset from the activation region
+    int last_use; //!< Index of the last layer reading the buffer
+} SharedBuffer;
+
+/**
+ * @brief Assign outputs of layers to shared buffers by their lifetimes
+ *
+ * @param[in] net Network
+ * @param[out] offsets Offset of the output of each layer from the activation region
+ * @param[out] size Number of elements of the activation region
+ * @return true if succeeded, otherwise false
+ * @note An output is live from forward of its layer until forward of the next one ends,
+ *       the output of the last layer is kept for the caller.
+ *       Buffers are assigned greedily, 2 ping-pong buffers for a sequential network
+ */
+static bool plan_shared_outputs(const Net *net, size_t *offsets, size_t *size) {
+    SharedBuffer *buffers = malloc(sizeof(SharedBuffer) * net->size);
+    if (buffers == NULL) {
+        return false;
+    }
+
+    int num_buffers = 0;
+    for (int i = 0; i < net->size; i++) {
+        // A layer without an output passes its input through, e.g. a fused one,
+        // which keeps the buffer of the input live until the next layer
+        if ((i > 0) && (net->layers[i].sizes.y == 0)) {
+            buffers[offsets[i - 1]].last_use = i + 1;
+            offsets[i] = offsets[i - 1];
+            continue;
+        }
+
+        // Take the first buffer not read by this layer or later, or add one
+        int j = 0;
+        while ((j < num_buffers) && (buffers[j].last_use >= i)) {
+            j++;
+        }
+        if (j == num_buffers) {
+            buffers[num_buffers++] = (SharedBuffer){ .size = 0 };
+        }
+
+        const size_t y_size = align_size(net->layers[i].sizes.y);
+        if (buffers[j].size < y_size) {
+            buffers[j].size = y_size;
+        }
+        buffers[j].last_use = i + 1;
+
+        // Keep an index of the buffer until offsets are known
+        offsets[i] = j;
+    }
+
+    *size = 0;
+    for (int j = 0; j < num_buffers; j++) {
+        buffers[j].offset = *size;
+        *size += buffers[j].size;
+    }
+
+    for (int i = 0; i < net->size; i++) {
+        offsets[i] = buffers[offsets[i]].offset;
+    }
+
+    free(buffers);
+
+    return true;
+}
+
+/**
+ * @brief Plan sizes of layer buffers and carve them from a single arena
+ *
+ * @param[in,out] net Network, whose layers are initialized
+ * @param[in] shared_params Parameters of another network with the same layers,
+ *            NULL to allocate them in the arena
+ * @return true if succeeded, otherwise false
+ * @note Parameter gradients are laid out in the same way as parameters,
+ *       so that they are seen as 2 flat vectors with the same indices.
+ *       Outputs of layers share buffers in inference, and all layers share a work region
+ */
+static bool alloc_arena(Net *net, float *shared_params) {
+    size_t num_params = 0;
+    size_t num_grads = 0;
+    size_t num_activations = 0;
+    size_t num_scratch = 0;
+    for (int i = 0; i < net->size; i++) {
+        const LayerSizes sizes = planned_sizes(net, &net->layers[i]);
+
+        num_params += align_size(sizes.w) + align_size(sizes.b);
+        num_grads += align_size(sizes.gw) + align_size(sizes.gb);
+        num_grads += align_size(sizes.gx) + align_size(sizes.gz);
+        num_activations += align_size(sizes.y);
+
+        // Layers run one by one, the largest work memory is shared by all
+        const size_t scratch = align_size(max_scratch(&sizes));
+        if (num_scratch < scratch) {
+            num_scratch = scratch;
+        }
+    }
+
+    // A trainer writes the gradient of the output before backward
+    num_grads += align_size(output_grad_size(net));
+
+    size_t *output_offsets = NULL;
+    if (net->inference) {
+        output_offsets = malloc(sizeof(size_t) * net->size);
+        if ((output_offsets == NULL) ||
+            !plan_shared_outputs(net, output_offsets, &num_activations)) {
+            free(output_offsets);
+            return false;
+        }
+    }
+
+    // Parameters of a replica are taken from the shared ones
+    const size_t arena_params = (shared_params != NULL) ? 0 : num_params;
+
+    const size_t arena_size = arena_params + num_grads + num_activations + num_scratch;
+    if (arena_size == 0) {
+        free(output_offsets);
+        return true;
+    }
+
+    void *arena = NULL;
+    if (posix_memalign(&arena, ARENA_ALIGNMENT, (sizeof(float) * arena_size)) != 0) {
+        free(output_offsets);
+        return false;
+    }
+    memset(arena, 0, (sizeof(float) * arena_size));
+
+    net->arena = arena;
+    net->arena_size = arena_size;
+    net->shared_params = (shared_params != NULL);
+    net->params = (shared_params != NULL) ? shared_params : net->arena;
+    net->num_params = num_params;
+    net->grads = (num_grads > 0) ? &net->arena[arena_params] : NULL;
+    net->num_grads = num_grads;
+    net->num_scratch = num_scratch;
+
+    float *param = net->params;
+    float *grad = &net->arena[arena_params];
+    float *activation = &net->arena[arena_params + num_grads];
+    float *scratch = (num_scratch > 0) ? &net->arena[arena_size - num_scratch] : NULL;
+    for (int i = 0; i < net->size; i++) {
+        Layer *layer = &net->layers[i];
+        const LayerSizes sizes = planned_sizes(net, layer);
+
+        layer->w = take_buffer(&param, sizes.w);
+        layer->b = take_buffer(&param, sizes.b);
+        layer->gw = take_buffer(&grad, sizes.gw);
+        layer->gb = take_buffer(&grad, sizes.gb);
+    }
+
+    // Gradients of inputs follow ones of parameters
+    for (int i = 0; i < net->size; i++) {
+        Layer *layer = &net->layers[i];
+        const LayerSizes sizes = planned_sizes(net, layer);
+
+        layer->gx = take_buffer(&grad, sizes.gx);
+        layer->gz = take_buffer(&grad, sizes.gz);
+        if ((i > 0) && (sizes.y == 0)) {
+            // A layer without an output passes its input through, e.g. a fused one
+            layer->y = net->layers[i - 1].y;
+        } else if (output_offsets != NULL) {
+            layer->y = (sizes.y > 0) ? &activation[output_offsets[i]] : NULL;
+        } else {
+            layer->y = take_buffer(&activation, sizes.y);
+        }
+        layer->scratch = scratch;
+    }
+    net->output_grad = take_buffer(&grad, output_grad_size(net));
+
+    free(output_offsets);
+
+    return true;
+}
 
 int net_size(const Net *net) {
     return net->size;
@@ -30,8 +296,29 @@ Layer *net_output(const Net *net) {
     return &net->layers[net->size - 1];
 }
 
-Net *net_alloc_layers(
-    Net *net, LayerParams *param_list
+float *net_params(const Net *net) {
+    return net->params;
+}
+
+float *net_grads(const Net *net) {
+    return net->grads;
+}
+
+size_t net_num_params(const Net *net) {
+    return net->num_params;
+}
+
+/**
+ * @brief Allocate network layers on the heap
+ *
+ * @param[in,out] net Network
+ * @param[in] param_list List of layer parameters
+ * @param[in] inference Allocate only buffers for inference
+ * @param[in] shared_params Parameters shared with another network, NULL to allocate them
+ * @return Pointer to the network, NULL if failed
+ */
+static Net *alloc_layers(
+    Net *net, LayerParams *param_list, const bool inference, float *shared_params
 ) {
     if ((net == NULL) || (param_list == NULL)) {
         return NULL;
@@ -52,36 +339,50 @@ Net *net_alloc_layers(
     }
 
     net->layers = layers;
+    net->inference = inference;
+    net->shared_params = false;
+
+    net->arena = NULL;
+    net->arena_size = 0;
+    net->params = NULL;
+    net->grads = NULL;
+    net->output_grad = NULL;
+    net->num_params = 0;
+    net->num_grads = 0;
+    net->num_scratch = 0;
 
     // Initialize new layers
     net->size = 0;
     for (int i = 0; i < num_layers; i++) {
         Layer *layer = &layers[i];
 
-        layer->params = param_list[i];
+        // Initialize pointers and sizes
+        *layer = (Layer){ .params = param_list[i] };
 
         // Connect layers
         if (i > 0) {
             layer_connect(&layers[i - 1], &layers[i]);
         }
 
-        // Initialize pointers
-        layer->x = NULL;
-        layer->y = NULL;
-        layer->w = NULL;
-        layer->b = NULL;
-
-        layer->gx = NULL;
-        layer->gw = NULL;
-        layer->gb = NULL;
-
-        if (layer_alloc_params(layer) == NULL) {
+        if (layer_init(layer) == NULL) {
             goto FREE_LAYERS;
         }
 
         net->size++;
     }
 
+    // Fuse layers before sizes of buffers are planned,
+    // e.g. an FC layer applies the next activation in its epilogue
+    for (int i = 0; i < (net->size - 1); i++) {
+        if ((layers[i].fuse != NULL) && !layers[i].params.unfused) {
+            layers[i].fuse(&layers[i], &layers[i + 1]);
+        }
+    }
+
+    if (!alloc_arena(net, shared_params)) {
+        goto FREE_LAYERS;
+    }
+
     return net;
 
 FREE_LAYERS:
@@ -90,51 +391,186 @@ FREE_LAYERS:
     return NULL;
 }
 
+Net *net_alloc_layers(Net *net, LayerParams *param_list) {
+    return alloc_layers(net, param_list, false, NULL);
+}
+
+Net *net_alloc_inference(Net *net, LayerParams *param_list) {
+    return alloc_layers(net, param_list, true, NULL);
+}
+
+Net *net_alloc_replica(Net *replica, const Net *net) {
+    if ((replica == NULL) || (net == NULL) || net->inference || (net->params == NULL)) {
+        return NULL;
+    }
+
+    // Layers are connected already, their sizes are the same as the network
+    LayerParams *param_list = malloc(sizeof(LayerParams) * (net->size + 1));
+    if (param_list == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < net->size; i++) {
+        param_list[i] = net->layers[i].params;
+    }
+    param_list[net->size] = (LayerParams){ .type = LAYER_TYPE_NONE };
+
+    Net *allocated = alloc_layers(replica, param_list, false, net->params);
+    free(param_list);
+    if (allocated == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < net->size; i++) {
+        replica->layers[i].precision = net->layers[i].precision;
+    }
+
+    return replica;
+}
+
 void net_free_layers(Net *net) {
     if ((net == NULL) || (net->layers == NULL)) {
         return;
     }
 
-    for (int i = 0; i < net->size; i++) {
-        layer_free_params(&net->layers[i]);
-    }
+    free(net->arena);
+    net->arena = NULL;
+    net->params = NULL;
+    net->grads = NULL;
+    net->output_grad = NULL;
 
     free(net->layers);
     net->layers = NULL;
 }
 
-void net_init_params(Net *net) {
-    srand(time(NULL));
+MemoryStats net_memory_stats(const Net *net, MemoryStats *layer_stats) {
+    // Parameters of a replica are not in its arena
+    const size_t num_params = net->shared_params ? 0 : net->num_params;
+
+    MemoryStats total = {
+        .params = sizeof(float) * num_params,
+        .grads = sizeof(float) * net->num_grads,
+        .activations = sizeof(float) * (
+            net->arena_size - num_params - net->num_grads - net->num_scratch
+        ),
+        .scratch = sizeof(float) * net->num_scratch
+    };
+
+    for (int i = 0; i < net->size; i++) {
+        const LayerSizes sizes = planned_sizes(net, &net->layers[i]);
+
+        MemoryStats stats = {
+            .params = net->shared_params ?
+                0 : sizeof(float) * (align_size(sizes.w) + align_size(sizes.b)),
+            .grads = sizeof(float) * (
+                align_size(sizes.gw) + align_size(sizes.gb) +
+                align_size(sizes.gx) + align_size(sizes.gz)
+            ),
+            .activations = sizeof(float) * align_size(sizes.y),
+            .scratch = sizeof(float) * align_size(max_scratch(&sizes))
+        };
+
+        // The gradient of the network output belongs to the output layer
+        if (i == (net->size - 1)) {
+            stats.grads += sizeof(float) * align_size(output_grad_size(net));
+        }
+
+        if (layer_stats != NULL) {
+            layer_stats[i] = stats;
+        }
+    }
+
+    return total;
+}
+
+bool net_set_num_threads(const int num_threads) {
+    return thread_pool_set_num_threads(num_threads);
+}
+
+void net_set_precision(Net *net, const MathPrecision precision) {
+    for (int i = 0; i < net->size; i++) {
+        net_layers(net)[i].precision = precision;
+    }
+}
+
+/**
+ * @brief Initialization of weights of a layer
+ */
+typedef struct InitWeights {
+    float *w; //!< Weights
+    size_t size; //!< Number of weights
+    float stddev; //!< Std. dev. of weights
+    uint64_t seed; //!< Seed of the network
+    uint64_t stream; //!< Stream of the first chunk
+} InitWeights;
+
+/**
+ * @brief Task initializing chunks of weights, each chunk by its own stream
+ *
+ * @param[in,out] arg Initialization of weights
+ * @param[in] begin First chunk
+ * @param[in] end Chunk next to the last one
+ */
+static void init_weights(void *arg, const int begin, const int end) {
+    const InitWeights *init = arg;
+
+    for (int i = begin; i < end; i++) {
+        const size_t offset = (size_t)i * INIT_CHUNK_SIZE;
+        const size_t size = ((init->size - offset) < INIT_CHUNK_SIZE) ?
+            (init->size - offset) : INIT_CHUNK_SIZE;
+
+        RandomState state;
+        rand_seed(&state, init->seed, (init->stream + i));
+        rand_fill_norm(&state, &init->w[offset], size, 0, init->stddev);
+    }
+}
+
+void net_init_params(Net *net, const uint64_t seed) {
+    // Streams are numbered through layers, values do not depend on the number of threads
+    uint64_t stream = 0;
 
     for (int i = 0; i < net->size; i++) {
         Layer *layer = &net_layers(net)[i];
         LayerParams *params = &layer->params;
 
         // Initialize weights by Xavier initialization
-        const float n = (float)params->in;
         if (layer->w != NULL) {
-            for (int j = 0; j < (params->in * params->out); j++) {
-                layer->w[j] = rand_norm(0, (1 / sqrtf(n)));
-            }
+            InitWeights init = {
+                .w = layer->w,
+                .size = (size_t)params->in * params->out,
+                .stddev = 1 / sqrtf((float)params->in),
+                .seed = seed,
+                .stream = stream
+            };
+            const int num_chunks = (int)((init.size + INIT_CHUNK_SIZE - 1) / INIT_CHUNK_SIZE);
+            thread_pool_parallel_for(num_chunks, 1, init_weights, &init);
+            stream += num_chunks;
         }
 
         // Initialize biases by 0
         if (layer->b != NULL) {
-            for (int j = 0; j < params->out; j++) {
-                layer->b[j] = 0;
-            }
+            memset(layer->b, 0, (sizeof(float) * params->out));
         }
     }
 }
 
 float *net_forward(Net *net, const float *x) {
-    if ((net == NULL) || (x == NULL)) {
+    if (net == NULL) {
+        return NULL;
+    }
+
+    return net_forward_batch(net, x, net_input(net)->params.batch_size);
+}
+
+float *net_forward_batch(Net *net, const float *x, const int n) {
+    if ((net == NULL) || (x == NULL) ||
+        (n < 1) || (n > net_input(net)->params.batch_size)) {
         return NULL;
     }
 
     float *in = (float*)x;
     float *out = NULL;
     for (int i = 0; i < net->size; i++) {
+        net->layers[i].batch = n;
         out = layer_forward(&net->layers[i], in);
         in = out;
     }
@@ -142,14 +578,23 @@ float *net_forward(Net *net, const float *x) {
     return out;
 }
 
-float *net_backward(Net *net, const float *dy) {
-    if ((net == NULL) || (dy == NULL)) {
+/**
+ * @brief Backward propagation of network
+ *
+ * @param[in,out] net Network
+ * @param[in] dy Gradient of network output
+ * @param[in] accumulate Add gradients of parameters if true, otherwise overwrite them
+ * @return Pointer to gradient of an input of the network, NULL if failed
+ */
+static float *backward(Net *net, const float *dy, const bool accumulate) {
+    if ((net == NULL) || (dy == NULL) || net->inference) {
         return NULL;
     }
 
     float *din = (float*)dy;
     float *dout = NULL;
     for (int i = (net->size - 1); i >= 0; i--) {
+        net->layers[i].accumulate = accumulate;
         dout = layer_backward(&net->layers[i], din);
         din = dout;
     }
@@ -157,8 +602,17 @@ float *net_backward(Net *net, const float *dy) {
     return dout;
 }
 
+float *net_backward(Net *net, const float *dy) {
+    return backward(net, dy, false);
+}
+
+float *net_backward_accumulate(Net *net, const float *dy) {
+    return backward(net, dy, true);
+}
+
 void net_clear_grad(Net *net) {
-    for (int i = 0; i < net->size; i++) {
-        layer_clear_grad(&net->layers[i]);
+    // All gradients are in a region of the arena
+    if (net->grads != NULL) {
+        memset(net->grads, 0, (sizeof(float) * net->num_grads));
     }
 }
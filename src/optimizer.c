@@ -0,0 +1,199 @@
+/**
+ * @file optimizer.c
+ * @brief Optimizers updating all parameters of a network
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "optimizer.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Alignment of state buffers in bytes, a cache line
+ */
+#define STATE_ALIGNMENT 64
+
+/**
+ * @brief Number of elements updated as a unit of parallel work
+ */
+#define UPDATE_CHUNK_SIZE 16384
+
+/**
+ * @brief Elements of parameters updated in parallel
+ */
+typedef struct UpdateRange {
+    const Optimizer *optimizer; //!< Optimizer
+    float *w; //!< Parameters
+    const float *g; //!< Gradients
+    AdamCoeffs coeffs; //!< Coefficients of RMSProp and Adam(W)
+} UpdateRange;
+
+/**
+ * @brief Update a chunk of elements
+ *
+ * @param[in,out] range Elements
+ * @param[in] offset First element of the chunk
+ * @param[in] size Number of elements of the chunk
+ */
+static void update_chunk(const UpdateRange *range, const size_t offset, const int size) {
+    const Optimizer *optimizer = range->optimizer;
+    const OptimizerParams *params = &optimizer->params;
+    const Kernels *ks = kernels();
+
+    float *w = &range->w[offset];
+    const float *g = &range->g[offset];
+    float *m = (optimizer->m != NULL) ? &optimizer->m[offset] : NULL;
+    float *v = (optimizer->v != NULL) ? &optimizer->v[offset] : NULL;
+
+    switch (params->type) {
+    case OPTIMIZER_TYPE_SGD:
+        ks->sgd(w, g, size, params->learning_rate);
+        break;
+    case OPTIMIZER_TYPE_MOMENTUM:
+    case OPTIMIZER_TYPE_NESTEROV:
+        ks->momentum(
+            w, m, g, size, params->learning_rate, params->momentum,
+            (params->type == OPTIMIZER_TYPE_NESTEROV)
+        );
+        break;
+    case OPTIMIZER_TYPE_RMSPROP:
+    case OPTIMIZER_TYPE_ADAM:
+    case OPTIMIZER_TYPE_ADAMW:
+        ks->adam(w, m, v, g, size, &range->coeffs);
+        break;
+    }
+}
+
+/**
+ * @brief Update a range of chunks
+ *
+ * @param[in,out] arg Elements
+ * @param[in] begin First chunk
+ * @param[in] end Chunk next to the last one
+ * @note The number of elements may exceed INT_MAX, so threads are given chunks of them
+ */
+static void update_range(void *arg, const int begin, const int end) {
+    const UpdateRange *range = arg;
+    const size_t num_elements = range->optimizer->size;
+
+    for (int i = begin; i < end; i++) {
+        const size_t offset = (size_t)i * UPDATE_CHUNK_SIZE;
+        const size_t size = ((num_elements - offset) < UPDATE_CHUNK_SIZE) ?
+            (num_elements - offset) : UPDATE_CHUNK_SIZE;
+
+        update_chunk(range, offset, (int)size);
+    }
+}
+
+OptimizerParams optimizer_params_default(const OptimizerType type, const float learning_rate) {
+    return (OptimizerParams){
+        .type = type,
+        .learning_rate = learning_rate,
+        .momentum = 0.9f,
+        .beta1 = 0.9f,
+        .beta2 = (type == OPTIMIZER_TYPE_RMSPROP) ? 0.99f : 0.999f,
+        .eps = 1e-8f,
+        .weight_decay = (type == OPTIMIZER_TYPE_ADAMW) ? 0.01f : 0
+    };
+}
+
+Optimizer *optimizer_alloc(Optimizer *optimizer, const Net *net, const OptimizerParams params) {
+    if ((optimizer == NULL) || (net == NULL) || (net->grads == NULL)) {
+        return NULL;
+    }
+
+    *optimizer = (Optimizer){ .params = params, .size = net->num_params };
+
+    // Number of state buffers, each of the size of the parameters
+    int num_states = 0;
+    switch (params.type) {
+    case OPTIMIZER_TYPE_SGD:
+        break;
+    case OPTIMIZER_TYPE_MOMENTUM:
+    case OPTIMIZER_TYPE_NESTEROV:
+    case OPTIMIZER_TYPE_RMSPROP:
+        num_states = 1;
+        break;
+    case OPTIMIZER_TYPE_ADAM:
+    case OPTIMIZER_TYPE_ADAMW:
+        num_states = 2;
+        break;
+    default:
+        return NULL;
+    }
+
+    if ((num_states == 0) || (optimizer->size == 0)) {
+        return optimizer;
+    }
+
+    // The size of parameters is a multiple of the alignment of the arena
+    const size_t state_size = sizeof(float) * optimizer->size * num_states;
+    void *state = NULL;
+    if (posix_memalign(&state, STATE_ALIGNMENT, state_size) != 0) {
+        return NULL;
+    }
+    memset(state, 0, state_size);
+
+    optimizer->state = state;
+    if (params.type == OPTIMIZER_TYPE_RMSPROP) {
+        // Gradients are used as is, without the 1st moment
+        optimizer->v = optimizer->state;
+    } else {
+        optimizer->m = optimizer->state;
+        optimizer->v = (num_states > 1) ? &optimizer->state[optimizer->size] : NULL;
+    }
+
+    return optimizer;
+}
+
+void optimizer_free(Optimizer *optimizer) {
+    if (optimizer == NULL) {
+        return;
+    }
+
+    free(optimizer->state);
+    optimizer->state = NULL;
+    optimizer->m = NULL;
+    optimizer->v = NULL;
+}
+
+void optimizer_step(Optimizer *optimizer, Net *net) {
+    const OptimizerParams *params = &optimizer->params;
+
+    optimizer->steps++;
+
+    UpdateRange range = {
+        .optimizer = optimizer, .w = net->params, .g = net->grads
+    };
+
+    if (params->type == OPTIMIZER_TYPE_RMSPROP) {
+        range.coeffs = (AdamCoeffs){
+            .learning_rate = params->learning_rate,
+            .beta1 = 0,
+            .beta2 = params->beta2,
+            .eps = params->eps,
+            .weight_decay = 0,
+            .bias1 = 1,
+            .bias2 = 1
+        };
+    } else if ((params->type == OPTIMIZER_TYPE_ADAM) || (params->type == OPTIMIZER_TYPE_ADAMW)) {
+        range.coeffs = (AdamCoeffs){
+            .learning_rate = params->learning_rate,
+            .beta1 = params->beta1,
+            .beta2 = params->beta2,
+            .eps = params->eps,
+            .weight_decay = (params->type == OPTIMIZER_TYPE_ADAMW) ? params->weight_decay : 0,
+            .bias1 = 1 / (1 - powf(params->beta1, (float)optimizer->steps)),
+            .bias2 = 1 / sqrtf(1 - powf(params->beta2, (float)optimizer->steps))
+        };
+    }
+
+    const size_t num_chunks = (optimizer->size + UPDATE_CHUNK_SIZE - 1) / UPDATE_CHUNK_SIZE;
+    thread_pool_parallel_for((int)num_chunks, 1, update_range, &range);
+}
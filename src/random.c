@@ -1,29 +1,187 @@
 /**
  * @file random.c
- * @brief Simple PRNG
+ * @brief Seedable PRNG with explicit states
  */
 #include "random.h"
 
 #include <math.h>
 #include <stdint.h>
-#include <stdlib.h>
+
+#include "vmath.h"
 
 /**
  * @brief Pi value
  */
-#define PI 3.14159265
+#define PI 3.14159265f
+
+/**
+ * @brief Number of Box-Muller transforms of a block, 2 outputs for each
+ */
+#define NORM_BLOCK_SIZE 128
+
+/**
+ * @brief Scale of 24 random bits to [0, 1)
+ */
+#define BITS_24_SCALE (1.0f / 16777216)
+
+/**
+ * @brief Mix bits of a value by the finalizer of SplitMix64, a bijection
+ *
+ * @param[in] x Value
+ * @return Mixed value
+ */
+static inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Rotate bits to the left
+ *
+ * @param[in] x Value
+ * @param[in] k Number of bits, from 1 to 63
+ * @return Rotated value
+ */
+static inline uint64_t rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void rand_seed(RandomState *state, const uint64_t seed, const uint64_t stream) {
+    // Words are a SplitMix64 sequence from a point given by both the seed and the stream
+    uint64_t x = mix64(seed ^ mix64(stream ^ 0x6A09E667F3BCC909ull));
+    for (int i = 0; i < 4; i++) {
+        x += 0x9E3779B97F4A7C15ull;
+        state->s[i] = mix64(x);
+    }
+
+    state->spare = 0;
+    state->has_spare = false;
+}
+
+uint64_t rand_next(RandomState *state) {
+    uint64_t *s = state->s;
+    const uint64_t result = s[0] + s[3];
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+float rand_uniform(RandomState *state) {
+    return (float)(rand_next(state) >> 40) * BITS_24_SCALE;
+}
+
+float rand_norm(RandomState *state, const float mean, const float stddev) {
+    if (state->has_spare) {
+        state->has_spare = false;
+        return mean + state->spare * stddev;
+    }
+
+    // Generate random values by the Box-Muller method, in (0, 1] for the log
+    const uint64_t bits = rand_next(state);
+    const float u1 = (float)((bits >> 40) + 1) * BITS_24_SCALE;
+    const float u2 = (float)((bits >> 16) & 0xFFFFFF) * BITS_24_SCALE;
+
+    const float r = sqrtf(-2 * logf(u1));
+    state->spare = r * sinf(2 * PI * u2);
+    state->has_spare = true;
+
+    return mean + r * cosf(2 * PI * u2) * stddev;
+}
+
+void rand_fill_uniform(
+    RandomState *state, float *y, const size_t size, const float low, const float high
+) {
+    const float scale = (high - low) * BITS_24_SCALE;
+
+    // 2 values from each 64 bits
+    size_t i = 0;
+    for (; (i + 1) < size; i += 2) {
+        const uint64_t bits = rand_next(state);
+        y[i] = low + (float)(bits >> 40) * scale;
+        y[i + 1] = low + (float)((bits >> 16) & 0xFFFFFF) * scale;
+    }
+    if (i < size) {
+        y[i] = low + (float)(rand_next(state) >> 40) * scale;
+    }
+}
+
+/**
+ * @brief Box-Muller transforms of a block
+ *
+ * @param[in,out] state State
+ * @param[out] y Vector of 2 * n elements, cosine outputs then sine outputs
+ * @param[in] n Number of transforms, up to NORM_BLOCK_SIZE
+ * @param[in] mean Mean of the distribution
+ * @param[in] stddev Std. dev. for the distribution
+ */
+static void norm_block(
+    RandomState *state, float *y, const int n, const float mean, const float stddev
+) {
+    float u[NORM_BLOCK_SIZE];
+    float c[NORM_BLOCK_SIZE];
+    float s[NORM_BLOCK_SIZE];
 
-float rand_uniform(void) {
-    return (float)rand() / ((uint32_t)RAND_MAX + 1);
+    for (int i = 0; i < n; i++) {
+        const uint64_t bits = rand_next(state);
+
+        // Radius from (0, 1], not 0 for the log
+        u[i] = (float)((bits >> 40) + 1) * BITS_24_SCALE;
+
+        // Angle in [-pi/2, pi/2) and a random sign of the cosine cover the whole circle.
+        // Polynomials in the half circle are accurate to 1e-7 without a range reduction
+        const float x = ((float)((bits >> 16) & 0xFFFFFF) * BITS_24_SCALE - 0.5f) * PI;
+        const float x2 = x * x;
+        const float sign = ((bits >> 15) & 1) ? -1.0f : 1.0f;
+        s[i] = x * (1 + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 +
+            x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+        c[i] = sign * (1 + x2 * (-1.0f / 2 + x2 * (1.0f / 24 + x2 * (-1.0f / 720 +
+            x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600)))))));
+    }
+
+    // Polynomial log of the kernels for the whole block
+    vmath_log(u, u, n, MATH_PRECISION_FAST);
+
+    for (int i = 0; i < n; i++) {
+        const float r = sqrtf(-2 * u[i]) * stddev;
+        y[i] = mean + r * c[i];
+        y[n + i] = mean + r * s[i];
+    }
 }
 
-float rand_norm(const float mean, const float stddev) {
-    // Generate a random value by the Box-Muller method
-    float u1 = rand_uniform();
-    float u2 = rand_uniform();
+void rand_fill_norm(
+    RandomState *state, float *y, const size_t size, const float mean, const float stddev
+) {
+    size_t i = 0;
+    if ((size > 0) && state->has_spare) {
+        y[i++] = mean + state->spare * stddev;
+        state->has_spare = false;
+    }
+
+    for (; (i + 2 * NORM_BLOCK_SIZE) <= size; i += 2 * NORM_BLOCK_SIZE) {
+        norm_block(state, &y[i], NORM_BLOCK_SIZE, mean, stddev);
+    }
 
-    // OR: sqrtf(-2 * logf(u1)) * sinf(2 * PI * u2);
-    float x = sqrtf(-2 * logf(u1)) * cosf(2 * PI * u2);
+    // The rest by a smaller block, an odd output is kept for the next call
+    if (i < size) {
+        const int rest = (int)(size - i);
+        const int n = (rest + 1) / 2;
+        float block[2 * NORM_BLOCK_SIZE];
+        norm_block(state, block, n, 0, 1);
 
-    return mean + x * stddev;
+        for (int j = 0; j < rest; j++) {
+            y[i + j] = mean + block[j] * stddev;
+        }
+        if (rest < (2 * n)) {
+            state->spare = block[rest];
+            state->has_spare = true;
+        }
+    }
 }
@@ -0,0 +1,65 @@
+/**
+ * @file sampler.c
+ * @brief Sampler of shuffled indices of epochs
+ */
+#include "sampler.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief Get a random index in [0, bound)
+ *
+ * @param[in,out] state State of the PRNG
+ * @param[in] bound Upper bound, greater than 0
+ * @return Random index
+ */
+static inline size_t random_index(RandomState *state, const size_t bound) {
+    const uint64_t r = rand_next(state);
+
+    // Multiply-shift of the upper 32 bits, no division for usual sizes
+    if (bound <= UINT32_MAX) {
+        return (size_t)(((r >> 32) * (uint64_t)bound) >> 32);
+    }
+    return (size_t)(r % bound);
+}
+
+Sampler *sampler_alloc(Sampler *sampler, const size_t num_samples, const uint64_t seed) {
+    if ((sampler == NULL) || (num_samples == 0)) {
+        return NULL;
+    }
+
+    sampler->indices = malloc(sizeof(size_t) * num_samples);
+    if (sampler->indices == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < num_samples; i++) {
+        sampler->indices[i] = i;
+    }
+    sampler->num_samples = num_samples;
+    rand_seed(&sampler->random, seed, 0);
+
+    return sampler;
+}
+
+void sampler_free(Sampler *sampler) {
+    if (sampler == NULL) {
+        return;
+    }
+
+    free(sampler->indices);
+    sampler->indices = NULL;
+}
+
+const size_t *sampler_shuffle(Sampler *sampler) {
+    size_t *indices = sampler->indices;
+
+    for (size_t i = sampler->num_samples - 1; i > 0; i--) {
+        const size_t j = random_index(&sampler->random, (i + 1));
+        const size_t index = indices[i];
+        indices[i] = indices[j];
+        indices[j] = index;
+    }
+
+    return indices;
+}
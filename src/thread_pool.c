@@ -0,0 +1,236 @@
+/**
+ * @file thread_pool.c
+ * @brief Persistent thread pool for parallel loops
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * @brief Number of polls of a parked worker before sleeping on a condition
+ */
+#define SPIN_COUNT 20000
+
+/**
+ * @brief Number of ranges given to each thread, to balance the load
+ */
+#define RANGES_PER_THREAD 4
+
+/**
+ * @brief Parallel loop being run
+ */
+typedef struct Job {
+    ThreadPoolTask task; //!< Task
+    void *arg; //!< Argument of the task
+    int size; //!< Number of indices
+    int range; //!< Number of indices of a range
+    int next; //!< Next index to be taken
+} Job;
+
+/**
+ * @brief Thread pool
+ */
+typedef struct ThreadPool {
+    int num_workers; //!< Number of workers, except the calling thread
+    pthread_t *workers; //!< Worker threads
+
+    pthread_mutex_t mutex; //!< Mutex for the wake condition
+    pthread_cond_t wake; //!< Condition to wake parked workers
+
+    unsigned int generation; //!< Incremented for each job
+    unsigned int spawn_generation; //!< Generation when workers are created
+    bool stop; //!< Stop workers
+    bool running; //!< A job is being run
+    int busy; //!< Number of workers still running the job
+
+    Job job; //!< Current job
+} ThreadPool;
+
+/**
+ * @brief Library-owned pool
+ */
+static ThreadPool pool = {
+    .num_workers = 0,
+    .workers = NULL,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief Hint to the CPU in a polling loop
+ */
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * @brief Run ranges of a job until all of them are taken
+ *
+ * @param[in,out] job Job
+ */
+static void run_ranges(Job *job) {
+    for (;;) {
+        const int begin = __atomic_fetch_add(&job->next, job->range, __ATOMIC_RELAXED);
+        if (begin >= job->size) {
+            return;
+        }
+
+        const int end = ((job->size - begin) < job->range) ? job->size : (begin + job->range);
+        job->task(job->arg, begin, end);
+    }
+}
+
+/**
+ * @brief Main loop of a worker
+ *
+ * @param[in] arg Unused
+ * @return NULL
+ */
+static void *worker_main(void *arg) {
+    (void)arg;
+
+    // Not the current generation, a job may be started before this thread
+    unsigned int seen = pool.spawn_generation;
+
+    for (;;) {
+        // Poll for a while to start small jobs without a wake-up latency
+        unsigned int generation = seen;
+        for (int i = 0; (i < SPIN_COUNT) && (generation == seen); i++) {
+            cpu_relax();
+            generation = __atomic_load_n(&pool.generation, __ATOMIC_ACQUIRE);
+        }
+
+        // Then park until the next job
+        if (generation == seen) {
+            pthread_mutex_lock(&pool.mutex);
+            while ((pool.generation == seen) && !pool.stop) {
+                pthread_cond_wait(&pool.wake, &pool.mutex);
+            }
+            generation = pool.generation;
+            pthread_mutex_unlock(&pool.mutex);
+        }
+
+        if (__atomic_load_n(&pool.stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        seen = generation;
+
+        run_ranges(&pool.job);
+
+        __atomic_fetch_sub(&pool.busy, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Stop and join all workers
+ */
+static void stop_workers(void) {
+    if (pool.num_workers == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool.mutex);
+    __atomic_store_n(&pool.stop, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.mutex);
+
+    for (int i = 0; i < pool.num_workers; i++) {
+        pthread_join(pool.workers[i], NULL);
+    }
+
+    free(pool.workers);
+    pool.workers = NULL;
+    pool.num_workers = 0;
+    pool.stop = false;
+}
+
+bool thread_pool_set_num_threads(const int num_threads) {
+    if (num_threads < 1) {
+        return false;
+    }
+
+    stop_workers();
+
+    if (num_threads == 1) {
+        return true;
+    }
+
+    pool.workers = malloc(sizeof(pthread_t) * (num_threads - 1));
+    if (pool.workers == NULL) {
+        return false;
+    }
+
+    pool.spawn_generation = pool.generation;
+
+    for (int i = 0; i < (num_threads - 1); i++) {
+        if (pthread_create(&pool.workers[i], NULL, worker_main, NULL) != 0) {
+            // Join workers already created, the pool runs serially
+            stop_workers();
+            free(pool.workers);
+            pool.workers = NULL;
+            return false;
+        }
+        pool.num_workers++;
+    }
+
+    return true;
+}
+
+int thread_pool_num_threads(void) {
+    return pool.num_workers + 1;
+}
+
+void thread_pool_parallel_for(
+    const int size, const int grain, ThreadPoolTask task, void *arg
+) {
+    if (size <= 0) {
+        return;
+    }
+
+    const int min_range = (grain < 1) ? 1 : grain;
+
+    // Run serially if a range covers all, or the pool is used by another loop
+    bool expected = false;
+    if ((pool.num_workers == 0) ||
+        (size <= min_range) ||
+        !__atomic_compare_exchange_n(
+            &pool.running, &expected, true,
+            false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+        )) {
+        task(arg, 0, size);
+        return;
+    }
+
+    const int num_ranges = (pool.num_workers + 1) * RANGES_PER_THREAD;
+    int range = (size + num_ranges - 1) / num_ranges;
+    range = (range < min_range) ? min_range : range;
+
+    pool.job = (Job){
+        .task = task, .arg = arg, .size = size, .range = range, .next = 0
+    };
+    pool.busy = pool.num_workers;
+
+    pthread_mutex_lock(&pool.mutex);
+    __atomic_fetch_add(&pool.generation, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.mutex);
+
+    // The calling thread also takes ranges
+    run_ranges(&pool.job);
+
+    while (__atomic_load_n(&pool.busy, __ATOMIC_ACQUIRE) > 0) {
+        sched_yield();
+    }
+
+    __atomic_store_n(&pool.running, false, __ATOMIC_RELEASE);
+}
@@ -4,7 +4,26 @@
  */
 #include "trainer.h"
 
+#include <math.h>
+#include <stdlib.h>
+
 #include "layer.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Number of elements of gradients added by a task of the reduction
+ */
+#define REDUCE_CHUNK_SIZE 16384
+
+/**
+ * @brief Loss function and expected outputs of a batch, either dense or sparse
+ */
+typedef struct BatchLoss {
+    const LossFunc *dense; //!< Loss function, NULL if sparse
+    const float *t; //!< Expected outputs
+    const SparseLossFunc *sparse; //!< Loss function for class indices, NULL if dense
+    const int *t_sparse; //!< Expected class indices
+} BatchLoss;
 
 void train_step(Net *net, const float learning_rate) {
     for (int i = 0; i < net->size; i++) {
@@ -23,3 +42,454 @@ void train_step(Net *net, const float learning_rate) {
         }
     }
 }
+
+/**
+ * @brief Loss and its gradient of a micro-batch
+ *
+ * @param[in] loss Loss function and expected outputs of the batch
+ * @param[out] grad Gradient of the loss by the output of the micro-batch
+ * @param[in] y Output of the micro-batch
+ * @param[in] begin Index of the first sample of the micro-batch
+ * @param[in] n Number of samples of the micro-batch
+ * @param[in] output Output layer of the network, giving the size and the precision
+ * @return Mean loss of the micro-batch
+ */
+static float micro_batch_loss(
+    const BatchLoss *loss, float *grad, const float *y, const int begin, const int n,
+    const Layer *output
+) {
+    const int size = output->params.out;
+    const MathPrecision precision = output->precision;
+
+    if (loss->dense != NULL) {
+        const float *t = &loss->t[(size_t)begin * size];
+        loss->dense->backward(grad, y, t, n, size, precision);
+        return loss->dense->forward(y, t, n, size, precision);
+    }
+
+    const int *t = &loss->t_sparse[begin];
+    loss->sparse->backward(grad, y, t, n, size, precision);
+    return loss->sparse->forward(y, t, n, size, precision);
+}
+
+/**
+ * @brief Compute gradients of samples of a batch by micro-batches
+ *
+ * @param[in,out] net Target network
+ * @param[in] x Inputs of the batch
+ * @param[in] begin Index of the first sample
+ * @param[in] size Number of samples from the first one
+ * @param[in] batch_size Number of samples of the batch, gradients are the mean over it
+ * @param[in] loss Loss function and expected outputs of the batch
+ * @return Sum of losses of the samples divided by the batch size, NAN if failed
+ * @note The first micro-batch overwrites gradients, the rest are added
+ */
+static float accumulate(
+    Net *net, const float *x, const int begin, const int size, const int batch_size,
+    const BatchLoss *loss
+) {
+    const int micro_batch_size = net->layers[0].params.batch_size;
+    const int in = net->layers[0].params.in;
+    const Layer *output = &net->layers[net->size - 1];
+    const int out = output->params.out;
+
+    // Taken from the arena, NULL for inference
+    float *grad = net->output_grad;
+    if (grad == NULL) {
+        return NAN;
+    }
+
+    float total_loss = 0;
+    for (int i = begin; i < (begin + size); i += micro_batch_size) {
+        const int remaining = begin + size - i;
+        const int n = (remaining < micro_batch_size) ? remaining : micro_batch_size;
+
+        const float *y = net_forward_batch(net, &x[(size_t)i * in], n);
+        if (y == NULL) {
+            return NAN;
+        }
+
+        const float loss_mean = micro_batch_loss(loss, grad, y, i, n, output);
+        total_loss += loss_mean * n;
+
+        // The loss is the mean over the micro-batch, weight it to the mean over the batch
+        const float scale = (float)n / (float)batch_size;
+        for (int j = 0; j < (n * out); j++) {
+            grad[j] *= scale;
+        }
+
+        const float *gx = (i == begin) ?
+            net_backward(net, grad) :
+            net_backward_accumulate(net, grad);
+        if (gx == NULL) {
+            return NAN;
+        }
+    }
+
+    return total_loss / (float)batch_size;
+}
+
+float train_accumulate(
+    Net *net, const float *x, const float *t, const int batch_size, const LossFunc loss_func
+) {
+    if ((net == NULL) || (x == NULL) || (t == NULL) || (batch_size < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .dense = &loss_func, .t = t };
+    return accumulate(net, x, 0, batch_size, batch_size, &loss);
+}
+
+float train_accumulate_sparse(
+    Net *net, const float *x, const int *t, const int batch_size, const SparseLossFunc loss_func
+) {
+    if ((net == NULL) || (x == NULL) || (t == NULL) || (batch_size < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .sparse = &loss_func, .t_sparse = t };
+    return accumulate(net, x, 0, batch_size, batch_size, &loss);
+}
+
+/**
+ * @brief Get a replica of data-parallel training
+ *
+ * @param[in] dp Data-parallel training
+ * @param[in] index Index of the replica, 0 for the network
+ * @return Pointer to the replica
+ */
+static Net *replica(const DataParallel *dp, const int index) {
+    return (index == 0) ? dp->net : &dp->replicas[index - 1];
+}
+
+DataParallel *train_data_parallel_alloc(DataParallel *dp, Net *net, const int num_replicas) {
+    if ((dp == NULL) || (net == NULL) || (num_replicas < 1)) {
+        return NULL;
+    }
+
+    *dp = (DataParallel){ .net = net, .num_replicas = 1, .replicas = NULL };
+
+    if (num_replicas == 1) {
+        return dp;
+    }
+
+    dp->replicas = malloc(sizeof(Net) * (num_replicas - 1));
+    if (dp->replicas == NULL) {
+        return NULL;
+    }
+
+    for (int i = 1; i < num_replicas; i++) {
+        if (net_alloc_replica(&dp->replicas[i - 1], net) == NULL) {
+            train_data_parallel_free(dp);
+            return NULL;
+        }
+        dp->num_replicas++;
+    }
+
+    return dp;
+}
+
+void train_data_parallel_free(DataParallel *dp) {
+    if (dp == NULL) {
+        return;
+    }
+
+    for (int i = 1; i < dp->num_replicas; i++) {
+        net_free_layers(replica(dp, i));
+    }
+    free(dp->replicas);
+
+    dp->replicas = NULL;
+    dp->num_replicas = 1;
+}
+
+/**
+ * @brief Shards of a batch given to replicas
+ */
+typedef struct Shards {
+    const DataParallel *dp; //!< Data-parallel training
+    int num_shards; //!< Number of shards, up to the number of replicas
+    const float *x; //!< Inputs of the batch
+    int batch_size; //!< Number of samples of the batch
+    const BatchLoss *loss; //!< Loss function and expected outputs of the batch
+    float learning_rate; //!< Learning rate of updates by each replica, for Hogwild
+    float *losses; //!< Loss of each shard divided by the batch size
+} Shards;
+
+/**
+ * @brief Get samples of a shard
+ *
+ * @param[in] shards Shards
+ * @param[in] index Index of the shard
+ * @param[out] first Index of the first sample of the shard
+ * @return Number of samples of the shard
+ */
+static int shard_samples(const Shards *shards, const int index, int *first) {
+    *first = (int)((long long)shards->batch_size * index / shards->num_shards);
+    const int last = (int)((long long)shards->batch_size * (index + 1) / shards->num_shards);
+
+    return last - *first;
+}
+
+/**
+ * @brief Accumulate gradients of a range of shards, each on its replica
+ *
+ * @param[in,out] arg Shards
+ * @param[in] begin First index of shards
+ * @param[in] end Index next to the last shard
+ */
+static void run_shards(void *arg, const int begin, const int end) {
+    Shards *shards = arg;
+
+    for (int i = begin; i < end; i++) {
+        int first;
+        const int size = shard_samples(shards, i, &first);
+
+        shards->losses[i] = accumulate(
+            replica(shards->dp, i), shards->x, first, size, shards->batch_size, shards->loss
+        );
+    }
+}
+
+/**
+ * @brief Train samples by micro-batches, updating shared parameters after each one
+ *
+ * @param[in,out] net Replica
+ * @param[in] x Inputs of all samples
+ * @param[in] begin Index of the first sample
+ * @param[in] size Number of samples from the first one
+ * @param[in] num_samples Number of all samples, to weight the loss
+ * @param[in] loss Loss function and expected outputs of all samples
+ * @param[in] learning_rate Learning rate
+ * @return Sum of losses of the samples divided by the number of all samples, NAN if failed
+ */
+static float hogwild(
+    Net *net, const float *x, const int begin, const int size, const int num_samples,
+    const BatchLoss *loss, const float learning_rate
+) {
+    const int micro_batch_size = net->layers[0].params.batch_size;
+    const int in = net->layers[0].params.in;
+    const Layer *output = &net->layers[net->size - 1];
+
+    float *grad = net->output_grad;
+    if (grad == NULL) {
+        return NAN;
+    }
+
+    float total_loss = 0;
+    for (int i = begin; i < (begin + size); i += micro_batch_size) {
+        const int remaining = begin + size - i;
+        const int n = (remaining < micro_batch_size) ? remaining : micro_batch_size;
+
+        const float *y = net_forward_batch(net, &x[(size_t)i * in], n);
+        if (y == NULL) {
+            return NAN;
+        }
+
+        total_loss += micro_batch_loss(loss, grad, y, i, n, output) * n;
+
+        if (net_backward(net, grad) == NULL) {
+            return NAN;
+        }
+
+        // Racy update of the shared parameters, see train_hogwild
+        train_step(net, learning_rate);
+    }
+
+    return total_loss / (float)num_samples;
+}
+
+/**
+ * @brief Train a range of shards asynchronously, each on its replica
+ *
+ * @param[in,out] arg Shards
+ * @param[in] begin First index of shards
+ * @param[in] end Index next to the last shard
+ */
+static void run_hogwild_shards(void *arg, const int begin, const int end) {
+    Shards *shards = arg;
+
+    for (int i = begin; i < end; i++) {
+        int first;
+        const int size = shard_samples(shards, i, &first);
+
+        shards->losses[i] = hogwild(
+            replica(shards->dp, i), shards->x, first, size, shards->batch_size,
+            shards->loss, shards->learning_rate
+        );
+    }
+}
+
+/**
+ * @brief Get the number of shards of samples
+ *
+ * @param[in] dp Data-parallel training
+ * @param[in] batch_size Number of samples
+ * @return Number of replicas, or samples if fewer, a replica without samples is idle
+ */
+static int count_shards(const DataParallel *dp, const int batch_size) {
+    return (batch_size < dp->num_replicas) ? batch_size : dp->num_replicas;
+}
+
+/**
+ * @brief Run shards of samples on replicas in parallel
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of all samples
+ * @param[in] batch_size Number of all samples
+ * @param[in] loss Loss function and expected outputs of all samples
+ * @param[in] task Task run for each range of shards
+ * @param[in] learning_rate Learning rate of the task
+ * @return Mean loss of the samples, NAN if failed
+ */
+static float run_in_parallel(
+    DataParallel *dp, const float *x, const int batch_size, const BatchLoss *loss,
+    ThreadPoolTask task, const float learning_rate
+) {
+    const int num_shards = count_shards(dp, batch_size);
+
+    float *losses = malloc(sizeof(float) * num_shards);
+    if (losses == NULL) {
+        return NAN;
+    }
+
+    Shards shards = {
+        .dp = dp, .num_shards = num_shards, .x = x, .batch_size = batch_size,
+        .loss = loss, .learning_rate = learning_rate, .losses = losses
+    };
+    thread_pool_parallel_for(num_shards, 1, task, &shards);
+
+    // NAN of a failed shard is kept in the sum
+    float total_loss = 0;
+    for (int i = 0; i < num_shards; i++) {
+        total_loss += losses[i];
+    }
+    free(losses);
+
+    return total_loss;
+}
+
+/**
+ * @brief A level of the tree reduction of gradients
+ */
+typedef struct ReduceLevel {
+    const DataParallel *dp; //!< Data-parallel training
+    int stride; //!< Distance between replicas of a pair
+    int num_chunks; //!< Number of chunks of the gradients
+    size_t size; //!< Number of elements of the gradients
+} ReduceLevel;
+
+/**
+ * @brief Add gradients of the 2nd replica of each pair to the 1st one, for a range of chunks
+ *
+ * @param[in,out] arg Level of the reduction
+ * @param[in] begin First index of chunks of all pairs
+ * @param[in] end Index next to the last chunk
+ */
+static void reduce_pairs(void *arg, const int begin, const int end) {
+    const ReduceLevel *level = arg;
+
+    for (int i = begin; i < end; i++) {
+        const int pair = i / level->num_chunks;
+        const size_t first = (size_t)(i % level->num_chunks) * REDUCE_CHUNK_SIZE;
+        const size_t last = ((level->size - first) < REDUCE_CHUNK_SIZE) ?
+            level->size : (first + REDUCE_CHUNK_SIZE);
+
+        const int dst_index = pair * 2 * level->stride;
+        float *dst = replica(level->dp, dst_index)->grads;
+        const float *src = replica(level->dp, (dst_index + level->stride))->grads;
+        for (size_t j = first; j < last; j++) {
+            dst[j] += src[j];
+        }
+    }
+}
+
+/**
+ * @brief Reduce gradients of parameters of replicas into the network
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] num_replicas Number of replicas with gradients, from the network
+ * @note log2(num_replicas) levels, chunks of all pairs of a level run in parallel
+ */
+static void reduce_grads(const DataParallel *dp, const int num_replicas) {
+    const size_t size = dp->net->num_params;
+    const int num_chunks = (int)((size + REDUCE_CHUNK_SIZE - 1) / REDUCE_CHUNK_SIZE);
+
+    for (int stride = 1; stride < num_replicas; stride *= 2) {
+        ReduceLevel level = {
+            .dp = dp, .stride = stride, .num_chunks = num_chunks, .size = size
+        };
+        const int num_pairs = (num_replicas - stride + (2 * stride) - 1) / (2 * stride);
+        thread_pool_parallel_for((num_pairs * num_chunks), 1, reduce_pairs, &level);
+    }
+}
+
+/**
+ * @brief Compute gradients of a batch split across replicas
+ *
+ * @param[in,out] dp Data-parallel training
+ * @param[in] x Inputs of the batch
+ * @param[in] batch_size Number of samples of the batch
+ * @param[in] loss Loss function and expected outputs of the batch
+ * @return Mean loss of the batch, NAN if failed
+ */
+static float data_parallel(
+    DataParallel *dp, const float *x, const int batch_size, const BatchLoss *loss
+) {
+    const float total_loss = run_in_parallel(dp, x, batch_size, loss, run_shards, 0);
+
+    // Only replicas with samples have gradients
+    if (!isnan(total_loss)) {
+        reduce_grads(dp, count_shards(dp, batch_size));
+    }
+
+    return total_loss;
+}
+
+float train_data_parallel(
+    DataParallel *dp, const float *x, const float *t, const int batch_size,
+    const LossFunc loss_func
+) {
+    if ((dp == NULL) || (x == NULL) || (t == NULL) || (batch_size < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .dense = &loss_func, .t = t };
+    return data_parallel(dp, x, batch_size, &loss);
+}
+
+float train_data_parallel_sparse(
+    DataParallel *dp, const float *x, const int *t, const int batch_size,
+    const SparseLossFunc loss_func
+) {
+    if ((dp == NULL) || (x == NULL) || (t == NULL) || (batch_size < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .sparse = &loss_func, .t_sparse = t };
+    return data_parallel(dp, x, batch_size, &loss);
+}
+
+float train_hogwild(
+    DataParallel *dp, const float *x, const float *t, const int num_samples,
+    const float learning_rate, const LossFunc loss_func
+) {
+    if ((dp == NULL) || (x == NULL) || (t == NULL) || (num_samples < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .dense = &loss_func, .t = t };
+    return run_in_parallel(dp, x, num_samples, &loss, run_hogwild_shards, learning_rate);
+}
+
+float train_hogwild_sparse(
+    DataParallel *dp, const float *x, const int *t, const int num_samples,
+    const float learning_rate, const SparseLossFunc loss_func
+) {
+    if ((dp == NULL) || (x == NULL) || (t == NULL) || (num_samples < 1)) {
+        return NAN;
+    }
+
+    const BatchLoss loss = { .sparse = &loss_func, .t_sparse = t };
+    return run_in_parallel(dp, x, num_samples, &loss, run_hogwild_shards, learning_rate);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file vmath.c
+ * @brief Vectorized math functions with a selectable accuracy
+ */
+#include "vmath.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "kernels.h"
+
+/**
+ * @brief Number of elements of a block of exp(x) on the stack
+ */
+#define LOGSUMEXP_BLOCK_SIZE 256
+
+void vmath_exp(float *y, const float *x, const int size, const MathPrecision precision) {
+    if (precision == MATH_PRECISION_FAST) {
+        kernels()->exp(y, x, size);
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        y[i] = expf(x[i]);
+    }
+}
+
+void vmath_log(float *y, const float *x, const int size, const MathPrecision precision) {
+    if (precision == MATH_PRECISION_FAST) {
+        kernels()->log(y, x, size);
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        y[i] = logf(x[i]);
+    }
+}
+
+void vmath_sigmoid(float *y, const float *x, const int size, const MathPrecision precision) {
+    if (precision == MATH_PRECISION_FAST) {
+        kernels()->sigmoid(y, x, size);
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        y[i] = 1 / (1 + expf(-x[i]));
+    }
+}
+
+void vmath_softmax(float *y, const float *x, const int size, const MathPrecision precision) {
+    if (precision == MATH_PRECISION_FAST) {
+        kernels()->softmax(y, x, size);
+        return;
+    }
+
+    // Get a max. of the input to avoid overflow of exp(x)
+    float c = -FLT_MAX;
+    for (int i = 0; i < size; i++) {
+        c = (x[i] > c) ? x[i] : c;
+    }
+
+    // Keep exp(x - c) in the output not to calculate it twice
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        y[i] = expf(x[i] - c);
+        sum += y[i];
+    }
+
+    const float scale = 1.0f / sum;
+    for (int i = 0; i < size; i++) {
+        y[i] *= scale;
+    }
+}
+
+float vmath_logsumexp(const float *x, const int size, const MathPrecision precision) {
+    // Get a max. of the input to avoid overflow of exp(x)
+    float c = -FLT_MAX;
+    for (int i = 0; i < size; i++) {
+        c = (x[i] > c) ? x[i] : c;
+    }
+
+    // exp(x - c) by blocks, without allocating a vector
+    float block[LOGSUMEXP_BLOCK_SIZE];
+    float sum = 0.0f;
+    for (int i = 0; i < size; i += LOGSUMEXP_BLOCK_SIZE) {
+        const int n = ((size - i) < LOGSUMEXP_BLOCK_SIZE) ? (size - i) : LOGSUMEXP_BLOCK_SIZE;
+        for (int j = 0; j < n; j++) {
+            block[j] = x[i + j] - c;
+        }
+        vmath_exp(block, block, n, precision);
+        for (int j = 0; j < n; j++) {
+            sum += block[j];
+        }
+    }
+
+    float log_sum;
+    vmath_log(&log_sum, &sum, 1, precision);
+
+    return c + log_sum;
+}
@@ -4,9 +4,18 @@
  */
 #include "fc_layer.h"
 
+#include <math.h>
 #include <stdlib.h>
 
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "gemm.h"
+#include "generic_kernels.h"
+#include "kernels.h"
 #include "mock_layer.h"
+#include "thread_pool.h"
+#include "vmath.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -14,33 +23,56 @@ void setUp(void) {}
 
 void tearDown(void) {}
 
+static void alloc_memories(Layer *layer) {
+    layer->y = calloc(layer->sizes.y, sizeof(float));
+    layer->w = calloc(layer->sizes.w, sizeof(float));
+    layer->b = calloc(layer->sizes.b, sizeof(float));
+    layer->gx = calloc(layer->sizes.gx, sizeof(float));
+    layer->gw = calloc(layer->sizes.gw, sizeof(float));
+    layer->gb = calloc(layer->sizes.gb, sizeof(float));
+    layer->gz = calloc(layer->sizes.gz, sizeof(float));
+    layer->scratch = calloc(
+        (layer->sizes.forward_scratch > layer->sizes.backward_scratch) ?
+        layer->sizes.forward_scratch : layer->sizes.backward_scratch, sizeof(float)
+    );
+}
+
 static void free_memories(Layer *layer) {
-    free(layer->x);
     free(layer->y);
     free(layer->w);
     free(layer->b);
     free(layer->gx);
     free(layer->gw);
     free(layer->gb);
+    free(layer->gz);
+    free(layer->scratch);
 }
 
-void test_alloc_and_free(void) {
+void test_init(void) {
     Layer layer = {
-        .params={ LAYER_TYPE_FC, .batch_size=1, .in=2, .out=3 }
+        .params={ LAYER_TYPE_FC, .batch_size=4, .in=2, .out=3 }
     };
 
     TEST_ASSERT_EQUAL_PTR(&layer, fc_layer_init(&layer));
-    TEST_ASSERT_NOT_NULL(layer.x);
-    TEST_ASSERT_NOT_NULL(layer.y);
-    TEST_ASSERT_NOT_NULL(layer.w);
-    TEST_ASSERT_NOT_NULL(layer.b);
-    TEST_ASSERT_NOT_NULL(layer.gx);
-    TEST_ASSERT_NOT_NULL(layer.gw);
-    TEST_ASSERT_NOT_NULL(layer.gb);
+    TEST_ASSERT_EQUAL_INT((4 * 3), layer.sizes.y);
+    TEST_ASSERT_EQUAL_INT((3 * 2), layer.sizes.w);
+    TEST_ASSERT_EQUAL_INT(3, layer.sizes.b);
+    TEST_ASSERT_EQUAL_INT((4 * 2), layer.sizes.gx);
+    TEST_ASSERT_EQUAL_INT((3 * 2), layer.sizes.gw);
+    TEST_ASSERT_EQUAL_INT(3, layer.sizes.gb);
+    TEST_ASSERT_EQUAL_INT(gemm_work_size(4, 3, 2), layer.sizes.forward_scratch);
+    TEST_ASSERT_EQUAL_INT(gemm_work_size(3, 2, 4), layer.sizes.backward_scratch);
     TEST_ASSERT_NOT_NULL(layer.forward);
     TEST_ASSERT_NOT_NULL(layer.backward);
+    TEST_ASSERT_NOT_NULL(layer.fuse);
+}
 
-    free_memories(&layer);
+void test_init_fail_if_size_is_0(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=4, .in=2 }
+    };
+
+    TEST_ASSERT_NULL(fc_layer_init(&layer));
 }
 
 void test_forward(void) {
@@ -49,6 +81,7 @@ void test_forward(void) {
     };
 
     fc_layer_init(&layer);
+    alloc_memories(&layer);
 
     test_util_copy_array(
         layer.w,
@@ -81,22 +114,56 @@ void test_forward(void) {
     free_memories(&layer);
 }
 
-void test_backward(void) {
+void test_forward_borrows_input(void) {
     Layer layer = {
         .params={ LAYER_TYPE_FC, .batch_size=2, .in=2, .out=3 }
     };
 
     fc_layer_init(&layer);
+    alloc_memories(&layer);
 
     test_util_copy_array(
-        layer.x,
+        layer.w,
         TEST_UTIL_FLOAT_ARRAY(
+            0, 1,
+            0, -1,
             1, 1,
-            -1, -1
         ),
-        (sizeof(float) * (2 * 2))
+        (sizeof(float) * (3 * 2))
     );
 
+    test_util_copy_array(
+        layer.b, TEST_UTIL_FLOAT_ARRAY(-1, 0, 1), (sizeof(float) * 3)
+    );
+
+    float x[] = {
+        1, 1,
+        -1, -1
+    };
+
+    float y[] = {
+        0, -1, 3,
+        -2, 1, -1
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
+        y, layer.forward(&layer, x), (2 * 3)
+    );
+
+    // Input is kept for backward without a copy
+    TEST_ASSERT_EQUAL_PTR(x, layer.x);
+
+    free_memories(&layer);
+}
+
+void test_forward_smaller_batch(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=4, .in=2, .out=3 }
+    };
+
+    fc_layer_init(&layer);
+    alloc_memories(&layer);
+
     test_util_copy_array(
         layer.w,
         TEST_UTIL_FLOAT_ARRAY(
@@ -107,19 +174,68 @@ void test_backward(void) {
         (sizeof(float) * (3 * 2))
     );
 
-    // Clear gradients
     test_util_copy_array(
-        layer.gx, TEST_UTIL_FLOAT_ZEROS(2 * 2), (sizeof(float) * (2 * 2))
+        layer.b, TEST_UTIL_FLOAT_ARRAY(-1, 0, 1), (sizeof(float) * 3)
     );
 
-    test_util_copy_array(
-        layer.gw, TEST_UTIL_FLOAT_ZEROS(3 * 2), (sizeof(float) * (3 * 2))
+    // Only 2 samples of 4
+    layer.batch = 2;
+
+    float x[] = {
+        1, 1,
+        -1, -1
+    };
+
+    float y[] = {
+        0, -1, 3,
+        -2, 1, -1,
+        0, 0, 0,
+        0, 0, 0
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
+        y, layer.forward(&layer, x), (4 * 3)
     );
 
+    free_memories(&layer);
+}
+
+void test_backward(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=2, .in=2, .out=3 }
+    };
+
+    fc_layer_init(&layer);
+    alloc_memories(&layer);
+
+    // Input borrowed in forward
+    float x[] = {
+        1, 1,
+        -1, -1
+    };
+    layer.x = x;
+
     test_util_copy_array(
-        layer.gb, TEST_UTIL_FLOAT_ZEROS(3), (sizeof(float) * 3)
+        layer.w,
+        TEST_UTIL_FLOAT_ARRAY(
+            0, 1,
+            0, -1,
+            1, 1,
+        ),
+        (sizeof(float) * (3 * 2))
     );
 
+    // Gradients are overwritten without clearing
+    for (int i = 0; i < (2 * 2); i++) {
+        layer.gx[i] = 100;
+    }
+    for (int i = 0; i < (3 * 2); i++) {
+        layer.gw[i] = 100;
+    }
+    for (int i = 0; i < 3; i++) {
+        layer.gb[i] = 100;
+    }
+
     float dy[] = {
         0, 1, -3,
         2, -1, 1
@@ -150,3 +266,178 @@ void test_backward(void) {
 
     free_memories(&layer);
 }
+
+void test_backward_accumulate(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=2, .in=2, .out=3 }
+    };
+
+    fc_layer_init(&layer);
+    alloc_memories(&layer);
+
+    float x[] = {
+        1, 1,
+        -1, -1
+    };
+    layer.x = x;
+    layer.accumulate = true;
+
+    test_util_copy_array(
+        layer.w,
+        TEST_UTIL_FLOAT_ARRAY(
+            0, 1,
+            0, -1,
+            1, 1,
+        ),
+        (sizeof(float) * (3 * 2))
+    );
+
+    // Gradients of parameters of a previous micro-batch
+    for (int i = 0; i < (2 * 2); i++) {
+        layer.gx[i] = 1;
+    }
+    for (int i = 0; i < (3 * 2); i++) {
+        layer.gw[i] = 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        layer.gb[i] = 1;
+    }
+
+    float dy[] = {
+        0, 1, -3,
+        2, -1, 1
+    };
+
+    // Gradient of the input is still overwritten
+    float gx[] = {
+        -3, -4,
+        1, 4
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
+        gx, layer.backward(&layer, dy), (2 * 2)
+    );
+
+    float gw[] = {
+        -1, -1,
+        3, 3,
+        -3, -3
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(gw, layer.gw, (3 * 2));
+
+    float gb[] = {
+        3, 1, -1
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(gb, layer.gb, 3);
+
+    free_memories(&layer);
+}
+
+void test_fuse_sigmoid(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=2, .in=2, .out=3 }
+    };
+    Layer next = {
+        .params={ LAYER_TYPE_SIGMOID, .batch_size=2, .in=3, .out=3 },
+        .sizes={ .y=(2 * 3), .gx=(2 * 3) }
+    };
+
+    fc_layer_init(&layer);
+    TEST_ASSERT_TRUE(layer.fuse(&layer, &next));
+
+    // Sigmoid is applied by the FC layer, which keeps the gradient before it
+    TEST_ASSERT_EQUAL_INT((2 * 3), layer.sizes.gz);
+    TEST_ASSERT_EQUAL_INT(0, next.sizes.y);
+    TEST_ASSERT_EQUAL_INT(0, next.sizes.gx);
+    TEST_ASSERT_NULL(layer.fuse);
+
+    alloc_memories(&layer);
+
+    test_util_copy_array(
+        layer.w,
+        TEST_UTIL_FLOAT_ARRAY(
+            0, 1,
+            0, -1,
+            1, 1,
+        ),
+        (sizeof(float) * (3 * 2))
+    );
+
+    test_util_copy_array(
+        layer.b, TEST_UTIL_FLOAT_ARRAY(-1, 0, 1), (sizeof(float) * 3)
+    );
+
+    float x[] = {
+        1, 1,
+        -1, -1
+    };
+
+    // Output of the FC layer before the sigmoid
+    const float z[] = {
+        0, -1, 3,
+        -2, 1, -1
+    };
+
+    float y[2 * 3];
+    for (int i = 0; i < (2 * 3); i++) {
+        y[i] = 1 / (1 + expf(-z[i]));
+    }
+
+    float *fc_y = layer.forward(&layer, x);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, y, fc_y, (2 * 3));
+    TEST_ASSERT_EQUAL_PTR(fc_y, next.forward(&next, fc_y));
+    TEST_ASSERT_EQUAL_PTR(fc_y, next.x);
+    TEST_ASSERT_EQUAL_PTR(fc_y, next.y);
+
+    float dy[] = {
+        0, 1, -3,
+        2, -1, 1
+    };
+
+    // Gradients through the sigmoid
+    float gz[2 * 3];
+    float gb[3] = { 0 };
+    for (int i = 0; i < (2 * 3); i++) {
+        gz[i] = dy[i] * y[i] * (1 - y[i]);
+        gb[i % 3] += gz[i];
+    }
+
+    float gx[2 * 2];
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            gx[i * 2 + j] = 0;
+            for (int k = 0; k < 3; k++) {
+                gx[i * 2 + j] += gz[i * 3 + k] * layer.w[k * 2 + j];
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL_PTR(dy, next.backward(&next, dy));
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, gx, layer.backward(&layer, dy), (2 * 2));
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, gb, layer.gb, 3);
+
+    // The bias gradient is summed over backwards when accumulating
+    layer.accumulate = true;
+    layer.backward(&layer, dy);
+    for (int i = 0; i < 3; i++) {
+        gb[i] *= 2;
+    }
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, gb, layer.gb, 3);
+
+    free_memories(&layer);
+}
+
+void test_fuse_fail_if_next_is_not_sigmoid(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_FC, .batch_size=2, .in=2, .out=3 }
+    };
+    Layer next = {
+        .params={ LAYER_TYPE_SOFTMAX, .batch_size=2, .in=3, .out=3 }
+    };
+
+    fc_layer_init(&layer);
+    TEST_ASSERT_FALSE(layer.fuse(&layer, &next));
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gz);
+}
@@ -6,7 +6,14 @@
 
 #include <stdlib.h>
 
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
 #include "mock_layer.h"
+#include "thread_pool.h"
+#include "vmath.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -14,30 +21,31 @@ void setUp(void) {}
 
 void tearDown(void) {}
 
+static void alloc_memories(Layer *layer) {
+    layer->y = calloc(layer->sizes.y, sizeof(float));
+    layer->gx = calloc(layer->sizes.gx, sizeof(float));
+}
+
 static void free_memories(Layer *layer) {
-    free(layer->x);
     free(layer->y);
     free(layer->gx);
 }
 
-void test_alloc_and_free(void) {
+void test_init(void) {
     Layer layer = {
-        .params={ LAYER_TYPE_SIGMOID, .batch_size=1, .in=2 }
+        .params={ LAYER_TYPE_SIGMOID, .batch_size=4, .in=2 }
     };
 
     TEST_ASSERT_EQUAL_PTR(&layer, sigmoid_layer_init(&layer));
     TEST_ASSERT_EQUAL_INT(2, layer.params.out);
-    TEST_ASSERT_NOT_NULL(layer.x);
-    TEST_ASSERT_NOT_NULL(layer.y);
-    TEST_ASSERT_NULL(layer.w);
-    TEST_ASSERT_NULL(layer.b);
-    TEST_ASSERT_NOT_NULL(layer.gx);
-    TEST_ASSERT_NULL(layer.gw);
-    TEST_ASSERT_NULL(layer.gb);
+    TEST_ASSERT_EQUAL_INT((4 * 2), layer.sizes.y);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.w);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.b);
+    TEST_ASSERT_EQUAL_INT((4 * 2), layer.sizes.gx);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gw);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gb);
     TEST_ASSERT_NOT_NULL(layer.forward);
     TEST_ASSERT_NOT_NULL(layer.backward);
-
-    free_memories(&layer);
 }
 
 void test_forward(void) {
@@ -46,6 +54,7 @@ void test_forward(void) {
     };
 
     sigmoid_layer_init(&layer);
+    alloc_memories(&layer);
 
     float x[] = {
         -1, -0.5, -0.25,
@@ -61,6 +70,9 @@ void test_forward(void) {
         y, layer.forward(&layer, x), (2 * 3)
     );
 
+    // Backward needs only the output, the input is not kept
+    TEST_ASSERT_NULL(layer.x);
+
     free_memories(&layer);
 }
 
@@ -70,6 +82,7 @@ void test_backward(void) {
     };
 
     sigmoid_layer_init(&layer);
+    alloc_memories(&layer);
 
     test_util_copy_array(
         layer.y,
@@ -96,3 +109,30 @@ void test_backward(void) {
 
     free_memories(&layer);
 }
+
+void test_backward_multithreaded(void) {
+    Layer layer = {
+        .params={ LAYER_TYPE_SIGMOID, .batch_size=100, .in=1000 }
+    };
+
+    sigmoid_layer_init(&layer);
+    alloc_memories(&layer);
+
+    const int size = 100 * 1000;
+    float *dy = malloc(sizeof(float) * size);
+    float *gx = malloc(sizeof(float) * size);
+    for (int i = 0; i < size; i++) {
+        layer.y[i] = (float)(i % 9 + 1) / 10;
+        dy[i] = (float)((i % 7) - 3);
+        gx[i] = dy[i] * layer.y[i] * (1 - layer.y[i]);
+    }
+
+    // Ranges of elements are given to threads
+    thread_pool_set_num_threads(4);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(gx, layer.backward(&layer, dy), size);
+    thread_pool_set_num_threads(1);
+
+    free(dy);
+    free(gx);
+    free_memories(&layer);
+}
@@ -6,7 +6,14 @@
 
 #include <stdlib.h>
 
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
 #include "mock_layer.h"
+#include "thread_pool.h"
+#include "vmath.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -14,30 +21,31 @@ void setUp(void) {}
 
 void tearDown(void) {}
 
+static void alloc_memories(Layer *layer) {
+    layer->y = calloc(layer->sizes.y, sizeof(float));
+    layer->gx = calloc(layer->sizes.gx, sizeof(float));
+}
+
 static void free_memories(Layer *layer) {
-    free(layer->x);
     free(layer->y);
     free(layer->gx);
 }
 
-void test_alloc_and_free(void) {
+void test_init(void) {
     Layer layer = {
-        .params={ LAYER_TYPE_SOFTMAX, .batch_size=1, .in=3 }
+        .params={ LAYER_TYPE_SOFTMAX, .batch_size=4, .in=3 }
     };
 
     TEST_ASSERT_EQUAL_PTR(&layer, softmax_layer_init(&layer));
     TEST_ASSERT_EQUAL_INT(3, layer.params.out);
-    TEST_ASSERT_NOT_NULL(layer.x);
-    TEST_ASSERT_NOT_NULL(layer.y);
-    TEST_ASSERT_NULL(layer.w);
-    TEST_ASSERT_NULL(layer.b);
-    TEST_ASSERT_NOT_NULL(layer.gx);
-    TEST_ASSERT_NULL(layer.gw);
-    TEST_ASSERT_NULL(layer.gb);
+    TEST_ASSERT_EQUAL_INT((4 * 3), layer.sizes.y);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.w);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.b);
+    TEST_ASSERT_EQUAL_INT((4 * 3), layer.sizes.gx);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gw);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gb);
     TEST_ASSERT_NOT_NULL(layer.forward);
     TEST_ASSERT_NOT_NULL(layer.backward);
-
-    free_memories(&layer);
 }
 
 void test_forward(void) {
@@ -46,6 +54,7 @@ void test_forward(void) {
     };
 
     softmax_layer_init(&layer);
+    alloc_memories(&layer);
 
     float x[] = {
         0.8, 0.2, 0.1,
@@ -61,6 +70,9 @@ void test_forward(void) {
         y, layer.forward(&layer, x), (2 * 3)
     );
 
+    // Backward needs only the output, the input is not kept
+    TEST_ASSERT_NULL(layer.x);
+
     free_memories(&layer);
 }
 
@@ -70,6 +82,7 @@ void test_backward(void) {
     };
 
     softmax_layer_init(&layer);
+    alloc_memories(&layer);
 
     test_util_copy_array(
         layer.y,
@@ -16,7 +16,7 @@ void test_bce_loss(void) {
     float y[] = { 0.7, 0.2, 0.1 };
     float t[] = { 1, 0, 0 };
 
-    TEST_ASSERT_EQUAL_FLOAT(0.2283930, loss_func.forward(y, t, 3, 1));
+    TEST_ASSERT_EQUAL_FLOAT(0.2283930, loss_func.forward(y, t, 3, 1, MATH_PRECISION_FAST));
 }
 
 void test_bce_loss_backward(void) {
@@ -26,7 +26,7 @@ void test_bce_loss_backward(void) {
     float t[] = { 1, 0, 0 };
 
     float grad[3];
-    loss_func.backward(grad, y, t, 3, 1);
+    loss_func.backward(grad, y, t, 3, 1, MATH_PRECISION_FAST);
 
     float answer[] = { -0.4761905, 0.4166666, 0.3703704 };
     TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, 3);
@@ -24,7 +24,7 @@ void test_ce_loss(void) {
     };
 
     // Result is based on PyTorch.torch.nn.NLLLoss()
-    TEST_ASSERT_EQUAL_FLOAT(0.9830564, loss_func.forward(y, t, 2, 3));
+    TEST_ASSERT_EQUAL_FLOAT(0.9830564, loss_func.forward(y, t, 2, 3, MATH_PRECISION_FAST));
 }
 
 void test_ce_loss_backward(void) {
@@ -41,7 +41,7 @@ void test_ce_loss_backward(void) {
     };
 
     float grad[2 * 3];
-    loss_func.backward(grad, y, t, 2, 3);
+    loss_func.backward(grad, y, t, 2, 3, MATH_PRECISION_FAST);
 
     // Result is based on PyTorch.torch.nn.NLLLoss()
     float answer[] = {
@@ -0,0 +1,80 @@
+/**
+ * @file test_softmax_ce_loss.c
+ * @brief Unit tests of softmax_ce_loss.c
+ */
+#include "softmax_ce_loss.h"
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "vmath.h"
+#include "unity.h"
+
+// Precisions to be tested
+static const MathPrecision precisions[] = { MATH_PRECISION_FAST, MATH_PRECISION_ACCURATE };
+
+#define NUM_PRECISIONS 2
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_softmax_ce_loss(void) {
+    LossFunc loss_func = softmax_ce_loss();
+
+    float y[] = {
+        1, 2, 3,
+        0.5, -1, 0
+    };
+
+    float t[] = {
+        0, 0, 1,
+        1, 0, 0
+    };
+
+    // Result is based on PyTorch.torch.nn.CrossEntropyLoss()
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(0.5058683, loss_func.forward(y, t, 2, 3, precisions[i]));
+    }
+}
+
+void test_softmax_ce_loss_of_large_logits(void) {
+    LossFunc loss_func = softmax_ce_loss();
+
+    float y[] = { 1000, 0, -1000 };
+    float t[] = { 0, 1, 0 };
+
+    // Stable without overflow of exp(y)
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(1000, loss_func.forward(y, t, 1, 3, precisions[i]));
+    }
+}
+
+void test_softmax_ce_loss_backward(void) {
+    LossFunc loss_func = softmax_ce_loss();
+
+    float y[] = {
+        1, 2, 3,
+        0.5, -1, 0
+    };
+
+    float t[] = {
+        0, 0, 1,
+        1, 0, 0
+    };
+
+    float grad[2 * 3];
+
+    // (softmax(y) - t) / batch_size
+    float answer[] = {
+        0.0450153, 0.1223642, -0.1673795,
+        -0.2267253, 0.0609758, 0.1657495
+    };
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        loss_func.backward(grad, y, t, 2, 3, precisions[i]);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, (2 * 3));
+    }
+}
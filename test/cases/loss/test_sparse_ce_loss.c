@@ -0,0 +1,71 @@
+/**
+ * @file test_sparse_ce_loss.c
+ * @brief Unit tests of sparse_ce_loss.c
+ */
+#include "sparse_ce_loss.h"
+
+#include "unity.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_sparse_ce_loss(void) {
+    SparseLossFunc loss_func = sparse_ce_loss();
+
+    float y[] = {
+        0.7, 0.2, 0.1,
+        0.2, 0.6, 0.2
+    };
+
+    int t[] = { 0, 2 };
+
+    // Same as one-hot labels, based on PyTorch.torch.nn.NLLLoss()
+    TEST_ASSERT_EQUAL_FLOAT(0.9830564, loss_func.forward(y, t, 2, 3, MATH_PRECISION_FAST));
+}
+
+void test_sparse_ce_loss_backward(void) {
+    SparseLossFunc loss_func = sparse_ce_loss();
+
+    float y[] = {
+        0.7, 0.2, 0.1,
+        0.2, 0.6, 0.2
+    };
+
+    int t[] = { 0, 2 };
+
+    // Non-zero values are overwritten
+    float grad[2 * 3] = { 1, 1, 1, 1, 1, 1 };
+    loss_func.backward(grad, y, t, 2, 3, MATH_PRECISION_FAST);
+
+    float answer[] = {
+        -0.7142857, 0, 0,
+        0, 0, -2.5000000
+    };
+
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, (2 * 3));
+}
+
+void test_sparse_ce_loss_of_invalid_class(void) {
+    SparseLossFunc loss_func = sparse_ce_loss();
+
+    float y[] = {
+        0.7, 0.2, 0.1,
+        0.2, 0.6, 0.2
+    };
+
+    TEST_ASSERT_FLOAT_IS_NAN(loss_func.forward(y, ((int[]){ 0, 3 }), 2, 3, MATH_PRECISION_FAST));
+    TEST_ASSERT_FLOAT_IS_NAN(loss_func.forward(y, ((int[]){ -1, 2 }), 2, 3, MATH_PRECISION_FAST));
+
+    // Nothing is written out of the gradient, the wrong sample has no gradient
+    float grad[2 * 3 + 1];
+    grad[2 * 3] = 100;
+    loss_func.backward(grad, y, ((int[]){ 0, 3 }), 2, 3, MATH_PRECISION_FAST);
+
+    float answer[] = {
+        -0.7142857, 0, 0,
+        0, 0, 0,
+        100
+    };
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, (2 * 3 + 1));
+}
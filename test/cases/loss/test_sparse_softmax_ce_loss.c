@@ -0,0 +1,110 @@
+/**
+ * @file test_sparse_softmax_ce_loss.c
+ * @brief Unit tests of sparse_softmax_ce_loss.c
+ */
+#include "sparse_softmax_ce_loss.h"
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "vmath.h"
+#include "unity.h"
+
+// Precisions to be tested
+static const MathPrecision precisions[] = { MATH_PRECISION_FAST, MATH_PRECISION_ACCURATE };
+
+#define NUM_PRECISIONS 2
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_sparse_softmax_ce_loss(void) {
+    SparseLossFunc loss_func = sparse_softmax_ce_loss();
+
+    float y[] = {
+        1, 2, 3,
+        0.5, -1, 0
+    };
+
+    int t[] = { 2, 0 };
+
+    // Result is based on PyTorch.torch.nn.CrossEntropyLoss()
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(0.5058683, loss_func.forward(y, t, 2, 3, precisions[i]));
+    }
+}
+
+void test_sparse_softmax_ce_loss_backward(void) {
+    SparseLossFunc loss_func = sparse_softmax_ce_loss();
+
+    float y[] = {
+        1, 2, 3,
+        0.5, -1, 0
+    };
+
+    int t[] = { 2, 0 };
+
+    float grad[2 * 3];
+
+    // (softmax(y) - onehot(t)) / batch_size
+    float answer[] = {
+        0.0450153, 0.1223642, -0.1673795,
+        -0.2267253, 0.0609758, 0.1657495
+    };
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        loss_func.backward(grad, y, t, 2, 3, precisions[i]);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, (2 * 3));
+    }
+}
+
+void test_sparse_softmax_ce_loss_gradient_of_forward(void) {
+    SparseLossFunc loss_func = sparse_softmax_ce_loss();
+
+    float y[] = { 1, 2, 3 };
+    int t[] = { 1 };
+    float grad[3];
+
+    // Backward is the derivative of forward of the same precision, by central differences
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        loss_func.backward(grad, y, t, 1, 3, precisions[i]);
+        for (int j = 0; j < 3; j++) {
+            const float h = 1e-2f;
+            const float y_j = y[j];
+            y[j] = y_j + h;
+            const float upper = loss_func.forward(y, t, 1, 3, precisions[i]);
+            y[j] = y_j - h;
+            const float lower = loss_func.forward(y, t, 1, 3, precisions[i]);
+            y[j] = y_j;
+
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, ((upper - lower) / (2 * h)), grad[j]);
+        }
+    }
+}
+
+void test_sparse_softmax_ce_loss_of_invalid_class(void) {
+    SparseLossFunc loss_func = sparse_softmax_ce_loss();
+
+    float y[] = {
+        1, 2, 3,
+        0.5, -1, 0
+    };
+
+    TEST_ASSERT_FLOAT_IS_NAN(loss_func.forward(y, ((int[]){ 2, 3 }), 2, 3, MATH_PRECISION_FAST));
+    TEST_ASSERT_FLOAT_IS_NAN(loss_func.forward(y, ((int[]){ -1, 0 }), 2, 3, MATH_PRECISION_FAST));
+
+    // Nothing is written out of the gradient, the wrong sample has only softmax(y)
+    float grad[2 * 3 + 1];
+    grad[2 * 3] = 100;
+    loss_func.backward(grad, y, ((int[]){ 2, 3 }), 2, 3, MATH_PRECISION_FAST);
+
+    float answer[] = {
+        0.0450153, 0.1223642, -0.1673795,
+        0.2732747, 0.0609758, 0.1657495,
+        100
+    };
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, grad, (2 * 3 + 1));
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_data_loader.c
+ * @brief Unit tests of data_loader.c
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "data_loader.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "dataset.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "random.h"
+#include "sampler.h"
+#include "vmath.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Number of samples of test datasets
+#define NUM_SAMPLES 5
+
+// Number of elements of an input
+#define SAMPLE_SIZE 3
+
+// Temporary files of datasets
+static char inputs_filename[] = "/tmp/test_data_loader_XXXXXX";
+static char labels_filename[] = "/tmp/test_data_loader_labels_XXXXXX";
+
+static Dataset inputs;
+static Dataset labels;
+
+// Write a dataset to a temporary file and map it
+static void open_temp(
+    Dataset *dataset, char *filename, const DatasetType type, const int ndim, const int *shape,
+    const void *data
+) {
+    strcpy(&filename[strlen(filename) - 6], "XXXXXX");
+    const int fd = mkstemp(filename);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    TEST_ASSERT_TRUE(dataset_write(filename, type, ndim, shape, NUM_SAMPLES, data));
+    TEST_ASSERT_NOT_NULL(dataset_open(dataset, filename));
+}
+
+void setUp(void) {
+    uint8_t pixels[NUM_SAMPLES * SAMPLE_SIZE];
+    for (int i = 0; i < (NUM_SAMPLES * SAMPLE_SIZE); i++) {
+        pixels[i] = (uint8_t)i;
+    }
+    const uint8_t classes[NUM_SAMPLES] = { 4, 3, 2, 1, 0 };
+
+    open_temp(
+        &inputs, inputs_filename, DATASET_TYPE_UINT8, 1, (int[]){ SAMPLE_SIZE }, pixels
+    );
+    open_temp(&labels, labels_filename, DATASET_TYPE_UINT8, 0, NULL, classes);
+}
+
+void tearDown(void) {
+    dataset_close(&inputs);
+    dataset_close(&labels);
+    remove(inputs_filename);
+    remove(labels_filename);
+}
+
+// Check a batch of samples from an index
+static void assert_batch(const DataLoaderBatch *batch, const int index, const int size) {
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_EQUAL_INT(size, batch->size);
+    TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)batch->x % 64));
+
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < SAMPLE_SIZE; j++) {
+            TEST_ASSERT_EQUAL_FLOAT(
+                (float)(((index + i) * SAMPLE_SIZE + j) * 2), batch->x[i * SAMPLE_SIZE + j]
+            );
+        }
+        TEST_ASSERT_EQUAL_INT(4 - (index + i), batch->t[i]);
+    }
+}
+
+void test_batches_of_epochs(void) {
+    DataLoader loader;
+    TEST_ASSERT_EQUAL_PTR(&loader, data_loader_alloc(&loader, &inputs, &labels, 2, 2, NULL));
+
+    for (int epoch = 0; epoch < 3; epoch++) {
+        assert_batch(data_loader_next(&loader), 0, 2);
+        assert_batch(data_loader_next(&loader), 2, 2);
+        // The rest of the epoch
+        assert_batch(data_loader_next(&loader), 4, 1);
+        TEST_ASSERT_NULL(data_loader_next(&loader));
+    }
+
+    data_loader_free(&loader);
+}
+
+void test_batch_of_whole_dataset(void) {
+    DataLoader loader;
+    TEST_ASSERT_NOT_NULL(data_loader_alloc(&loader, &inputs, &labels, 8, 2, NULL));
+
+    assert_batch(data_loader_next(&loader), 0, NUM_SAMPLES);
+    TEST_ASSERT_NULL(data_loader_next(&loader));
+    assert_batch(data_loader_next(&loader), 0, NUM_SAMPLES);
+
+    // Freed while holding a batch
+    data_loader_free(&loader);
+    data_loader_free(&loader);
+}
+
+void test_int32_labels(void) {
+    Dataset int_labels;
+    char filename[] = "/tmp/test_data_loader_int_XXXXXX";
+    open_temp(
+        &int_labels, filename, DATASET_TYPE_INT32, 0, NULL, ((int32_t[]){ 4, 3, 2, 1, 0 })
+    );
+
+    DataLoader loader;
+    TEST_ASSERT_NOT_NULL(data_loader_alloc(&loader, &inputs, &int_labels, 3, 2, NULL));
+    assert_batch(data_loader_next(&loader), 0, 3);
+    assert_batch(data_loader_next(&loader), 3, 2);
+    data_loader_free(&loader);
+
+    dataset_close(&int_labels);
+    remove(filename);
+}
+
+void test_without_labels(void) {
+    DataLoader loader;
+    TEST_ASSERT_NOT_NULL(data_loader_alloc(&loader, &inputs, NULL, 4, 1, NULL));
+
+    const DataLoaderBatch *batch = data_loader_next(&loader);
+    TEST_ASSERT_EQUAL_INT(4, batch->size);
+    TEST_ASSERT_NULL(batch->t);
+    TEST_ASSERT_EQUAL_FLOAT(11, batch->x[11]);
+
+    data_loader_free(&loader);
+}
+
+void test_shuffled_batches(void) {
+    Sampler sampler;
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&sampler, NUM_SAMPLES, 1));
+
+    DataLoader loader;
+    TEST_ASSERT_NOT_NULL(data_loader_alloc(&loader, &inputs, &labels, 2, 2, &sampler));
+
+    for (int epoch = 0; epoch < 3; epoch++) {
+        // Each sample once an epoch, its input and label stay together
+        bool seen[NUM_SAMPLES] = { false };
+        int num_seen = 0;
+        for (const DataLoaderBatch *batch; (batch = data_loader_next(&loader)) != NULL;) {
+            for (int i = 0; i < batch->size; i++) {
+                const int index = 4 - batch->t[i];
+                TEST_ASSERT_FALSE(seen[index]);
+                seen[index] = true;
+                num_seen++;
+
+                TEST_ASSERT_EQUAL_FLOAT(
+                    (float)(index * SAMPLE_SIZE * 2), batch->x[i * SAMPLE_SIZE]
+                );
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(NUM_SAMPLES, num_seen);
+    }
+
+    data_loader_free(&loader);
+    sampler_free(&sampler);
+}
+
+void test_alloc_fail_if_args_are_invalid(void) {
+    DataLoader loader;
+    TEST_ASSERT_NULL(data_loader_alloc(&loader, &inputs, &labels, 0, 1, NULL));
+    TEST_ASSERT_NULL(data_loader_alloc(&loader, NULL, &labels, 1, 1, NULL));
+    TEST_ASSERT_NULL(data_loader_alloc(NULL, &inputs, &labels, 1, 1, NULL));
+
+    // Labels must be class indices of the same samples
+    TEST_ASSERT_NULL(data_loader_alloc(&loader, &inputs, &inputs, 1, 1, NULL));
+
+    Dataset float_labels;
+    char filename[] = "/tmp/test_data_loader_float_XXXXXX";
+    open_temp(
+        &float_labels, filename, DATASET_TYPE_FLOAT32, 0, NULL, ((float[]){ 0, 1, 2, 3, 4 })
+    );
+    TEST_ASSERT_NULL(data_loader_alloc(&loader, &inputs, &float_labels, 1, 1, NULL));
+    dataset_close(&float_labels);
+    remove(filename);
+
+    // A sampler of other samples
+    Sampler sampler;
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&sampler, (NUM_SAMPLES + 1), 1));
+    TEST_ASSERT_NULL(data_loader_alloc(&loader, &inputs, &labels, 1, 1, &sampler));
+    sampler_free(&sampler);
+}
@@ -0,0 +1,381 @@
+/**
+ * @file test_dataset.c
+ * @brief Unit tests of dataset.c
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "dataset.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Temporary files of a test
+static char dataset_filename[] = "/tmp/test_dataset_XXXXXX";
+static char idx_filename[] = "/tmp/test_dataset_idx_XXXXXX";
+
+// Create an empty temporary file from a template
+static void make_temp(char *filename) {
+    strcpy(&filename[strlen(filename) - 6], "XXXXXX");
+    const int fd = mkstemp(filename);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+}
+
+// Write bytes to a file
+static void write_bytes(const char *filename, const uint8_t *bytes, const size_t size) {
+    FILE *fp = fopen(filename, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL_INT(size, fwrite(bytes, 1, size, fp));
+    fclose(fp);
+}
+
+// Overwrite the shape in the header of a dataset file
+static void overwrite_shape(const char *filename, const uint32_t *shape, const int ndim) {
+    FILE *fp = fopen(filename, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+
+    // After the magic, version, type, number of samples and number of dimensions
+    TEST_ASSERT_EQUAL_INT(0, fseek(fp, 28, SEEK_SET));
+    TEST_ASSERT_EQUAL_INT(ndim, fwrite(shape, sizeof(uint32_t), ndim, fp));
+    fclose(fp);
+}
+
+void setUp(void) {
+    make_temp(dataset_filename);
+    make_temp(idx_filename);
+}
+
+void tearDown(void) {
+    remove(dataset_filename);
+    remove(idx_filename);
+    kernels_init();
+}
+
+void test_type_size(void) {
+    TEST_ASSERT_EQUAL_INT(4, dataset_type_size(DATASET_TYPE_FLOAT32));
+    TEST_ASSERT_EQUAL_INT(1, dataset_type_size(DATASET_TYPE_UINT8));
+    TEST_ASSERT_EQUAL_INT(4, dataset_type_size(DATASET_TYPE_INT32));
+}
+
+void test_write_and_open(void) {
+    const float samples[] = {
+        0, 1, 2, 3, 4, 5,
+        6, 7, 8, 9, 10, 11,
+        12, 13, 14, 15, 16, 17
+    };
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 2, (int[]){ 2, 3 }, 3, samples)
+    );
+
+    Dataset dataset;
+    TEST_ASSERT_EQUAL_PTR(&dataset, dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_EQUAL_INT(DATASET_TYPE_FLOAT32, dataset.type);
+    TEST_ASSERT_EQUAL_INT(3, dataset.num_samples);
+    TEST_ASSERT_EQUAL_INT(6, dataset.sample_size);
+    TEST_ASSERT_EQUAL_INT(2, dataset.ndim);
+    TEST_ASSERT_EQUAL_INT_ARRAY(((int[]){ 2, 3 }), dataset.shape, 2);
+
+    // Samples are aligned in the mapping
+    TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)dataset.data % 64));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(samples, dataset.data, 18);
+
+    // Views of contiguous samples
+    TEST_ASSERT_EQUAL_PTR(dataset.data, dataset_samples(&dataset, 0, 3));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(&samples[6], dataset_samples(&dataset, 1, 2), 12);
+    TEST_ASSERT_NOT_NULL(dataset_samples(&dataset, 3, 0));
+    TEST_ASSERT_NULL(dataset_samples(&dataset, 2, 2));
+    TEST_ASSERT_NULL(dataset_samples(&dataset, 4, 0));
+
+    dataset_close(&dataset);
+    TEST_ASSERT_NULL(dataset.data);
+    TEST_ASSERT_NULL(dataset_samples(&dataset, 0, 1));
+
+    // Closed twice
+    dataset_close(&dataset);
+}
+
+void test_write_scalars(void) {
+    const int32_t labels[] = { 3, 1, 4, 1, 5 };
+    TEST_ASSERT_TRUE(dataset_write(dataset_filename, DATASET_TYPE_INT32, 0, NULL, 5, labels));
+
+    Dataset dataset;
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_EQUAL_INT(0, dataset.ndim);
+    TEST_ASSERT_EQUAL_INT(1, dataset.sample_size);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(&labels[2], dataset_samples(&dataset, 2, 3), 3);
+    dataset_close(&dataset);
+}
+
+void test_write_fail_if_shape_is_invalid(void) {
+    const float sample = 0;
+    TEST_ASSERT_FALSE(
+        dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 1, (int[]){ 0 }, 1, &sample)
+    );
+    TEST_ASSERT_FALSE(
+        dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, (DATASET_MAX_DIMS + 1),
+        (int[]){ 1, 1, 1, 1, 1 }, 1, &sample)
+    );
+    TEST_ASSERT_FALSE(dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 1, NULL, 1, &sample));
+    TEST_ASSERT_FALSE(
+        dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 1, (int[]){ 1 }, 1, NULL)
+    );
+}
+
+void test_convert_idx(void) {
+    // 3 images of 2x2 pixels
+    const uint8_t images[] = {
+        0x00, 0x00, 0x08, 0x03,
+        0x00, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x00, 0x02,
+        0x00, 0x00, 0x00, 0x02,
+        0, 51, 102, 255,
+        1, 2, 3, 4,
+        5, 6, 7, 8
+    };
+    write_bytes(idx_filename, images, sizeof(images));
+
+    Dataset dataset;
+
+    // Normalized to [0,1]
+    TEST_ASSERT_TRUE(dataset_convert_idx(idx_filename, dataset_filename, DATASET_TYPE_FLOAT32));
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_EQUAL_INT(3, dataset.num_samples);
+    TEST_ASSERT_EQUAL_INT(2, dataset.ndim);
+    TEST_ASSERT_EQUAL_INT_ARRAY(((int[]){ 2, 2 }), dataset.shape, 2);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
+        TEST_UTIL_FLOAT_ARRAY(0, 0.2, 0.4, 1), dataset_samples(&dataset, 0, 1), 4
+    );
+    dataset_close(&dataset);
+
+    // Raw bytes
+    TEST_ASSERT_TRUE(dataset_convert_idx(idx_filename, dataset_filename, DATASET_TYPE_UINT8));
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&images[16], dataset.data, 12);
+    dataset_close(&dataset);
+}
+
+void test_convert_idx_labels(void) {
+    const uint8_t labels[] = {
+        0x00, 0x00, 0x08, 0x01,
+        0x00, 0x00, 0x00, 0x04,
+        7, 2, 1, 0
+    };
+    write_bytes(idx_filename, labels, sizeof(labels));
+
+    Dataset dataset;
+    TEST_ASSERT_TRUE(dataset_convert_idx(idx_filename, dataset_filename, DATASET_TYPE_INT32));
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_EQUAL_INT(4, dataset.num_samples);
+    TEST_ASSERT_EQUAL_INT(0, dataset.ndim);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(((int32_t[]){ 7, 2, 1, 0 }), dataset.data, 4);
+    dataset_close(&dataset);
+}
+
+void test_convert_idx_fail_if_file_is_invalid(void) {
+    // Not unsigned bytes
+    const uint8_t floats[] = {
+        0x00, 0x00, 0x0D, 0x01,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x00
+    };
+    write_bytes(idx_filename, floats, sizeof(floats));
+    TEST_ASSERT_FALSE(dataset_convert_idx(idx_filename, dataset_filename, DATASET_TYPE_UINT8));
+
+    // Truncated samples, no dataset is left
+    const uint8_t truncated[] = {
+        0x00, 0x00, 0x08, 0x01,
+        0x00, 0x00, 0x00, 0x04,
+        7, 2
+    };
+    write_bytes(idx_filename, truncated, sizeof(truncated));
+    TEST_ASSERT_FALSE(dataset_convert_idx(idx_filename, dataset_filename, DATASET_TYPE_UINT8));
+    Dataset dataset;
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    TEST_ASSERT_FALSE(
+        dataset_convert_idx("/nonexistent/file", dataset_filename, DATASET_TYPE_UINT8)
+    );
+}
+
+void test_open_idx(void) {
+    // 3 images of 1x5 pixels
+    const uint8_t images[] = {
+        0x00, 0x00, 0x08, 0x03,
+        0x00, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x05,
+        0, 51, 102, 153, 204,
+        255, 1, 2, 3, 4,
+        5, 6, 7, 8, 9
+    };
+    write_bytes(idx_filename, images, sizeof(images));
+
+    Dataset dataset;
+    TEST_ASSERT_EQUAL_PTR(&dataset, dataset_open_idx(&dataset, idx_filename));
+    TEST_ASSERT_EQUAL_INT(DATASET_TYPE_UINT8, dataset.type);
+    TEST_ASSERT_EQUAL_INT(3, dataset.num_samples);
+    TEST_ASSERT_EQUAL_INT(5, dataset.sample_size);
+    TEST_ASSERT_EQUAL_INT(2, dataset.ndim);
+    TEST_ASSERT_EQUAL_INT_ARRAY(((int[]){ 1, 5 }), dataset.shape, 2);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&images[21], dataset_samples(&dataset, 1, 2), 10);
+    dataset_close(&dataset);
+
+    // Fewer samples than the header
+    write_bytes(idx_filename, images, (sizeof(images) - 1));
+    TEST_ASSERT_NULL(dataset_open_idx(&dataset, idx_filename));
+
+    // Not an IDX file
+    write_bytes(idx_filename, images, 6);
+    TEST_ASSERT_NULL(dataset_open_idx(&dataset, idx_filename));
+
+    TEST_ASSERT_NULL(dataset_open_idx(&dataset, "/nonexistent/file"));
+    TEST_ASSERT_NULL(dataset_open_idx(NULL, idx_filename));
+}
+
+void test_samples_float(void) {
+    // 2 samples of 19 bytes, not a multiple of vectors
+    uint8_t bytes[38];
+    float answer[38];
+    for (int i = 0; i < 38; i++) {
+        bytes[i] = (uint8_t)(i * 7);
+        answer[i] = (float)bytes[i] / 255;
+    }
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_UINT8, 1, (int[]){ 19 }, 2, bytes)
+    );
+
+    Dataset dataset;
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+
+    const KernelsIsa isas[] = { KERNELS_ISA_GENERIC, KERNELS_ISA_AVX2, KERNELS_ISA_AVX512 };
+    for (int i = 0; i < 3; i++) {
+        if (!kernels_select(isas[i])) {
+            continue;
+        }
+
+        float y[38];
+        TEST_ASSERT_TRUE(dataset_samples_float(&dataset, 0, 2, (1.0f / 255), y));
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-7, answer, y, 38);
+    }
+
+    float y[38];
+    TEST_ASSERT_FALSE(dataset_samples_float(&dataset, 1, 2, 1, y));
+    TEST_ASSERT_FALSE(dataset_samples_float(&dataset, 0, 1, 1, NULL));
+    dataset_close(&dataset);
+
+    // Floats and class indices are scaled as well
+    const int32_t labels[] = { 3, 1, 4 };
+    TEST_ASSERT_TRUE(dataset_write(dataset_filename, DATASET_TYPE_INT32, 0, NULL, 3, labels));
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_TRUE(dataset_samples_float(&dataset, 1, 2, 2, y));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(2, 8), y, 2);
+    dataset_close(&dataset);
+
+    const float values[] = { 0.5, -1 };
+    TEST_ASSERT_TRUE(dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 0, NULL, 2, values));
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+    TEST_ASSERT_TRUE(dataset_samples_float(&dataset, 0, 2, 4, y));
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(2, -4), y, 2);
+    dataset_close(&dataset);
+}
+
+void test_gather_float(void) {
+    // 8 samples of 100 bytes, rows span cache lines
+    uint8_t bytes[800];
+    for (int i = 0; i < 800; i++) {
+        bytes[i] = (uint8_t)(i / 100 * 10 + i % 7);
+    }
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_UINT8, 1, (int[]){ 100 }, 8, bytes)
+    );
+
+    Dataset dataset;
+    TEST_ASSERT_NOT_NULL(dataset_open(&dataset, dataset_filename));
+
+    const size_t indices[] = { 7, 0, 3, 3, 5, 1 };
+    float y[600];
+    TEST_ASSERT_TRUE(dataset_gather_float(&dataset, indices, 6, 0.5, y));
+    for (int i = 0; i < 6; i++) {
+        for (int j = 0; j < 100; j++) {
+            TEST_ASSERT_EQUAL_FLOAT(
+                (float)bytes[indices[i] * 100 + j] * 0.5f, y[i * 100 + j]
+            );
+        }
+    }
+
+    // An index out of range
+    TEST_ASSERT_FALSE(dataset_gather_float(&dataset, (size_t[]){ 1, 8 }, 2, 1, y));
+    TEST_ASSERT_FALSE(dataset_gather_float(&dataset, NULL, 1, 1, y));
+    dataset_close(&dataset);
+}
+
+void test_open_fail_if_file_is_invalid(void) {
+    Dataset dataset;
+
+    // Empty file
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    // Not a dataset
+    uint8_t bytes[128] = { 0 };
+    write_bytes(dataset_filename, bytes, sizeof(bytes));
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    // Fewer samples than the header
+    const float samples[] = { 0, 1, 2, 3 };
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_FLOAT32, 1, (int[]){ 2 }, 2, samples)
+    );
+    FILE *fp = fopen(dataset_filename, "r+b");
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fileno(fp), (64 + sizeof(float) * 3)));
+    fclose(fp);
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    TEST_ASSERT_NULL(dataset_open(&dataset, "/nonexistent/file"));
+    TEST_ASSERT_NULL(dataset_open(NULL, dataset_filename));
+}
+
+void test_open_fail_if_shape_overflows(void) {
+    Dataset dataset;
+
+    // Bytes of a sample are 2^64 + 4, which wrap around to the size of the samples
+    const uint8_t samples[] = { 0, 1, 2, 3 };
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_UINT8, 4, (int[]){ 1, 1, 1, 4 }, 1, samples)
+    );
+    TEST_ASSERT_EQUAL_PTR(&dataset, dataset_open(&dataset, dataset_filename));
+    dataset_close(&dataset);
+
+    overwrite_shape(dataset_filename, (uint32_t[]){ 34724, 27905, 49477, 384773 }, 4);
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    // A dimension out of int
+    TEST_ASSERT_TRUE(
+        dataset_write(dataset_filename, DATASET_TYPE_UINT8, 1, (int[]){ 1 }, 0, NULL)
+    );
+    overwrite_shape(dataset_filename, (uint32_t[]){ 0x80000000u }, 1);
+    TEST_ASSERT_NULL(dataset_open(&dataset, dataset_filename));
+
+    // The same shape of an IDX file
+    const uint8_t images[] = {
+        0x00, 0x00, 0x08, 0x05,
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x87, 0xA4,
+        0x00, 0x00, 0x6D, 0x01,
+        0x00, 0x00, 0xC1, 0x45,
+        0x00, 0x05, 0xDE, 0x05,
+        0, 1, 2, 3
+    };
+    write_bytes(idx_filename, images, sizeof(images));
+    TEST_ASSERT_NULL(dataset_open_idx(&dataset, idx_filename));
+}
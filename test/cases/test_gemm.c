@@ -0,0 +1,300 @@
+/**
+ * @file test_gemm.c
+ * @brief Unit tests of gemm.c
+ */
+#include "gemm.h"
+
+#include <stdlib.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Work memory of small multiplications
+#define WORK_SIZE 4096
+
+static float work[WORK_SIZE];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Fill a matrix with small integers to get exact results
+static void fill_matrix(float *matrix, const int size, const int seed) {
+    for (int i = 0; i < size; i++) {
+        matrix[i] = (float)(((i * 7 + seed) % 11) - 5);
+    }
+}
+
+void test_gemm_nn(void) {
+    float a[] = {
+        1, 2, 3,
+        -1, 0, 1
+    };
+
+    float b[] = {
+        1, 0, 1, 2,
+        0, 1, 1, -1,
+        0, 0, 1, 0
+    };
+
+    float c[2 * 4];
+
+    float answer[] = {
+        1, 2, 6, 0,
+        -1, 0, 0, -2
+    };
+
+    gemm_nn(2, 4, 3, a, 3, b, 4, 0, c, 4, work);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (2 * 4));
+}
+
+void test_gemm_nt(void) {
+    float a[] = {
+        1, 2, 3,
+        -1, 0, 1
+    };
+
+    float b[] = {
+        1, 0, 0,
+        0, 1, 0,
+        1, 1, 1,
+        2, -1, 0
+    };
+
+    float c[2 * 4];
+
+    float answer[] = {
+        1, 2, 6, 0,
+        -1, 0, 0, -2
+    };
+
+    gemm_nt(2, 4, 3, a, 3, b, 3, 0, c, 4, work);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (2 * 4));
+}
+
+void test_gemm_tn(void) {
+    float a[] = {
+        1, -1,
+        2, 0,
+        3, 1
+    };
+
+    float b[] = {
+        1, 0, 1, 2,
+        0, 1, 1, -1,
+        0, 0, 1, 0
+    };
+
+    float c[2 * 4];
+
+    float answer[] = {
+        1, 2, 6, 0,
+        -1, 0, 0, -2
+    };
+
+    gemm_tn(2, 4, 3, a, 2, b, 4, 0, c, 4, work);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (2 * 4));
+}
+
+void test_gemm_nt_accumulate(void) {
+    float a[] = { 1, 2 };
+    float b[] = { 3, 4 };
+    float c[] = { 1 };
+
+    gemm_nt(1, 1, 2, a, 2, b, 2, 1, c, 1, work);
+    TEST_ASSERT_EQUAL_FLOAT(12, c[0]);
+
+    gemm_nt(1, 1, 2, a, 2, b, 2, 0.5, c, 1, work);
+    TEST_ASSERT_EQUAL_FLOAT(17, c[0]);
+}
+
+// Activation to check the epilogue
+static void relu(float *y, const float *x, const int size, const MathPrecision precision) {
+    (void)precision;
+    for (int i = 0; i < size; i++) {
+        y[i] = (x[i] > 0) ? x[i] : 0;
+    }
+}
+
+// Check the epilogue by a naive multiplication
+static void check_gemm_nt_epilogue(const int m, const int n, const int k) {
+    float *a = malloc(sizeof(float) * m * k);
+    float *b = malloc(sizeof(float) * n * k);
+    float *bias = malloc(sizeof(float) * n);
+    float *c = malloc(sizeof(float) * m * n);
+    float *answer = malloc(sizeof(float) * m * n);
+    fill_matrix(a, (m * k), 1);
+    fill_matrix(b, (n * k), 2);
+    fill_matrix(bias, n, 3);
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            float acc = bias[j];
+            for (int p = 0; p < k; p++) {
+                acc += a[i * k + p] * b[j * k + p];
+            }
+            answer[i * n + j] = (acc > 0) ? acc : 0;
+        }
+    }
+
+    // Exactly the planned size, for any kernels
+    float *work_mk = malloc(sizeof(float) * gemm_work_size(m, n, k));
+
+    const GemmEpilogue epilogue = { .bias = bias, .activation = relu };
+    gemm_nt_epilogue(m, n, k, a, k, b, k, c, n, &epilogue, work_mk);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (m * n));
+
+    free(work_mk);
+    free(a);
+    free(b);
+    free(bias);
+    free(c);
+    free(answer);
+}
+
+void test_gemm_nt_epilogue(void) {
+    float a[] = {
+        1, 2, 3,
+        -1, 0, 1
+    };
+
+    float b[] = {
+        1, 0, 0,
+        0, 1, 0,
+        1, 1, 1,
+        2, -1, 0
+    };
+
+    float bias[] = { 1, -3, 0, 1 };
+
+    float c[2 * 4];
+
+    float answer[] = {
+        2, 0, 6, 1,
+        0, 0, 0, 0
+    };
+
+    const GemmEpilogue epilogue = { .bias = bias, .activation = relu };
+    gemm_nt_epilogue(2, 4, 3, a, 3, b, 3, c, 4, &epilogue, work);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (2 * 4));
+}
+
+void test_gemm_nt_epilogue_over_blocks(void) {
+    // Applied once after all blocks of depth, to edge tiles too
+    check_gemm_nt_epilogue(13, 37, 300);
+    check_gemm_nt_epilogue(100, 70, 33);
+}
+
+// Check all variants of GEMM by a naive multiplication
+static void check_gemm(const int m, const int n, const int k) {
+    float *a = malloc(sizeof(float) * m * k);
+    float *b = malloc(sizeof(float) * n * k);
+    float *c = malloc(sizeof(float) * m * n);
+    float *answer = malloc(sizeof(float) * m * n);
+
+    fill_matrix(a, (m * k), 1);
+    fill_matrix(b, (n * k), 2);
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            float mac = 0;
+            for (int p = 0; p < k; p++) {
+                mac += a[i * k + p] * b[j * k + p];
+            }
+            answer[i * n + j] = mac;
+        }
+    }
+
+    // Exactly the planned size, for any kernels
+    float *work_mk = malloc(sizeof(float) * gemm_work_size(m, n, k));
+
+    gemm_nt(m, n, k, a, k, b, k, 0, c, n, work_mk);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (m * n));
+
+    // Same products with transposed copies of the operands
+    float *at = malloc(sizeof(float) * k * m);
+    float *bt = malloc(sizeof(float) * k * n);
+    for (int p = 0; p < k; p++) {
+        for (int i = 0; i < m; i++) {
+            at[p * m + i] = a[i * k + p];
+        }
+        for (int j = 0; j < n; j++) {
+            bt[p * n + j] = b[j * k + p];
+        }
+    }
+
+    gemm_nn(m, n, k, a, k, bt, n, 0, c, n, work_mk);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (m * n));
+
+    gemm_tn(m, n, k, at, m, bt, n, 0, c, n, work_mk);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, c, (m * n));
+
+    free(at);
+    free(bt);
+    free(work_mk);
+
+    free(a);
+    free(b);
+    free(c);
+    free(answer);
+}
+
+void test_gemm_over_blocks(void) {
+    const KernelsIsa isas[] = {
+        KERNELS_ISA_GENERIC, KERNELS_ISA_AVX2, KERNELS_ISA_AVX512
+    };
+
+    for (int i = 0; i < 3; i++) {
+        // Skip kernels not supported by the CPU
+        if (!kernels_select(isas[i])) {
+            continue;
+        }
+
+        // Not a multiple of any tile size, and deeper than a block
+        check_gemm(77, 21, 300);
+        // Fewer rows than a tile
+        check_gemm(3, 37, 300);
+    }
+
+    kernels_init();
+}
+
+void test_gemm_multithreaded(void) {
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(3));
+
+    check_gemm(77, 21, 300);
+    check_gemm(3, 37, 300);
+
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(1));
+}
+
+void test_work_size(void) {
+    TEST_ASSERT_EQUAL_INT(0, gemm_work_size(0, 21, 300));
+    TEST_ASSERT_EQUAL_INT(0, gemm_work_size(77, 21, 0));
+
+    // Packed blocks of A and B, padded to tiles of any kernels
+    const int mc = 3 + KERNELS_MAX_GEMM_MR - 1;
+    const int nc = 37 + KERNELS_MAX_GEMM_NR - 1;
+    TEST_ASSERT_EQUAL_INT(((mc + nc) * 5), gemm_work_size(3, 37, 5));
+
+    // Tiles of each kernels fit
+    const KernelsIsa isas[] = {
+        KERNELS_ISA_GENERIC, KERNELS_ISA_AVX2, KERNELS_ISA_AVX512
+    };
+    for (int i = 0; i < 3; i++) {
+        if (!kernels_select(isas[i])) {
+            continue;
+        }
+        const Kernels *ks = kernels();
+        TEST_ASSERT_TRUE(ks->gemm_mr <= KERNELS_MAX_GEMM_MR);
+        TEST_ASSERT_TRUE(ks->gemm_nr <= KERNELS_MAX_GEMM_NR);
+    }
+
+    kernels_init();
+}
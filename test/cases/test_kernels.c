@@ -0,0 +1,313 @@
+/**
+ * @file test_kernels.c
+ * @brief Unit tests of kernels.c
+ */
+#include "kernels.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Kernels to be compared with the generic ones
+static const KernelsIsa simd_isas[] = { KERNELS_ISA_AVX2, KERNELS_ISA_AVX512 };
+
+#define NUM_SIMD_ISAS 2
+
+// Not a multiple of any vector width
+#define SIZE 37
+
+void setUp(void) {}
+
+void tearDown(void) {
+    kernels_init();
+}
+
+// Number of inputs swept for errors of math kernels
+#define SWEEP_SIZE 100001
+
+// Error of a float in ULP of the reference value
+static double ulp_error(const float y, const double answer) {
+    const float rounded = fabsf((float)answer);
+    const double ulp = (double)nextafterf(rounded, INFINITY) - rounded;
+    return fabs((double)y - answer) / ulp;
+}
+
+// Max. error in ULP of an elementwise kernel over inputs in [low, high]
+static double max_ulp_error(
+    void (*kernel)(float*, const float*, const int), double (*answer)(double),
+    const float low, const float high
+) {
+    float *x = malloc(sizeof(float) * SWEEP_SIZE);
+    float *y = malloc(sizeof(float) * SWEEP_SIZE);
+    for (int i = 0; i < SWEEP_SIZE; i++) {
+        x[i] = low + (high - low) * ((float)i / (SWEEP_SIZE - 1));
+    }
+
+    kernel(y, x, SWEEP_SIZE);
+
+    double max_error = 0;
+    for (int i = 0; i < SWEEP_SIZE; i++) {
+        const double error = ulp_error(y[i], answer((double)x[i]));
+        max_error = (error > max_error) ? error : max_error;
+    }
+
+    free(x);
+    free(y);
+
+    return max_error;
+}
+
+// Sigmoid in double precision
+static double sigmoid(const double x) {
+    return 1 / (1 + exp(-x));
+}
+
+// Fill a vector with values in [-8, 8)
+static void fill_vector(float *vector, const int size) {
+    for (int i = 0; i < size; i++) {
+        vector[i] = (float)((i * 37) % 64) / 4 - 8;
+    }
+}
+
+void test_select_generic(void) {
+    TEST_ASSERT_TRUE(kernels_select(KERNELS_ISA_GENERIC));
+    TEST_ASSERT_EQUAL_PTR(generic_kernels(), kernels());
+    TEST_ASSERT_EQUAL_INT(KERNELS_ISA_GENERIC, kernels()->isa);
+}
+
+void test_select_by_cpu_features(void) {
+    const CpuFeatures *features = cpu_features();
+
+    TEST_ASSERT_EQUAL(
+        (features->avx2 && features->fma), kernels_select(KERNELS_ISA_AVX2)
+    );
+    TEST_ASSERT_EQUAL(features->avx512f, kernels_select(KERNELS_ISA_AVX512));
+}
+
+void test_init_selects_best_kernels(void) {
+    const CpuFeatures *features = cpu_features();
+
+    kernels_init();
+
+    KernelsIsa isa = KERNELS_ISA_GENERIC;
+    if (features->avx512f) {
+        isa = KERNELS_ISA_AVX512;
+    } else if (features->avx2 && features->fma) {
+        isa = KERNELS_ISA_AVX2;
+    }
+
+    TEST_ASSERT_EQUAL_INT(isa, kernels()->isa);
+}
+
+void test_softmax_grad(void) {
+    const float y[] = { 0.5, 0.25, 0.25 };
+    const float gy[] = { 1, -1, 2 };
+    float gx[3];
+
+    // dot(gy, y) = 0.75
+    generic_kernels()->softmax_grad(gx, y, gy, 3);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.125, -0.4375, 0.3125), gx, 3);
+}
+
+void test_exp_log(void) {
+    const Kernels *generic = generic_kernels();
+
+    float x[SIZE];
+    fill_vector(x, SIZE);
+
+    float y[SIZE];
+    generic->exp(y, x, SIZE);
+    for (int i = 0; i < SIZE; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(expf(x[i]) * 1e-6f, expf(x[i]), y[i]);
+    }
+
+    // Positive inputs from 2^-8 to 2^8
+    for (int i = 0; i < SIZE; i++) {
+        x[i] = exp2f(x[i]);
+    }
+    generic->log(y, x, SIZE);
+    for (int i = 0; i < SIZE; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-6, logf(x[i]), y[i]);
+    }
+}
+
+void test_log_special_cases(void) {
+    const float x[] = { 0, -1, INFINITY };
+    float y[3];
+
+    generic_kernels()->log(y, x, 3);
+    TEST_ASSERT_FLOAT_IS_NEG_INF(y[0]);
+    TEST_ASSERT_FLOAT_IS_NAN(y[1]);
+    TEST_ASSERT_FLOAT_IS_INF(y[2]);
+}
+
+void test_simd_kernels_match_generic(void) {
+    const Kernels *generic = generic_kernels();
+
+    float x[SIZE];
+    float w[SIZE];
+    fill_vector(x, SIZE);
+    fill_vector(w, SIZE);
+    w[0] = 1;
+
+    float answer[SIZE];
+    float y[SIZE];
+
+    for (int i = 0; i < NUM_SIMD_ISAS; i++) {
+        if (!kernels_select(simd_isas[i])) {
+            continue;
+        }
+        const Kernels *simd = kernels();
+
+        TEST_ASSERT_FLOAT_WITHIN(
+            1e-3, generic->dot(x, w, SIZE), simd->dot(x, w, SIZE)
+        );
+
+        generic->exp(answer, x, SIZE);
+        simd->exp(y, x, SIZE);
+        for (int j = 0; j < SIZE; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(answer[j] * 1e-6f, answer[j], y[j]);
+        }
+
+        // Positive inputs of log
+        float px[SIZE];
+        for (int j = 0; j < SIZE; j++) {
+            px[j] = exp2f(x[j]);
+        }
+        generic->log(answer, px, SIZE);
+        simd->log(y, px, SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, answer, y, SIZE);
+
+        generic->sigmoid(answer, x, SIZE);
+        simd->sigmoid(y, x, SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, answer, y, SIZE);
+
+        generic->softmax(answer, x, SIZE);
+        simd->softmax(y, x, SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, answer, y, SIZE);
+
+        // Gradient through the softmax of x
+        float gx[SIZE];
+        generic->softmax(y, x, SIZE);
+        generic->softmax_grad(answer, y, w, SIZE);
+        simd->softmax_grad(gx, y, w, SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, answer, gx, SIZE);
+
+        fill_vector(answer, SIZE);
+        fill_vector(y, SIZE);
+        generic->add_bias(answer, w, 1, SIZE);
+        simd->add_bias(y, w, 1, SIZE);
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, y, SIZE);
+
+        uint8_t bytes[SIZE];
+        for (int j = 0; j < SIZE; j++) {
+            bytes[j] = (uint8_t)(j * 7);
+        }
+        generic->u8_to_float(answer, bytes, SIZE, (1.0f / 255));
+        simd->u8_to_float(y, bytes, SIZE, (1.0f / 255));
+        TEST_ASSERT_EQUAL_FLOAT_ARRAY(answer, y, SIZE);
+    }
+}
+
+void test_math_kernels_within_documented_ulp(void) {
+    const KernelsIsa isas[] = { KERNELS_ISA_GENERIC, KERNELS_ISA_AVX2, KERNELS_ISA_AVX512 };
+
+    for (int i = 0; i < (int)(sizeof(isas) / sizeof(isas[0])); i++) {
+        if (!kernels_select(isas[i])) {
+            continue;
+        }
+
+        const Kernels *ks = kernels();
+        TEST_ASSERT_TRUE(max_ulp_error(ks->exp, exp, -87, 88) <= 2);
+        TEST_ASSERT_TRUE(max_ulp_error(ks->log, log, 1e-45f, 1e-38f) <= 1);
+        TEST_ASSERT_TRUE(max_ulp_error(ks->log, log, 1e-37f, 1e-30f) <= 1);
+        TEST_ASSERT_TRUE(max_ulp_error(ks->log, log, 1e-3f, 10) <= 1);
+        TEST_ASSERT_TRUE(max_ulp_error(ks->log, log, 10, 3e38f) <= 1);
+        TEST_ASSERT_TRUE(max_ulp_error(ks->sigmoid, sigmoid, -80, 80) <= 4);
+    }
+}
+
+void test_simd_exp_clamped_as_generic(void) {
+    const Kernels *generic = generic_kernels();
+
+    // Out of [-87, 88], clamped into the same range by all kernels
+    const float x[] = { -100, -87, 88, 100 };
+    float answer[4];
+    float y[4];
+    generic->exp(answer, x, 4);
+    TEST_ASSERT_EQUAL_FLOAT(answer[1], answer[0]);
+    TEST_ASSERT_EQUAL_FLOAT(answer[2], answer[3]);
+
+    for (int i = 0; i < NUM_SIMD_ISAS; i++) {
+        if (!kernels_select(simd_isas[i])) {
+            continue;
+        }
+
+        kernels()->exp(y, x, 4);
+        for (int j = 0; j < 4; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(answer[j] * 1e-6f, answer[j], y[j]);
+        }
+    }
+}
+
+void test_simd_optimizers_match_generic(void) {
+    const Kernels *generic = generic_kernels();
+
+    float g[SIZE];
+    fill_vector(g, SIZE);
+
+    const AdamCoeffs coeffs = {
+        .learning_rate = 0.1, .beta1 = 0.9, .beta2 = 0.999, .eps = 1e-8,
+        .weight_decay = 0.01, .bias1 = 10, .bias2 = 31.6
+    };
+
+    for (int i = 0; i < NUM_SIMD_ISAS; i++) {
+        if (!kernels_select(simd_isas[i])) {
+            continue;
+        }
+        const Kernels *simd = kernels();
+
+        // Parameters and states of the generic and SIMD kernels
+        float w[2][SIZE];
+        float m[2][SIZE];
+        float v[2][SIZE];
+        for (int j = 0; j < 2; j++) {
+            fill_vector(w[j], SIZE);
+            fill_vector(m[j], SIZE);
+            fill_vector(v[j], SIZE);
+            for (int k = 0; k < SIZE; k++) {
+                v[j][k] = fabsf(v[j][k]);
+            }
+        }
+
+        generic->sgd(w[0], g, SIZE, 0.1);
+        simd->sgd(w[1], g, SIZE, 0.1);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, w[0], w[1], SIZE);
+
+        for (int nesterov = 0; nesterov < 2; nesterov++) {
+            generic->momentum(w[0], m[0], g, SIZE, 0.1, 0.9, nesterov);
+            simd->momentum(w[1], m[1], g, SIZE, 0.1, 0.9, nesterov);
+            TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, w[0], w[1], SIZE);
+            TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, m[0], m[1], SIZE);
+        }
+
+        generic->adam(w[0], m[0], v[0], g, SIZE, &coeffs);
+        simd->adam(w[1], m[1], v[1], g, SIZE, &coeffs);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, w[0], w[1], SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, m[0], m[1], SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, v[0], v[1], SIZE);
+
+        // Without the 1st moment
+        generic->adam(w[0], NULL, v[0], g, SIZE, &coeffs);
+        simd->adam(w[1], NULL, v[1], g, SIZE, &coeffs);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, w[0], w[1], SIZE);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-5, v[0], v[1], SIZE);
+    }
+}
@@ -4,7 +4,7 @@
  */
 #include "layer.h"
 
-#include <stdlib.h>
+#include <stddef.h>
 
 #include "unity.h"
 #include "test_utils.h"
@@ -28,12 +28,15 @@ static float *dummy_backward(Layer *layer, const float *gy) {
 }
 
 static Layer *dummy_init(Layer *layer) {
-    layer->x = malloc(sizeof(float) * layer->params.batch_size * layer->params.in);
-    layer->y = malloc(sizeof(float) * layer->params.batch_size * layer->params.out);
-    layer->gx = malloc(sizeof(float) * layer->params.batch_size * layer->params.in);
+    layer->sizes = (LayerSizes){
+        .y = layer->params.batch_size * layer->params.out,
+        .gx = layer->params.batch_size * layer->params.in
+    };
 
     layer->forward = dummy_forward;
     layer->backward = dummy_backward;
+
+    return layer;
 }
 
 Layer* (*layer_init_funcs[])(Layer*) = {
@@ -45,57 +48,41 @@ void setUp(void) {}
 
 void tearDown(void) {}
 
-void test_allocate_and_free(void) {
+void test_init(void) {
     Layer layer = {
-        .params={ LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=2 }
+        .params={ LAYER_TYPE_DUMMY, .batch_size=2, .in=3, .out=4 }
     };
 
-    TEST_ASSERT_EQUAL_PTR(&layer, layer_alloc_params(&layer));
-    TEST_ASSERT_NOT_NULL(layer.x);
-    TEST_ASSERT_NOT_NULL(layer.y);
-    TEST_ASSERT_NULL(layer.w);
-    TEST_ASSERT_NULL(layer.b);
-    TEST_ASSERT_NOT_NULL(layer.gx);
-    TEST_ASSERT_NULL(layer.gw);
-    TEST_ASSERT_NULL(layer.gb);
+    TEST_ASSERT_EQUAL_PTR(&layer, layer_init(&layer));
+    TEST_ASSERT_EQUAL_INT((2 * 4), layer.sizes.y);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.w);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.b);
+    TEST_ASSERT_EQUAL_INT((2 * 3), layer.sizes.gx);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gw);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gb);
     TEST_ASSERT_EQUAL_PTR(dummy_forward, layer.forward);
     TEST_ASSERT_EQUAL_PTR(dummy_backward, layer.backward);
 
-    layer_free_params(&layer);
+    // Buffers are assigned by a network
     TEST_ASSERT_NULL(layer.x);
     TEST_ASSERT_NULL(layer.y);
-    TEST_ASSERT_NULL(layer.w);
-    TEST_ASSERT_NULL(layer.b);
     TEST_ASSERT_NULL(layer.gx);
-    TEST_ASSERT_NULL(layer.gw);
-    TEST_ASSERT_NULL(layer.gb);
-    TEST_ASSERT_NULL(layer.forward);
-    TEST_ASSERT_NULL(layer.backward);
 }
 
-void test_allocation_fail_if_layer_is_NULL(void) {
-    TEST_ASSERT_NULL(layer_alloc_params(NULL));
+void test_init_fail_if_layer_is_NULL(void) {
+    TEST_ASSERT_NULL(layer_init(NULL));
 }
 
-void test_allocation_fail_if_layer_type_is_not_specified(void) {
+void test_init_fail_if_layer_type_is_not_specified(void) {
     Layer layer = { .params={ .batch_size=1, .in=2, .out=2 } };
 
-    TEST_ASSERT_NULL(layer_alloc_params(&layer));
-    TEST_ASSERT_NULL(layer.x);
-    TEST_ASSERT_NULL(layer.y);
-    TEST_ASSERT_NULL(layer.w);
-    TEST_ASSERT_NULL(layer.b);
-    TEST_ASSERT_NULL(layer.gx);
-    TEST_ASSERT_NULL(layer.gw);
-    TEST_ASSERT_NULL(layer.gb);
+    TEST_ASSERT_NULL(layer_init(&layer));
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.y);
+    TEST_ASSERT_EQUAL_INT(0, layer.sizes.gx);
     TEST_ASSERT_NULL(layer.forward);
     TEST_ASSERT_NULL(layer.backward);
 }
 
-void test_free_to_NULL(void) {
-    layer_free_params(NULL);
-}
-
 void test_connect(void) {
     Layer layer = { .params={ .batch_size=8, .in=2, .out=10 } };
     Layer next_layer = { .params={ .out=3 } };
@@ -171,30 +158,3 @@ void test_backward_fail_if_dy_is_NULL(void) {
 
     TEST_ASSERT_NULL(layer_backward(&layer, NULL));
 }
-
-void test_clear_grad(void) {
-    Layer layers[] = {
-        {
-            .params = { .batch_size=4, .in=2, .out=3 },
-            .gx = TEST_UTIL_FLOAT_ARRAY(-1, 1, -2, 2, -3, 3, -4, 4),
-            .gw = TEST_UTIL_FLOAT_ARRAY(1, 2, 3, 4, 5, 6),
-            .gb = TEST_UTIL_FLOAT_ARRAY(-1, -2, -3),
-        },
-        { .params = { .batch_size=4, .in=3, .out=1 } }
-    };
-
-    layer_clear_grad(&layers[0]);
-
-    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
-        TEST_UTIL_FLOAT_ZEROS(2), layers[0].gx, 2
-    );
-    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
-        TEST_UTIL_FLOAT_ZEROS(3 * 2), layers[0].gw, (3 * 2)
-    );
-    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
-        TEST_UTIL_FLOAT_ZEROS(3), layers[0].gb, 3
-    );
-
-    // Skip unallocated grads
-    layer_clear_grad(&layers[1]);
-}
@@ -4,14 +4,54 @@
  */
 #include "net.h"
 
+#include <stdint.h>
+
 #include "mock_layer.h"
 #include "mock_random.h"
+#include "mock_thread_pool.h"
 #include "unity.h"
 #include "test_utils.h"
 
 // Dummy layer type
 #define LAYER_TYPE_DUMMY 1
 
+// Set sizes of buffers like a FC layer, without the layer type
+static Layer *dummy_init(Layer *layer, int cmock_num_calls) {
+    (void)cmock_num_calls;
+
+    LayerParams *params = &layer->params;
+    layer->sizes = (LayerSizes){
+        .y = params->batch_size * params->out,
+        .w = params->in * params->out,
+        .b = params->out,
+        .gx = params->batch_size * params->in,
+        .gw = params->in * params->out,
+        .gb = params->out,
+        .forward_scratch = params->in,
+        .backward_scratch = params->out
+    };
+
+    return layer;
+}
+
+// Absorb the next layer, which passes its input through
+static bool dummy_fuse(Layer *layer, Layer *next) {
+    layer->sizes.gz = layer->sizes.y;
+    next->sizes = (LayerSizes){ 0 };
+
+    return true;
+}
+
+// Set sizes like dummy_init, the first layer fuses the next one
+static Layer *fusing_init(Layer *layer, int cmock_num_calls) {
+    dummy_init(layer, cmock_num_calls);
+    if (cmock_num_calls == 0) {
+        layer->fuse = dummy_fuse;
+    }
+
+    return layer;
+}
+
 void setUp(void) {}
 
 void tearDown(void) {}
@@ -19,10 +59,10 @@ void tearDown(void) {}
 void test_allocate_and_free_layer(void) {
     Net net;
 
-    // Function `layer_alloc` call isn't fully tested
+    // Function `layer_init` call isn't fully tested
     // arguments are not verified because of using malloc internally
     Layer dummy_layer;
-    layer_alloc_params_ExpectAnyArgsAndReturn(&dummy_layer);
+    layer_init_ExpectAnyArgsAndReturn(&dummy_layer);
     LayerParams params = {
         .type=LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=2
     };
@@ -47,9 +87,6 @@ void test_allocate_and_free_layer(void) {
 
     TEST_ASSERT_EQUAL_MEMORY(&params, &layer->params, sizeof(LayerParams));
 
-    // Same with `layer_alloc_params`,
-    // `layer_free_params` is not fully tested
-    layer_free_params_ExpectAnyArgs();
     net_free_layers(&net);
     TEST_ASSERT_NULL(net.layers);
 }
@@ -65,11 +102,11 @@ void test_allocate_and_free_3layers(void) {
     };
 
     Layer dummy_layer;
-    layer_alloc_params_ExpectAnyArgsAndReturn(&dummy_layer);
+    layer_init_ExpectAnyArgsAndReturn(&dummy_layer);
     layer_connect_ExpectAnyArgsAndReturn(true);
-    layer_alloc_params_ExpectAnyArgsAndReturn(&dummy_layer);
+    layer_init_ExpectAnyArgsAndReturn(&dummy_layer);
     layer_connect_ExpectAnyArgsAndReturn(true);
-    layer_alloc_params_ExpectAnyArgsAndReturn(&dummy_layer);
+    layer_init_ExpectAnyArgsAndReturn(&dummy_layer);
     TEST_ASSERT_EQUAL_PTR(&net, net_alloc_layers(&net, layer_params));
 
     TEST_ASSERT_EQUAL_INT(3, net_size(&net));
@@ -84,9 +121,6 @@ void test_allocate_and_free_3layers(void) {
         );
     }
 
-    layer_free_params_ExpectAnyArgs();
-    layer_free_params_ExpectAnyArgs();
-    layer_free_params_ExpectAnyArgs();
     net_free_layers(&net);
     TEST_ASSERT_NULL(net.layers);
 }
@@ -123,6 +157,38 @@ void test_free_layers_when_layers_are_NULL(void) {
     net_free_layers(&net);
 }
 
+// Run a parallel loop on the calling thread
+static void serial_parallel_for(
+    const int size, const int grain, ThreadPoolTask task, void *arg, int num_calls
+) {
+    (void)grain;
+    (void)num_calls;
+    task(arg, 0, size);
+}
+
+// Arguments of calls of rand_fill_norm
+static int fill_norm_calls;
+static size_t fill_norm_sizes[2];
+static float fill_norm_stddevs[2];
+
+// Record arguments and fill ones
+static void fake_fill_norm(
+    RandomState *state, float *y, const size_t size, const float mean, const float stddev,
+    int num_calls
+) {
+    (void)state;
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_FLOAT(0, mean);
+    TEST_ASSERT_TRUE(fill_norm_calls < 2);
+    fill_norm_sizes[fill_norm_calls] = size;
+    fill_norm_stddevs[fill_norm_calls] = stddev;
+    fill_norm_calls++;
+
+    for (size_t i = 0; i < size; i++) {
+        y[i] = 1;
+    }
+}
+
 void test_init(void) {
     Net net = {
         .size = 3,
@@ -141,14 +207,19 @@ void test_init(void) {
         }
     };
 
-    for (int i = 0; i < (3 * 2); i++) {
-        rand_norm_ExpectAndReturn(0, (1 / sqrtf(2)), 1);
-    }
-    for (int i = 0; i < 3; i++) {
-        rand_norm_ExpectAndReturn(0, (1 / sqrtf(3)), 1);
-    }
+    rand_seed_Ignore();
+    rand_fill_norm_StubWithCallback(fake_fill_norm);
+    thread_pool_parallel_for_StubWithCallback(serial_parallel_for);
+    fill_norm_calls = 0;
+
+    net_init_params(&net, 1);
 
-    net_init_params(&net);
+    // Confirm weights of each layer are drawn with its std. dev.
+    TEST_ASSERT_EQUAL_INT(2, fill_norm_calls);
+    TEST_ASSERT_EQUAL_INT((3 * 2), fill_norm_sizes[0]);
+    TEST_ASSERT_EQUAL_FLOAT((1 / sqrtf(2)), fill_norm_stddevs[0]);
+    TEST_ASSERT_EQUAL_INT(3, fill_norm_sizes[1]);
+    TEST_ASSERT_EQUAL_FLOAT((1 / sqrtf(3)), fill_norm_stddevs[1]);
 
     // Confirm values are set
     TEST_ASSERT_EQUAL_FLOAT_ARRAY(
@@ -167,7 +238,7 @@ void test_forward_layer(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -182,7 +253,6 @@ void test_forward_layer(void) {
     );
     TEST_ASSERT_EQUAL_PTR(&dummy_y, net_forward(&net, &dummy_x));
 
-    layer_free_params_Ignore();
     net_free_layers(&net);
 }
 
@@ -191,7 +261,7 @@ void test_forward_3layers(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -214,7 +284,6 @@ void test_forward_3layers(void) {
     );
     TEST_ASSERT_EQUAL_PTR(&dummy_y[2], net_forward(&net, &dummy_x));
 
-    layer_free_params_Ignore();
     net_free_layers(&net);
 }
 
@@ -228,7 +297,7 @@ void test_forward_fail_if_x_is_NULL(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -239,7 +308,58 @@ void test_forward_fail_if_x_is_NULL(void) {
 
     TEST_ASSERT_NULL(net_forward(&net, NULL));
 
-    layer_free_params_Ignore();
+    net_free_layers(&net);
+}
+
+void test_forward_batch(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    Layer dummy_layer;
+    layer_init_IgnoreAndReturn(&dummy_layer);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=8, .in=2, .out=2 },
+            { LAYER_TYPE_DUMMY },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    float dummy_x, dummy_y[2];
+    layer_forward_ExpectAndReturn(
+        &net_layers(&net)[0], &dummy_x, &dummy_y[0]
+    );
+    layer_forward_ExpectAndReturn(
+        &net_layers(&net)[1], &dummy_y[0], &dummy_y[1]
+    );
+    TEST_ASSERT_EQUAL_PTR(&dummy_y[1], net_forward_batch(&net, &dummy_x, 3));
+
+    // All layers run for the samples
+    TEST_ASSERT_EQUAL_INT(3, net_layers(&net)[0].batch);
+    TEST_ASSERT_EQUAL_INT(3, net_layers(&net)[1].batch);
+
+    net_free_layers(&net);
+}
+
+void test_forward_batch_fail_if_n_is_out_of_range(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    Layer dummy_layer;
+    layer_init_IgnoreAndReturn(&dummy_layer);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=8, .in=2, .out=2 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    float dummy_x;
+    TEST_ASSERT_NULL(net_forward_batch(&net, &dummy_x, 0));
+    TEST_ASSERT_NULL(net_forward_batch(&net, &dummy_x, 9));
+
     net_free_layers(&net);
 }
 
@@ -248,7 +368,7 @@ void test_backward_layer(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -263,7 +383,6 @@ void test_backward_layer(void) {
     );
     TEST_ASSERT_EQUAL_PTR(&dummy_gx, net_backward(&net, &dummy_gy));
 
-    layer_free_params_Ignore();
     net_free_layers(&net);
 }
 
@@ -272,7 +391,7 @@ void test_backward_3layer(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -295,7 +414,41 @@ void test_backward_3layer(void) {
     );
     TEST_ASSERT_EQUAL_PTR(&dummy_gx[0], net_backward(&net, &dummy_gy));
 
-    layer_free_params_Ignore();
+    net_free_layers(&net);
+}
+
+void test_backward_accumulate(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    Layer dummy_layer;
+    layer_init_IgnoreAndReturn(&dummy_layer);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=2 },
+            { LAYER_TYPE_DUMMY },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    float dummy_gy, dummy_gx[2];
+    Layer *layers = net_layers(&net);
+
+    // Layers add gradients of parameters
+    layer_backward_ExpectAndReturn(&layers[1], &dummy_gy, &dummy_gx[1]);
+    layer_backward_ExpectAndReturn(&layers[0], &dummy_gx[1], &dummy_gx[0]);
+    TEST_ASSERT_EQUAL_PTR(&dummy_gx[0], net_backward_accumulate(&net, &dummy_gy));
+    TEST_ASSERT_TRUE(layers[0].accumulate);
+    TEST_ASSERT_TRUE(layers[1].accumulate);
+
+    // Layers overwrite them again
+    layer_backward_ExpectAndReturn(&layers[1], &dummy_gy, &dummy_gx[1]);
+    layer_backward_ExpectAndReturn(&layers[0], &dummy_gx[1], &dummy_gx[0]);
+    TEST_ASSERT_EQUAL_PTR(&dummy_gx[0], net_backward(&net, &dummy_gy));
+    TEST_ASSERT_FALSE(layers[0].accumulate);
+    TEST_ASSERT_FALSE(layers[1].accumulate);
+
     net_free_layers(&net);
 }
 
@@ -309,7 +462,7 @@ void test_backward_fail_if_dy_is_NULL(void) {
 
     layer_connect_IgnoreAndReturn(true);
     Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_IgnoreAndReturn(&dummy_layer);
     net_alloc_layers(
         &net,
         (LayerParams[]){
@@ -320,31 +473,460 @@ void test_backward_fail_if_dy_is_NULL(void) {
 
     TEST_ASSERT_NULL(net_backward(&net, NULL));
 
-    layer_free_params_Ignore();
     net_free_layers(&net);
 }
 
+void test_arena(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    TEST_ASSERT_EQUAL_PTR(
+        &net,
+        net_alloc_layers(
+            &net,
+            (LayerParams[]){
+                { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+                { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+                { LAYER_TYPE_NONE }
+            }
+        )
+    );
+
+    // Buffers are aligned to 64 bytes, 16 elements
+    TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)net.arena % 64));
+    TEST_ASSERT_EQUAL_INT((16 * 4), net.num_params);
+    TEST_ASSERT_EQUAL_INT((16 * 7), net.num_grads);
+    TEST_ASSERT_EQUAL_INT(16, net.num_scratch);
+    TEST_ASSERT_EQUAL_INT((16 * 14), net.arena_size);
+
+    // Parameters and their gradients are flat vectors in the same layout
+    Layer *layers = net_layers(&net);
+    TEST_ASSERT_EQUAL_PTR(net.arena, net_params(&net));
+    TEST_ASSERT_EQUAL_PTR(&net.arena[16 * 4], net_grads(&net));
+    TEST_ASSERT_EQUAL_INT((16 * 4), net_num_params(&net));
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_PTR(&net_params(&net)[16 * (2 * i)], layers[i].w);
+        TEST_ASSERT_EQUAL_PTR(&net_params(&net)[16 * (2 * i + 1)], layers[i].b);
+        TEST_ASSERT_EQUAL_PTR(&net_grads(&net)[16 * (2 * i)], layers[i].gw);
+        TEST_ASSERT_EQUAL_PTR(&net_grads(&net)[16 * (2 * i + 1)], layers[i].gb);
+        TEST_ASSERT_EQUAL_PTR(&net_grads(&net)[16 * (4 + i)], layers[i].gx);
+        TEST_ASSERT_EQUAL_PTR(&net.arena[16 * (11 + i)], layers[i].y);
+
+        // Layers share the work region at the end
+        TEST_ASSERT_EQUAL_PTR(&net.arena[16 * 13], layers[i].scratch);
+
+        // Inputs are borrowed in forward
+        TEST_ASSERT_NULL(layers[i].x);
+    }
+
+    // The gradient of the output for a trainer follows gradients of inputs
+    TEST_ASSERT_EQUAL_PTR(&net_grads(&net)[16 * 6], net.output_grad);
+
+    // Buffers are cleared
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(
+        TEST_UTIL_FLOAT_ZEROS(16 * 14), net.arena, (16 * 14)
+    );
+
+    net_free_layers(&net);
+    TEST_ASSERT_NULL(net.layers);
+    TEST_ASSERT_NULL(net.arena);
+}
+
+void test_allocate_inference(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    TEST_ASSERT_EQUAL_PTR(
+        &net,
+        net_alloc_inference(
+            &net,
+            (LayerParams[]){
+                { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+                { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+                { LAYER_TYPE_NONE }
+            }
+        )
+    );
+
+    // Only parameters, outputs and the work region are allocated
+    TEST_ASSERT_EQUAL_INT((16 * 4), net.num_params);
+    TEST_ASSERT_EQUAL_INT(0, net.num_grads);
+    TEST_ASSERT_EQUAL_INT((16 * 7), net.arena_size);
+    TEST_ASSERT_NULL(net_grads(&net));
+
+    Layer *layers = net_layers(&net);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_NOT_NULL(layers[i].w);
+        TEST_ASSERT_NOT_NULL(layers[i].b);
+        TEST_ASSERT_NOT_NULL(layers[i].y);
+        TEST_ASSERT_NULL(layers[i].x);
+        TEST_ASSERT_NULL(layers[i].gx);
+        TEST_ASSERT_NULL(layers[i].gw);
+        TEST_ASSERT_NULL(layers[i].gb);
+    }
+
+    // Backward is not available
+    float dummy_gy;
+    TEST_ASSERT_NULL(net_backward(&net, &dummy_gy));
+    TEST_ASSERT_NULL(net_backward_accumulate(&net, &dummy_gy));
+
+    // Nothing to be cleared
+    net_clear_grad(&net);
+
+    net_free_layers(&net);
+    TEST_ASSERT_NULL(net.layers);
+    TEST_ASSERT_NULL(net.arena);
+}
+
+void test_inference_shares_outputs(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    net_alloc_inference(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=20 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=20, .out=40 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=40, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=5 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // Outputs are in 2 ping-pong buffers large enough for each of them
+    Layer *layers = net_layers(&net);
+    TEST_ASSERT_EQUAL_PTR(&net.arena[net.num_params], layers[0].y);
+    TEST_ASSERT_EQUAL_PTR(&net.arena[net.num_params + 32], layers[1].y);
+    TEST_ASSERT_EQUAL_PTR(layers[0].y, layers[2].y);
+    TEST_ASSERT_EQUAL_PTR(layers[1].y, layers[3].y);
+    // The work region for the largest input follows
+    TEST_ASSERT_EQUAL_INT((net.num_params + 32 + 48 + 48), net.arena_size);
+
+    net_free_layers(&net);
+}
+
+void test_memory_stats(void) {
+    Net net;
+
+    LayerParams layer_params[] = {
+        { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+        { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=5 },
+        { LAYER_TYPE_NONE }
+    };
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    net_alloc_layers(&net, layer_params);
+
+    // Each buffer takes 64 bytes
+    MemoryStats layer_stats[2];
+    MemoryStats stats = net_memory_stats(&net, layer_stats);
+    TEST_ASSERT_EQUAL_INT((64 * 4), stats.params);
+    TEST_ASSERT_EQUAL_INT((64 * 7), stats.grads);
+    TEST_ASSERT_EQUAL_INT((64 * 2), stats.activations);
+    TEST_ASSERT_EQUAL_INT(64, stats.scratch);
+
+    TEST_ASSERT_EQUAL_INT((64 * 2), layer_stats[0].params);
+    TEST_ASSERT_EQUAL_INT((64 * 3), layer_stats[0].grads);
+    // With the gradient of the network output
+    TEST_ASSERT_EQUAL_INT((64 * 4), layer_stats[1].grads);
+    TEST_ASSERT_EQUAL_INT(64, layer_stats[0].activations);
+    // Work memory is reserved in the arena aligned as other buffers
+    TEST_ASSERT_EQUAL_INT(64, layer_stats[0].scratch);
+    TEST_ASSERT_EQUAL_INT(64, layer_stats[1].scratch);
+
+    // Totals match the arena
+    TEST_ASSERT_EQUAL_INT(
+        (sizeof(float) * net.arena_size),
+        (stats.params + stats.grads + stats.activations + stats.scratch)
+    );
+
+    // Layers add up to the totals, the work region is the largest one of layers
+    TEST_ASSERT_EQUAL_INT(stats.params, (layer_stats[0].params + layer_stats[1].params));
+    TEST_ASSERT_EQUAL_INT(stats.grads, (layer_stats[0].grads + layer_stats[1].grads));
+    TEST_ASSERT_EQUAL_INT(
+        stats.activations, (layer_stats[0].activations + layer_stats[1].activations)
+    );
+    TEST_ASSERT_EQUAL_INT(stats.scratch, layer_stats[1].scratch);
+
+    net_free_layers(&net);
+
+    // Outputs share buffers in inference, counted once in total
+    net_alloc_inference(&net, layer_params);
+
+    stats = net_memory_stats(&net, layer_stats);
+    TEST_ASSERT_EQUAL_INT((64 * 4), stats.params);
+    TEST_ASSERT_EQUAL_INT(0, stats.grads);
+    TEST_ASSERT_EQUAL_INT((64 * 2), stats.activations);
+    TEST_ASSERT_EQUAL_INT(64, stats.scratch);
+    TEST_ASSERT_NULL(net.output_grad);
+
+    TEST_ASSERT_EQUAL_INT(0, layer_stats[1].grads);
+    TEST_ASSERT_EQUAL_INT(64, layer_stats[1].activations);
+    TEST_ASSERT_EQUAL_INT(64, layer_stats[1].scratch);
+
+    // Only the total is got
+    net_memory_stats(&net, NULL);
+
+    net_free_layers(&net);
+}
+
+void test_alloc_replica(void) {
+    Net net;
+    Net replica;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=5 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+    net_set_precision(&net, MATH_PRECISION_ACCURATE);
+
+    // Replica is initialized from the same layers
+    TEST_ASSERT_EQUAL_PTR(&replica, net_alloc_replica(&replica, &net));
+    TEST_ASSERT_EQUAL_INT(2, replica.size);
+    TEST_ASSERT_TRUE(replica.shared_params);
+    TEST_ASSERT_FALSE(net.shared_params);
+
+    // Parameters are shared, gradients and activations are its own
+    TEST_ASSERT_EQUAL_PTR(net.params, replica.params);
+    TEST_ASSERT_EQUAL_INT(net.num_params, replica.num_params);
+    TEST_ASSERT_EQUAL_INT(net.num_grads, replica.num_grads);
+    TEST_ASSERT_EQUAL_INT((net.arena_size - net.num_params), replica.arena_size);
+    TEST_ASSERT_EQUAL_PTR(replica.arena, replica.grads);
+
+    Layer *layers = net_layers(&net);
+    Layer *replica_layers = net_layers(&replica);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_MEMORY(
+            &layers[i].params, &replica_layers[i].params, sizeof(LayerParams)
+        );
+        TEST_ASSERT_EQUAL_PTR(layers[i].w, replica_layers[i].w);
+        TEST_ASSERT_EQUAL_PTR(layers[i].b, replica_layers[i].b);
+        TEST_ASSERT_TRUE(layers[i].y != replica_layers[i].y);
+        TEST_ASSERT_EQUAL_INT(MATH_PRECISION_ACCURATE, replica_layers[i].precision);
+
+        // Gradients of parameters are in the same layout for the reduction
+        TEST_ASSERT_EQUAL_INT(
+            (layers[i].gw - net.grads), (replica_layers[i].gw - replica.grads)
+        );
+        TEST_ASSERT_EQUAL_INT(
+            (layers[i].gb - net.grads), (replica_layers[i].gb - replica.grads)
+        );
+    }
+
+    // Parameters are counted only in the network
+    const MemoryStats stats = net_memory_stats(&replica, NULL);
+    TEST_ASSERT_EQUAL_INT(0, stats.params);
+    TEST_ASSERT_EQUAL_INT(
+        (sizeof(float) * replica.arena_size),
+        (stats.grads + stats.activations + stats.scratch)
+    );
+
+    net_free_layers(&replica);
+    TEST_ASSERT_NOT_NULL(net.params);
+    net_free_layers(&net);
+}
+
+void test_alloc_replica_fail_if_net_is_inference(void) {
+    Net net;
+    Net replica;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    net_alloc_inference(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    TEST_ASSERT_NULL(net_alloc_replica(&replica, &net));
+    TEST_ASSERT_NULL(net_alloc_replica(&replica, NULL));
+    TEST_ASSERT_NULL(net_alloc_replica(NULL, &net));
+
+    net_free_layers(&net);
+}
+
+void test_allocation_fail_if_layer_init_fails(void) {
+    Net net;
+
+    layer_init_ExpectAnyArgsAndReturn(NULL);
+    TEST_ASSERT_NULL(
+        net_alloc_layers(
+            &net,
+            (LayerParams[]){
+                { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=2 },
+                { LAYER_TYPE_NONE }
+            }
+        )
+    );
+    TEST_ASSERT_NULL(net.layers);
+    TEST_ASSERT_NULL(net.arena);
+}
+
 void test_clear_grad(void) {
     Net net;
 
     layer_connect_IgnoreAndReturn(true);
-    Layer dummy_layer;
-    layer_alloc_params_IgnoreAndReturn(&dummy_layer);
+    layer_init_StubWithCallback(dummy_init);
     net_alloc_layers(
         &net,
         (LayerParams[]){
-            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=2 },
-            { LAYER_TYPE_DUMMY },
-            { LAYER_TYPE_DUMMY },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
             { LAYER_TYPE_NONE }
         }
     );
 
-    layer_clear_grad_Expect(&net_layers(&net)[0]);
-    layer_clear_grad_Expect(&net_layers(&net)[1]);
-    layer_clear_grad_Expect(&net_layers(&net)[2]);
+    for (size_t i = 0; i < net.num_grads; i++) {
+        net.grads[i] = 1;
+    }
+    for (size_t i = 0; i < net.num_params; i++) {
+        net.params[i] = 1;
+    }
+
     net_clear_grad(&net);
 
-    layer_free_params_Ignore();
+    // Only gradients are cleared at once
+    TEST_ASSERT_EACH_EQUAL_FLOAT(0, net.grads, net.num_grads);
+    TEST_ASSERT_EACH_EQUAL_FLOAT(1, net.params, net.num_params);
+
+    net_free_layers(&net);
+}
+
+void test_set_precision(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(dummy_init);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // Fast by default
+    TEST_ASSERT_EQUAL_INT(MATH_PRECISION_FAST, net_layers(&net)[0].precision);
+    TEST_ASSERT_EQUAL_INT(MATH_PRECISION_FAST, net_layers(&net)[1].precision);
+
+    net_set_precision(&net, MATH_PRECISION_ACCURATE);
+    TEST_ASSERT_EQUAL_INT(MATH_PRECISION_ACCURATE, net_layers(&net)[0].precision);
+    TEST_ASSERT_EQUAL_INT(MATH_PRECISION_ACCURATE, net_layers(&net)[1].precision);
+
+    net_free_layers(&net);
+}
+
+void test_fuse_layers(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(fusing_init);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=4 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // The fused layer has no buffers, its output is the one of the previous layer
+    Layer *layers = net_layers(&net);
+    TEST_ASSERT_NOT_NULL(layers[0].gz);
+    TEST_ASSERT_NULL(layers[1].x);
+    TEST_ASSERT_EQUAL_PTR(layers[0].y, layers[1].y);
+    TEST_ASSERT_NULL(layers[1].gx);
+    TEST_ASSERT_NOT_NULL(layers[2].y);
+
+    net_free_layers(&net);
+}
+
+void test_unfused_layers(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(fusing_init);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3, .unfused=true },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // Both layers keep their own buffers
+    Layer *layers = net_layers(&net);
+    TEST_ASSERT_NULL(layers[0].gz);
+    TEST_ASSERT_NOT_NULL(layers[1].y);
+    TEST_ASSERT_NOT_EQUAL(layers[0].y, layers[1].y);
+
+    net_free_layers(&net);
+}
+
+void test_forward_returns_output_of_fused_layer(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(fusing_init);
+    net_alloc_layers(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // The fused layer passes the output of the previous one through
+    Layer *layers = net_layers(&net);
+    float x[2] = { 0 };
+    layer_forward_ExpectAndReturn(&layers[0], x, layers[0].y);
+    layer_forward_ExpectAndReturn(&layers[1], layers[0].y, layers[0].y);
+
+    float *y = net_forward(&net, x);
+    TEST_ASSERT_NOT_NULL(y);
+    TEST_ASSERT_EQUAL_PTR(y, net_output(&net)->y);
+
+    net_free_layers(&net);
+}
+
+void test_inference_keeps_output_through_fused_layer(void) {
+    Net net;
+
+    layer_connect_IgnoreAndReturn(true);
+    layer_init_StubWithCallback(fusing_init);
+    net_alloc_inference(
+        &net,
+        (LayerParams[]){
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=2, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=3 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=3, .out=4 },
+            { LAYER_TYPE_DUMMY, .batch_size=1, .in=4, .out=5 },
+            { LAYER_TYPE_NONE }
+        }
+    );
+
+    // The third layer reads the output of the first one through the fused one
+    Layer *layers = net_layers(&net);
+    TEST_ASSERT_NULL(layers[0].gz);
+    TEST_ASSERT_EQUAL_PTR(layers[0].y, layers[1].y);
+    TEST_ASSERT_NOT_EQUAL(layers[0].y, layers[2].y);
+    TEST_ASSERT_EQUAL_PTR(layers[0].y, layers[3].y);
+
     net_free_layers(&net);
 }
@@ -0,0 +1,247 @@
+/**
+ * @file test_optimizer.c
+ * @brief Unit tests of optimizer.c
+ */
+#include "optimizer.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "mock_net.h"
+#include "thread_pool.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Number of parameters of a test network, a multiple of the arena alignment
+#define SIZE 16
+
+static float params[SIZE];
+static float grads[SIZE];
+
+// Network seen as flat parameters and gradients
+static Net net = {
+    .params = params,
+    .grads = grads,
+    .num_params = SIZE
+};
+
+void setUp(void) {
+    for (int i = 0; i < SIZE; i++) {
+        params[i] = 1;
+        grads[i] = 0;
+    }
+    grads[0] = 2;
+    grads[1] = -0.5;
+}
+
+void tearDown(void) {}
+
+void test_alloc_with_default_params(void) {
+    Optimizer optimizer;
+
+    TEST_ASSERT_EQUAL_PTR(
+        &optimizer,
+        optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_ADAMW, 0.1f))
+    );
+    TEST_ASSERT_EQUAL_FLOAT(0.1, optimizer.params.learning_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0.9, optimizer.params.beta1);
+    TEST_ASSERT_EQUAL_FLOAT(0.999, optimizer.params.beta2);
+    TEST_ASSERT_EQUAL_FLOAT(1e-8, optimizer.params.eps);
+    TEST_ASSERT_EQUAL_FLOAT(0.01, optimizer.params.weight_decay);
+    TEST_ASSERT_EQUAL_INT(SIZE, optimizer.size);
+    TEST_ASSERT_EQUAL_INT(0, optimizer.steps);
+
+    // 2 moments in a single aligned allocation, cleared
+    TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)optimizer.state % 64));
+    TEST_ASSERT_EQUAL_PTR(optimizer.state, optimizer.m);
+    TEST_ASSERT_EQUAL_PTR(&optimizer.state[SIZE], optimizer.v);
+    TEST_ASSERT_EACH_EQUAL_FLOAT(0, optimizer.state, (2 * SIZE));
+
+    optimizer_free(&optimizer);
+    TEST_ASSERT_NULL(optimizer.state);
+}
+
+void test_alloc_states_by_type(void) {
+    Optimizer optimizer;
+
+    // No state
+    optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_SGD, 0.1f));
+    TEST_ASSERT_NULL(optimizer.state);
+    TEST_ASSERT_NULL(optimizer.m);
+    TEST_ASSERT_NULL(optimizer.v);
+    optimizer_free(&optimizer);
+
+    // Velocity
+    optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_NESTEROV, 0.1f));
+    TEST_ASSERT_EQUAL_PTR(optimizer.state, optimizer.m);
+    TEST_ASSERT_NULL(optimizer.v);
+    TEST_ASSERT_EQUAL_FLOAT(0.9, optimizer.params.momentum);
+    optimizer_free(&optimizer);
+
+    // Only the 2nd moment
+    optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_RMSPROP, 0.1f));
+    TEST_ASSERT_NULL(optimizer.m);
+    TEST_ASSERT_EQUAL_PTR(optimizer.state, optimizer.v);
+    TEST_ASSERT_EQUAL_FLOAT(0.99, optimizer.params.beta2);
+    optimizer_free(&optimizer);
+}
+
+void test_alloc_fail_if_net_has_no_gradients(void) {
+    Optimizer optimizer;
+    Net inference_net = { .params = params, .num_params = SIZE };
+
+    TEST_ASSERT_NULL(
+        optimizer_alloc(
+            &optimizer, &inference_net, optimizer_params_default(OPTIMIZER_TYPE_SGD, 0.1f)
+        )
+    );
+}
+
+void test_sgd(void) {
+    Optimizer optimizer;
+    optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_SGD, 0.1f));
+
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.8, 1.05, 1), params, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_momentum(void) {
+    Optimizer optimizer;
+    OptimizerParams optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_MOMENTUM, 0.1f);
+    optimizer_params.momentum = 0.5f;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+
+    // v = g
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.8, 1.05, 1), params, 3);
+
+    // v = 0.5 * g + g
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.5, 1.125, 1), params, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_nesterov(void) {
+    Optimizer optimizer;
+    OptimizerParams optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_NESTEROV, 0.1f);
+    optimizer_params.momentum = 0.5f;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+
+    // v = g, w -= lr * (g + 0.5 * v)
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.7, 1.075, 1), params, 3);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(2, -0.5, 0), optimizer.m, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_rmsprop(void) {
+    Optimizer optimizer;
+    OptimizerParams optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_RMSPROP, 0.1f);
+    optimizer_params.beta2 = 0.75f;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+
+    // v = 0.25 * g^2, w -= lr * g / sqrt(v)
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(1, 0.0625, 0), optimizer.v, 3);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.8, 1.2, 1), params, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_adam(void) {
+    Optimizer optimizer;
+    optimizer_alloc(&optimizer, &net, optimizer_params_default(OPTIMIZER_TYPE_ADAM, 0.1f));
+
+    // The first step is lr * sign(g) by the bias correction
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, TEST_UTIL_FLOAT_ARRAY(0.9, 1.1, 1), params, 3);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.2, -0.05, 0), optimizer.m, 3);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-7, TEST_UTIL_FLOAT_ARRAY(0.004, 0.00025, 0), optimizer.v, 3);
+
+    // The same gradient keeps the step
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_INT(2, optimizer.steps);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, TEST_UTIL_FLOAT_ARRAY(0.8, 1.2, 1), params, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_zero_hyperparameters_are_kept(void) {
+    Optimizer optimizer;
+
+    // Momentum of 0 is plain SGD
+    OptimizerParams optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_MOMENTUM, 0.1f);
+    optimizer_params.momentum = 0;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+    TEST_ASSERT_EQUAL_FLOAT(0, optimizer.params.momentum);
+
+    optimizer_step(&optimizer, &net);
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(TEST_UTIL_FLOAT_ARRAY(0.6, 1.1, 1), params, 3);
+    optimizer_free(&optimizer);
+
+    // Neither the 1st moment nor weight decay
+    optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_ADAMW, 0.1f);
+    optimizer_params.beta1 = 0;
+    optimizer_params.weight_decay = 0;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+    TEST_ASSERT_EQUAL_FLOAT(0, optimizer.params.beta1);
+    TEST_ASSERT_EQUAL_FLOAT(0, optimizer.params.weight_decay);
+
+    // Without the decay, a parameter without a gradient is kept
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, TEST_UTIL_FLOAT_ARRAY(0.5, 1.2, 1), params, 3);
+    optimizer_free(&optimizer);
+}
+
+void test_adamw(void) {
+    Optimizer optimizer;
+    OptimizerParams optimizer_params = optimizer_params_default(OPTIMIZER_TYPE_ADAMW, 0.1f);
+    optimizer_params.weight_decay = 0.5f;
+    optimizer_alloc(&optimizer, &net, optimizer_params);
+
+    // Decayed by (1 - lr * weight_decay) even without a gradient
+    optimizer_step(&optimizer, &net);
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, TEST_UTIL_FLOAT_ARRAY(0.85, 1.05, 0.95), params, 3);
+
+    optimizer_free(&optimizer);
+}
+
+void test_step_multithreaded(void) {
+    const int size = 100000;
+    float *w = malloc(sizeof(float) * size);
+    float *g = malloc(sizeof(float) * size);
+    float *answer = malloc(sizeof(float) * size);
+    for (int i = 0; i < size; i++) {
+        w[i] = 1;
+        g[i] = (float)((i % 7) - 3);
+        answer[i] = 1 - 0.01f * ((g[i] > 0) - (g[i] < 0));
+    }
+
+    Net large_net = { .params = w, .grads = g, .num_params = size };
+    Optimizer optimizer;
+    optimizer_alloc(
+        &optimizer, &large_net, optimizer_params_default(OPTIMIZER_TYPE_ADAM, 0.01f)
+    );
+
+    thread_pool_set_num_threads(4);
+    optimizer_step(&optimizer, &large_net);
+    thread_pool_set_num_threads(1);
+
+    TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, answer, w, size);
+
+    optimizer_free(&optimizer);
+    free(w);
+    free(g);
+    free(answer);
+}
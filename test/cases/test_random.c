@@ -0,0 +1,144 @@
+/**
+ * @file test_random.c
+ * @brief Unit tests of random.c
+ */
+#include "random.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "vmath.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Number of values for statistics, not a multiple of a block
+#define NUM_VALUES 100001
+
+// Number of outputs compared between generators
+#define NUM_BITS 16
+
+static float values[NUM_VALUES];
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Check the mean and the std. dev. of values
+static void assert_stats(
+    const float *y, const int size, const float mean, const float stddev, const float delta
+) {
+    double sum = 0;
+    double sum_sq = 0;
+    for (int i = 0; i < size; i++) {
+        TEST_ASSERT_TRUE(isfinite(y[i]));
+        sum += y[i];
+        sum_sq += (double)y[i] * y[i];
+    }
+    const double m = sum / size;
+    const double s = sqrt(sum_sq / size - m * m);
+
+    TEST_ASSERT_FLOAT_WITHIN(delta, mean, (float)m);
+    TEST_ASSERT_FLOAT_WITHIN(delta, stddev, (float)s);
+}
+
+void test_same_seed_and_stream(void) {
+    RandomState a, b;
+    rand_seed(&a, 1, 2);
+    rand_seed(&b, 1, 2);
+
+    for (int i = 0; i < NUM_BITS; i++) {
+        TEST_ASSERT_TRUE(rand_next(&a) == rand_next(&b));
+    }
+}
+
+void test_different_streams(void) {
+    RandomState a, b, c;
+    rand_seed(&a, 1, 0);
+    rand_seed(&b, 1, 1);
+    rand_seed(&c, 2, 0);
+
+    int num_same = 0;
+    for (int i = 0; i < NUM_BITS; i++) {
+        const uint64_t x = rand_next(&a);
+        num_same += (x == rand_next(&b));
+        num_same += (x == rand_next(&c));
+    }
+    TEST_ASSERT_EQUAL_INT(0, num_same);
+}
+
+void test_uniform(void) {
+    RandomState state;
+    rand_seed(&state, 1, 0);
+
+    for (int i = 0; i < NUM_VALUES; i++) {
+        values[i] = rand_uniform(&state);
+        TEST_ASSERT_TRUE((values[i] >= 0) && (values[i] < 1));
+    }
+    assert_stats(values, NUM_VALUES, 0.5f, (1 / sqrtf(12)), 0.01f);
+}
+
+void test_fill_uniform(void) {
+    RandomState state;
+    rand_seed(&state, 1, 0);
+
+    rand_fill_uniform(&state, values, NUM_VALUES, -2, 4);
+    for (int i = 0; i < NUM_VALUES; i++) {
+        TEST_ASSERT_TRUE((values[i] >= -2) && (values[i] < 4));
+    }
+    assert_stats(values, NUM_VALUES, 1, (6 / sqrtf(12)), 0.05f);
+}
+
+void test_norm(void) {
+    RandomState state;
+    rand_seed(&state, 1, 0);
+
+    for (int i = 0; i < NUM_VALUES; i++) {
+        values[i] = rand_norm(&state, 1, 2);
+    }
+    assert_stats(values, NUM_VALUES, 1, 2, 0.05f);
+}
+
+void test_fill_norm(void) {
+    RandomState state;
+    rand_seed(&state, 1, 0);
+
+    rand_fill_norm(&state, values, NUM_VALUES, 1, 2);
+    assert_stats(values, NUM_VALUES, 1, 2, 0.05f);
+
+    // Tails of the distribution
+    int num_outliers = 0;
+    for (int i = 0; i < NUM_VALUES; i++) {
+        num_outliers += (fabsf(values[i] - 1) > (3 * 2));
+    }
+    TEST_ASSERT_INT_WITHIN(100, 270, num_outliers);
+}
+
+void test_fill_norm_keeps_odd_output(void) {
+    RandomState a, b;
+    rand_seed(&a, 1, 0);
+    rand_seed(&b, 1, 0);
+
+    // The spare output of an odd size starts the next call
+    float x[4];
+    float y[4];
+    rand_fill_norm(&a, x, 3, 0, 1);
+    rand_fill_norm(&a, &x[3], 1, 0, 1);
+    rand_fill_norm(&b, y, 4, 0, 1);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(y, x, 4);
+
+    // And of rand_norm
+    rand_seed(&a, 1, 0);
+    rand_norm(&a, 0, 1);
+    TEST_ASSERT_TRUE(a.has_spare);
+    const float spare = a.spare;
+    rand_fill_norm(&a, x, 1, 2, 3);
+    TEST_ASSERT_EQUAL_FLOAT((2 + spare * 3), x[0]);
+    TEST_ASSERT_FALSE(a.has_spare);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file test_sampler.c
+ * @brief Unit tests of sampler.c
+ */
+#include "sampler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "random.h"
+#include "vmath.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Number of samples of a test sampler
+#define NUM_SAMPLES 1000
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Check indices are a permutation of all samples
+static void assert_permutation(const size_t *indices, const size_t num_samples) {
+    static bool seen[NUM_SAMPLES];
+    memset(seen, 0, sizeof(seen));
+
+    for (size_t i = 0; i < num_samples; i++) {
+        TEST_ASSERT_TRUE(indices[i] < num_samples);
+        TEST_ASSERT_FALSE(seen[indices[i]]);
+        seen[indices[i]] = true;
+    }
+}
+
+void test_alloc_in_order(void) {
+    Sampler sampler;
+    TEST_ASSERT_EQUAL_PTR(&sampler, sampler_alloc(&sampler, NUM_SAMPLES, 0));
+    TEST_ASSERT_EQUAL_INT(NUM_SAMPLES, sampler.num_samples);
+
+    for (size_t i = 0; i < NUM_SAMPLES; i++) {
+        TEST_ASSERT_EQUAL_INT(i, sampler.indices[i]);
+    }
+
+    sampler_free(&sampler);
+    TEST_ASSERT_NULL(sampler.indices);
+}
+
+void test_shuffle(void) {
+    Sampler sampler;
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&sampler, NUM_SAMPLES, 1));
+
+    size_t previous[NUM_SAMPLES];
+    memcpy(previous, sampler.indices, sizeof(previous));
+    for (int epoch = 0; epoch < 3; epoch++) {
+        const size_t *indices = sampler_shuffle(&sampler);
+        TEST_ASSERT_EQUAL_PTR(sampler.indices, indices);
+        assert_permutation(indices, NUM_SAMPLES);
+
+        // Another permutation for each epoch
+        TEST_ASSERT_TRUE(memcmp(previous, indices, sizeof(previous)) != 0);
+        memcpy(previous, indices, sizeof(previous));
+    }
+
+    sampler_free(&sampler);
+}
+
+void test_shuffle_reproducible_by_seed(void) {
+    Sampler samplers[3];
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&samplers[0], NUM_SAMPLES, 42));
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&samplers[1], NUM_SAMPLES, 42));
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&samplers[2], NUM_SAMPLES, 43));
+
+    for (int epoch = 0; epoch < 2; epoch++) {
+        for (int i = 0; i < 3; i++) {
+            sampler_shuffle(&samplers[i]);
+        }
+
+        TEST_ASSERT_TRUE(
+            memcmp(samplers[0].indices, samplers[1].indices, (sizeof(size_t) * NUM_SAMPLES)) == 0
+        );
+        TEST_ASSERT_TRUE(
+            memcmp(samplers[0].indices, samplers[2].indices, (sizeof(size_t) * NUM_SAMPLES)) != 0
+        );
+    }
+
+    for (int i = 0; i < 3; i++) {
+        sampler_free(&samplers[i]);
+    }
+}
+
+void test_shuffle_single_sample(void) {
+    Sampler sampler;
+    TEST_ASSERT_NOT_NULL(sampler_alloc(&sampler, 1, 1));
+    TEST_ASSERT_EQUAL_INT(0, sampler_shuffle(&sampler)[0]);
+    sampler_free(&sampler);
+}
+
+void test_alloc_fail_if_no_samples(void) {
+    Sampler sampler;
+    TEST_ASSERT_NULL(sampler_alloc(&sampler, 0, 1));
+    TEST_ASSERT_NULL(sampler_alloc(NULL, 1, 1));
+}
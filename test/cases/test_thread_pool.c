@@ -0,0 +1,134 @@
+/**
+ * @file test_thread_pool.c
+ * @brief Unit tests of thread_pool.c
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "thread_pool.h"
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "unity.h"
+
+#define SIZE 1000
+
+void setUp(void) {}
+
+void tearDown(void) {
+    thread_pool_set_num_threads(1);
+}
+
+// Count calls for each index
+static void count_task(void *arg, const int begin, const int end) {
+    int *counts = arg;
+    for (int i = begin; i < end; i++) {
+        counts[i]++;
+    }
+}
+
+// Run a nested loop for each index
+static void nested_task(void *arg, const int begin, const int end) {
+    int *counts = arg;
+    for (int i = begin; i < end; i++) {
+        thread_pool_parallel_for(1, 1, count_task, &counts[i]);
+    }
+}
+
+void test_default_is_serial(void) {
+    TEST_ASSERT_EQUAL_INT(1, thread_pool_num_threads());
+}
+
+void test_set_num_threads(void) {
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(4));
+    TEST_ASSERT_EQUAL_INT(4, thread_pool_num_threads());
+
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(2));
+    TEST_ASSERT_EQUAL_INT(2, thread_pool_num_threads());
+
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(1));
+    TEST_ASSERT_EQUAL_INT(1, thread_pool_num_threads());
+}
+
+void test_fail_to_set_zero_threads(void) {
+    TEST_ASSERT_FALSE(thread_pool_set_num_threads(0));
+    TEST_ASSERT_EQUAL_INT(1, thread_pool_num_threads());
+}
+
+void test_serial_if_failed_to_create_threads(void) {
+    // Limit the address space to the current one, so that stacks of threads cannot be mapped
+    FILE *fp = fopen("/proc/self/statm", "r");
+    unsigned long pages = 0;
+    if (fp != NULL) {
+        if (fscanf(fp, "%lu", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(fp);
+    }
+    if (pages == 0) {
+        TEST_IGNORE_MESSAGE("Size of the address space is not known");
+    }
+
+    struct rlimit limit;
+    TEST_ASSERT_EQUAL_INT(0, getrlimit(RLIMIT_AS, &limit));
+    const struct rlimit small = {
+        .rlim_cur = (rlim_t)pages * (rlim_t)sysconf(_SC_PAGESIZE) + (16 << 20),
+        .rlim_max = limit.rlim_max
+    };
+    TEST_ASSERT_EQUAL_INT(0, setrlimit(RLIMIT_AS, &small));
+
+    // Some workers may be created before a failure, all of them are joined
+    const bool succeeded = thread_pool_set_num_threads(64);
+    TEST_ASSERT_EQUAL_INT(0, setrlimit(RLIMIT_AS, &limit));
+
+    TEST_ASSERT_FALSE(succeeded);
+    TEST_ASSERT_EQUAL_INT(1, thread_pool_num_threads());
+
+    int counts[SIZE] = { 0 };
+    thread_pool_parallel_for(SIZE, 1, count_task, counts);
+    for (int i = 0; i < SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(1, counts[i]);
+    }
+
+    // Threads are created again without the limit
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(4));
+    TEST_ASSERT_EQUAL_INT(4, thread_pool_num_threads());
+}
+
+void test_parallel_for_serially(void) {
+    int counts[SIZE] = { 0 };
+
+    thread_pool_parallel_for(SIZE, 1, count_task, counts);
+
+    for (int i = 0; i < SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(1, counts[i]);
+    }
+}
+
+void test_parallel_for_covers_each_index_once(void) {
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(4));
+
+    // Repeat to run jobs on both polling and parked workers
+    for (int n = 0; n < 100; n++) {
+        int counts[SIZE] = { 0 };
+
+        thread_pool_parallel_for(SIZE, 7, count_task, counts);
+
+        for (int i = 0; i < SIZE; i++) {
+            TEST_ASSERT_EQUAL_INT(1, counts[i]);
+        }
+    }
+}
+
+void test_nested_parallel_for(void) {
+    TEST_ASSERT_TRUE(thread_pool_set_num_threads(4));
+
+    int counts[SIZE] = { 0 };
+
+    thread_pool_parallel_for(SIZE, 1, nested_task, counts);
+
+    for (int i = 0; i < SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(1, counts[i]);
+    }
+}
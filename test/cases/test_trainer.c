@@ -4,11 +4,185 @@
  */
 #include "trainer.h"
 
+#include <math.h>
+
 #include "mock_net.h"
+#include "mock_thread_pool.h"
 #include "test_utils.h"
 #include "unity.h"
 
-void setUp(void) {}
+// Number of samples of a micro-batch of the fake network
+#define MICRO_BATCH_SIZE 2
+
+// Number of samples of an effective batch
+#define BATCH_SIZE 5
+
+// Max. number of fake networks, the network and its replicas
+#define MAX_NETS 8
+
+// Weight shared by fake networks
+static float fake_w;
+
+// Outputs of fake networks, y = w * x
+static float fake_y[MAX_NETS][MICRO_BATCH_SIZE];
+
+// Gradients of fake networks, only the weight gw = sum(gy * x)
+static float fake_grads[MAX_NETS];
+
+// Gradients of outputs of fake networks, in their arenas
+static float fake_output_grads[MAX_NETS][MICRO_BATCH_SIZE];
+
+// Number of samples of each micro-batch of the first network
+static int micro_batches[BATCH_SIZE];
+
+// Layers of fake networks
+static Layer fake_layers[MAX_NETS];
+
+// Precision of the output layer expected by losses
+static MathPrecision loss_precision;
+
+// Networks with 1 input and 1 output, the first one is trained
+static Net fake_nets[MAX_NETS];
+
+// Fake network of training
+static Net *const fake_net = &fake_nets[0];
+
+static float *fake_forward_batch(Net *net, const float *x, const int n, int num_calls) {
+    (void)num_calls;
+    TEST_ASSERT_TRUE(n <= MICRO_BATCH_SIZE);
+
+    const int index = (int)(net->layers - fake_layers);
+    if (index == 0) {
+        micro_batches[num_calls] = n;
+    }
+
+    // Set by the network for backward
+    net->layers[0].batch = n;
+    net->layers[0].x = x;
+
+    for (int i = 0; i < n; i++) {
+        fake_y[index][i] = *net->layers[0].w * x[i];
+    }
+    return fake_y[index];
+}
+
+static float *fake_backward(Net *net, const float *gy, int num_calls) {
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_PTR(net->output_grad, gy);
+
+    net->grads[0] = 0;
+    for (int i = 0; i < net->layers[0].batch; i++) {
+        net->grads[0] += gy[i] * net->layers[0].x[i];
+    }
+    return net->grads;
+}
+
+static float *fake_backward_accumulate(Net *net, const float *gy, int num_calls) {
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_PTR(net->output_grad, gy);
+
+    for (int i = 0; i < net->layers[0].batch; i++) {
+        net->grads[0] += gy[i] * net->layers[0].x[i];
+    }
+    return net->grads;
+}
+
+static Net *fake_alloc_replica(Net *replica, const Net *net, int num_calls) {
+    TEST_ASSERT_EQUAL_PTR(fake_net, net);
+
+    *replica = fake_nets[num_calls + 1];
+    return replica;
+}
+
+static Net *failed_alloc_replica(Net *replica, const Net *net, int num_calls) {
+    (void)replica;
+    (void)net;
+    return (num_calls < 2) ? replica : NULL;
+}
+
+// Run a parallel loop on the calling thread
+static void serial_parallel_for(
+    const int size, const int grain, ThreadPoolTask task, void *arg, int num_calls
+) {
+    (void)grain;
+    (void)num_calls;
+    task(arg, 0, size);
+}
+
+static float *failed_forward_batch(Net *net, const float *x, const int n, int num_calls) {
+    (void)net;
+    (void)x;
+    (void)n;
+    (void)num_calls;
+    return NULL;
+}
+
+// Squared error, the mean over samples
+static float squared_forward(
+    const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    TEST_ASSERT_EQUAL_INT(loss_precision, precision);
+    float loss = 0;
+    for (size_t i = 0; i < (batch_size * size); i++) {
+        loss += (y[i] - t[i]) * (y[i] - t[i]);
+    }
+    return loss / (float)batch_size;
+}
+
+static void squared_backward(
+    float *grad, const float *y, const float *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    TEST_ASSERT_EQUAL_INT(loss_precision, precision);
+    for (size_t i = 0; i < (batch_size * size); i++) {
+        grad[i] = 2 * (y[i] - t[i]) / (float)batch_size;
+    }
+}
+
+// Output of the expected class, the mean over samples
+static float picked_forward(
+    const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    (void)precision;
+    float loss = 0;
+    for (size_t i = 0; i < batch_size; i++) {
+        loss += y[i * size + t[i]];
+    }
+    return loss / (float)batch_size;
+}
+
+static void picked_backward(
+    float *grad, const float *y, const int *t, const size_t batch_size, const size_t size,
+    const MathPrecision precision
+) {
+    (void)precision;
+    (void)y;
+    for (size_t i = 0; i < batch_size; i++) {
+        for (size_t j = 0; j < size; j++) {
+            grad[i * size + j] = ((int)j == t[i]) ? (1 / (float)batch_size) : 0;
+        }
+    }
+}
+
+void setUp(void) {
+    for (int i = 0; i < MAX_NETS; i++) {
+        fake_layers[i] = (Layer){
+            .params={ .batch_size=MICRO_BATCH_SIZE, .in=1, .out=1 },
+            .w = &fake_w, .gw = &fake_grads[i]
+        };
+        fake_nets[i] = (Net){
+            .size = 1, .layers = &fake_layers[i], .grads = &fake_grads[i],
+            .output_grad = fake_output_grads[i], .num_params = 1
+        };
+
+        // Stale gradients to be overwritten
+        fake_grads[i] = 100;
+    }
+    fake_w = 1;
+    loss_precision = MATH_PRECISION_FAST;
+}
 
 void tearDown(void) {}
 
@@ -57,3 +231,188 @@ void test_train_step(void) {
         TEST_UTIL_FLOAT_ARRAY(1.01), net.layers[1].b, 1
     );
 }
+
+void test_train_accumulate(void) {
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+    net_backward_accumulate_StubWithCallback(fake_backward_accumulate);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    // Mean of (x - t)^2 and its gradient 2 * (x - t) * x over the batch
+    TEST_ASSERT_EQUAL_FLOAT(11, train_accumulate(fake_net, x, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_EQUAL_FLOAT(22, fake_grads[0]);
+    TEST_ASSERT_EQUAL_INT_ARRAY(((int[]){ 2, 2, 1 }), micro_batches, 3);
+}
+
+void test_train_accumulate_with_precision(void) {
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+    net_backward_accumulate_StubWithCallback(fake_backward_accumulate);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    // The loss follows the precision of the output layer
+    fake_layers[0].precision = MATH_PRECISION_ACCURATE;
+    loss_precision = MATH_PRECISION_ACCURATE;
+    TEST_ASSERT_EQUAL_FLOAT(11, train_accumulate(fake_net, x, t, BATCH_SIZE, loss_func));
+}
+
+void test_train_accumulate_sparse(void) {
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+    net_backward_accumulate_StubWithCallback(fake_backward_accumulate);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const int t[BATCH_SIZE] = { 0 };
+    const SparseLossFunc loss_func = { .forward = picked_forward, .backward = picked_backward };
+
+    TEST_ASSERT_EQUAL_FLOAT(3, train_accumulate_sparse(fake_net, x, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_EQUAL_FLOAT(3, fake_grads[0]);
+}
+
+void test_train_accumulate_fail(void) {
+    const float x[BATCH_SIZE] = { 0 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(NULL, x, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(fake_net, NULL, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(fake_net, x, NULL, BATCH_SIZE, loss_func));
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(fake_net, x, t, 0, loss_func));
+
+    net_forward_batch_StubWithCallback(failed_forward_batch);
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(fake_net, x, t, BATCH_SIZE, loss_func));
+}
+
+void test_train_accumulate_fail_if_net_is_for_inference(void) {
+    const float x[BATCH_SIZE] = { 0 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    // No gradient of the output, nothing is run
+    fake_net->output_grad = NULL;
+    TEST_ASSERT_FLOAT_IS_NAN(train_accumulate(fake_net, x, t, BATCH_SIZE, loss_func));
+}
+
+void test_train_data_parallel(void) {
+    net_alloc_replica_StubWithCallback(fake_alloc_replica);
+    net_free_layers_Ignore();
+    thread_pool_parallel_for_StubWithCallback(serial_parallel_for);
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+    net_backward_accumulate_StubWithCallback(fake_backward_accumulate);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    DataParallel dp;
+    TEST_ASSERT_EQUAL_PTR(&dp, train_data_parallel_alloc(&dp, fake_net, 3));
+    TEST_ASSERT_EQUAL_INT(3, dp.num_replicas);
+
+    // Shards of 1, 2 and 2 samples, reduced into the network as the mean over the batch
+    TEST_ASSERT_EQUAL_FLOAT(11, train_data_parallel(&dp, x, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_EQUAL_FLOAT(22, fake_grads[0]);
+    TEST_ASSERT_EQUAL_FLOAT(5.2, fake_grads[1]);
+
+    train_data_parallel_free(&dp);
+    TEST_ASSERT_NULL(dp.replicas);
+}
+
+void test_train_data_parallel_sparse(void) {
+    net_alloc_replica_StubWithCallback(fake_alloc_replica);
+    net_free_layers_Ignore();
+    thread_pool_parallel_for_StubWithCallback(serial_parallel_for);
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+    net_backward_accumulate_StubWithCallback(fake_backward_accumulate);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const int t[BATCH_SIZE] = { 0 };
+    const SparseLossFunc loss_func = { .forward = picked_forward, .backward = picked_backward };
+
+    // Replicas without samples are not reduced
+    DataParallel dp;
+    train_data_parallel_alloc(&dp, fake_net, MAX_NETS);
+    TEST_ASSERT_EQUAL_FLOAT(3, train_data_parallel_sparse(&dp, x, t, BATCH_SIZE, loss_func));
+    TEST_ASSERT_EQUAL_FLOAT(3, fake_grads[0]);
+
+    train_data_parallel_free(&dp);
+}
+
+void test_train_data_parallel_alloc_fail(void) {
+    net_alloc_replica_StubWithCallback(failed_alloc_replica);
+    net_free_layers_Ignore();
+
+    DataParallel dp;
+    TEST_ASSERT_NULL(train_data_parallel_alloc(&dp, fake_net, 4));
+    TEST_ASSERT_NULL(train_data_parallel_alloc(&dp, fake_net, 0));
+    TEST_ASSERT_NULL(train_data_parallel_alloc(&dp, NULL, 2));
+
+    // The network alone
+    TEST_ASSERT_EQUAL_PTR(&dp, train_data_parallel_alloc(&dp, fake_net, 1));
+    TEST_ASSERT_EQUAL_INT(1, dp.num_replicas);
+    train_data_parallel_free(&dp);
+}
+
+void test_train_hogwild(void) {
+    net_alloc_replica_StubWithCallback(fake_alloc_replica);
+    net_free_layers_Ignore();
+    thread_pool_parallel_for_StubWithCallback(serial_parallel_for);
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const float t[BATCH_SIZE] = { 0 };
+    const LossFunc loss_func = { .forward = squared_forward, .backward = squared_backward };
+
+    // Shards of 2 and 3 samples run one by one, micro-batches of 2, 1 and 2 samples
+    const int micro_batch_sizes[] = { 2, 2, 1 };
+    float w = 1;
+    float loss = 0;
+    for (int i = 0, begin = 0; i < 3; begin += micro_batch_sizes[i], i++) {
+        const int n = micro_batch_sizes[i];
+        float gw = 0;
+        for (int j = begin; j < (begin + n); j++) {
+            loss += (w * x[j]) * (w * x[j]);
+            gw += 2 * w * x[j] * x[j] / n;
+        }
+        w -= 0.01f * gw;
+    }
+
+    // Each replica updates the shared weight after each micro-batch
+    DataParallel dp;
+    train_data_parallel_alloc(&dp, fake_net, 2);
+    TEST_ASSERT_EQUAL_FLOAT(
+        (loss / BATCH_SIZE), train_hogwild(&dp, x, t, BATCH_SIZE, 0.01, loss_func)
+    );
+    TEST_ASSERT_EQUAL_FLOAT(w, fake_w);
+
+    train_data_parallel_free(&dp);
+}
+
+void test_train_hogwild_sparse(void) {
+    net_forward_batch_StubWithCallback(fake_forward_batch);
+    net_backward_StubWithCallback(fake_backward);
+
+    const float x[BATCH_SIZE] = { 1, 2, 3, 4, 5 };
+    const int t[BATCH_SIZE] = { 0 };
+    const SparseLossFunc loss_func = { .forward = picked_forward, .backward = picked_backward };
+
+    // Network alone, the gradient is the mean of x of a micro-batch
+    DataParallel dp;
+    train_data_parallel_alloc(&dp, fake_net, 1);
+    thread_pool_parallel_for_StubWithCallback(serial_parallel_for);
+    train_hogwild_sparse(&dp, x, t, BATCH_SIZE, 0.05, loss_func);
+    TEST_ASSERT_EQUAL_FLOAT((1 - (0.05 * 1.5) - (0.05 * 3.5) - (0.05 * 5)), fake_w);
+
+    TEST_ASSERT_FLOAT_IS_NAN(train_hogwild_sparse(&dp, x, NULL, BATCH_SIZE, 0.1, loss_func));
+    TEST_ASSERT_FLOAT_IS_NAN(train_hogwild_sparse(&dp, x, t, 0, 0.1, loss_func));
+
+    train_data_parallel_free(&dp);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file test_vmath.c
+ * @brief Unit tests of vmath.c
+ */
+#include "vmath.h"
+
+#include <math.h>
+
+#include "avx2_kernels.h"
+#include "avx512_kernels.h"
+#include "cpu.h"
+#include "generic_kernels.h"
+#include "kernels.h"
+#include "unity.h"
+#include "test_utils.h"
+
+// Not a multiple of any vector width
+#define SIZE 37
+
+// Precisions to be tested
+static const MathPrecision precisions[] = { MATH_PRECISION_FAST, MATH_PRECISION_ACCURATE };
+
+#define NUM_PRECISIONS 2
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Fill a vector with values in [-8, 8)
+static void fill_vector(float *vector, const int size) {
+    for (int i = 0; i < size; i++) {
+        vector[i] = (float)((i * 37) % 64) / 4 - 8;
+    }
+}
+
+void test_exp(void) {
+    float x[SIZE];
+    float y[SIZE];
+    fill_vector(x, SIZE);
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        vmath_exp(y, x, SIZE, precisions[i]);
+        for (int j = 0; j < SIZE; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(expf(x[j]) * 1e-6f, expf(x[j]), y[j]);
+        }
+    }
+}
+
+void test_log(void) {
+    float x[SIZE];
+    float y[SIZE];
+    fill_vector(x, SIZE);
+    for (int i = 0; i < SIZE; i++) {
+        x[i] = exp2f(x[i]);
+    }
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        vmath_log(y, x, SIZE, precisions[i]);
+        for (int j = 0; j < SIZE; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-6, logf(x[j]), y[j]);
+        }
+    }
+}
+
+void test_sigmoid(void) {
+    float x[SIZE];
+    float y[SIZE];
+    fill_vector(x, SIZE);
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        vmath_sigmoid(y, x, SIZE, precisions[i]);
+        for (int j = 0; j < SIZE; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-6, 1 / (1 + expf(-x[j])), y[j]);
+        }
+    }
+}
+
+void test_softmax(void) {
+    const float x[] = { 1, 2, 3 };
+    float y[3];
+
+    // exp(x) / (e + e^2 + e^3)
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        vmath_softmax(y, x, 3, precisions[i]);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(
+            1e-6, TEST_UTIL_FLOAT_ARRAY(0.09003057, 0.24472847, 0.66524096), y, 3
+        );
+    }
+}
+
+void test_softmax_large_input(void) {
+    const float x[] = { 1000, 1000 };
+    float y[2];
+
+    // Not overflow
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        vmath_softmax(y, x, 2, precisions[i]);
+        TEST_ASSERT_FLOAT_ARRAY_WITHIN(1e-6, TEST_UTIL_FLOAT_ARRAY(0.5, 0.5), y, 2);
+    }
+}
+
+void test_logsumexp(void) {
+    float x[300];
+    for (int i = 0; i < 300; i++) {
+        x[i] = (float)(i % 7) - 3;
+    }
+
+    // Over blocks, log(sum(exp(x))) by double precision
+    double sum = 0;
+    for (int i = 0; i < 300; i++) {
+        sum += exp(x[i]);
+    }
+
+    for (int i = 0; i < NUM_PRECISIONS; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-5, (float)log(sum), vmath_logsumexp(x, 300, precisions[i]));
+        // Not overflow
+        TEST_ASSERT_FLOAT_WITHIN(
+            1e-4, (1000 + logf(2)), vmath_logsumexp((float[]){ 1000, 1000 }, 2, precisions[i])
+        );
+    }
+}